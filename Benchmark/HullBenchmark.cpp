@@ -0,0 +1,787 @@
+/*
+ * Convex hull benchmark
+ *
+ * Builds the hull of several point clouds with each hull configuration of PaintLight and prints the results as JSON,
+ * so that runs can be compared across commits. The clouds are RGBA float pixels from 0 to 255 like RGBAImage, and the
+ * hull reads them through a stride 4 VertexDataSource like SolveStrokeDensity does:
+ *   - synthetic: uniform cube, sphere surface, Gaussian blobs and a heavily duplicated 8-bit grid
+ *   - the bundled mukyu.jpg and original.png
+ *   - any PNG, PPM/PGM, PFM or JPEG image given on the command line (all but JPEG read by ImageDecoder)
+ *
+ * For each cloud and configuration it reports the fastest and the median build time of the repetitions, the faces and
+ * vertices of the hull, the DiagnosticsData counters and the heap high-water mark of the build: the peak of the bytes
+ * allocated with operator new above those in use when it started, counted by the replacement operators below with the
+ * usable sizes of glibc, so memory the allocator reuses from earlier builds is counted as well.
+ *
+ * With --check, each hull is also checked against its cloud: the largest distance of a point in front of a face plane
+ * is reported in units of the tolerance (eps times the scale of the cloud), which is at most 1 for an eps-hull, and a
+ * warning is printed when it is more. The face planes of the PackedConvexHull of the hull (the one of the packed
+ * configuration, or one built from the triangle buffers like PaintLight does) are checked the same way: every hull
+ * vertex must be on or behind every plane. This costs points times faces per hull, so it is off by default.
+ *
+ * With --batch N, N clouds (the clouds above, cycled) are also built at once with HullBatch, one long-lived QuickHull per
+ * thread, and the wall time of each batch, the throughput and the latency of each cloud are reported. The first batch
+ * starts with new workers, the repetitions reuse them, and "fresh" batches with a new HullBatch every time show what
+ * keeping the workers and their buffers saves.
+ *
+ * Usage: hull_benchmark [options] [image...]
+ *   --points N      points of the synthetic clouds (default 1000000)
+ *   --repeat N      builds per configuration (default 5)
+ *   --seed N        seed of the synthetic clouds (default 1)
+ *   --config A,B    configurations to run (default all, see --list)
+ *   --media DIR     directory of mukyu.jpg and original.png
+ *   --no-synthetic  skip the synthetic clouds
+ *   --no-bundled    skip the bundled images
+ *   --label TEXT    stored in the output, e.g. the commit under test
+ *   --output FILE   write the JSON there instead of stdout
+ *   --check         check that every point is within the tolerance of each hull (slow)
+ *   --batch N       also build N clouds at once with HullBatch (default 0, off)
+ *   --batch-threads N  threads of the batch (default 0, every core)
+ *   --list          list the configurations
+ * */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <malloc.h>
+#include <jpeglib.h>
+#include "QuickHull.hpp"
+#include "CompactQuickHull.hpp"
+#include "PackedConvexHull.hpp"
+#include "IntegerQuickHull.hpp"
+#include "InteriorPointFilter.hpp"
+#include "HullBatch.hpp"
+#include "ImageDecoder.h"
+
+#ifndef HULL_BENCHMARK_MEDIA_DIR
+#define HULL_BENCHMARK_MEDIA_DIR "."
+#endif
+#ifndef HULL_BENCHMARK_REVISION
+#define HULL_BENCHMARK_REVISION ""
+#endif
+
+namespace
+{
+	/*
+	 * Memory
+	 */
+
+	std::atomic<std::size_t> g_heap_in_use(0);
+	std::atomic<std::size_t> g_heap_peak(0);
+
+	void *AllocateCounted(std::size_t size, std::size_t alignment = 0)
+	{
+		void *p(alignment > alignof(std::max_align_t) ?
+			std::aligned_alloc(alignment, (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment) :
+			std::malloc(std::max<std::size_t>(size, 1)));
+		if (!p)
+			throw std::bad_alloc();
+		std::size_t const bytes(malloc_usable_size(p));
+		std::size_t const in_use(g_heap_in_use.fetch_add(bytes) + bytes);
+		std::size_t peak(g_heap_peak.load());
+		while (in_use > peak && !g_heap_peak.compare_exchange_weak(peak, in_use))
+			;
+		return p;
+	}
+
+	void FreeCounted(void *p) noexcept
+	{
+		if (!p)
+			return;
+		g_heap_in_use.fetch_sub(malloc_usable_size(p));
+		std::free(p);
+	}
+}
+
+// Every operator new and delete of the process, the libpng and libjpeg buffers (malloc) are not counted
+void *operator new(std::size_t size) { return AllocateCounted(size); }
+void *operator new[](std::size_t size) { return AllocateCounted(size); }
+void *operator new(std::size_t size, std::align_val_t alignment) { return AllocateCounted(size, static_cast<std::size_t>(alignment)); }
+void *operator new[](std::size_t size, std::align_val_t alignment) { return AllocateCounted(size, static_cast<std::size_t>(alignment)); }
+void operator delete(void *p) noexcept { FreeCounted(p); }
+void operator delete[](void *p) noexcept { FreeCounted(p); }
+void operator delete(void *p, std::size_t) noexcept { FreeCounted(p); }
+void operator delete[](void *p, std::size_t) noexcept { FreeCounted(p); }
+void operator delete(void *p, std::align_val_t) noexcept { FreeCounted(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { FreeCounted(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { FreeCounted(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { FreeCounted(p); }
+
+namespace
+{
+	using vec3f = quickhull::Vector3<float>;
+
+	// RGBA float pixels, 0 to 255
+	struct PointCloud
+	{
+		std::string name;
+		std::string source; // synthetic, bundled or image
+		std::size_t width = 0;
+		std::size_t height = 0; // rows of width points, the bands of the incremental configuration
+		std::vector<float> rgba;
+
+		std::size_t Size() const { return rgba.size() / 4; }
+		quickhull::VertexDataSource<float> View() const { return quickhull::VertexDataSource<float>(rgba.data(), Size(), 4); }
+	};
+
+	/*
+	 * Images
+	 */
+
+	// PNG, PPM/PGM and PFM rows are decoded straight into the cloud
+	void LoadDecoded(std::string const &path, PointCloud &cloud)
+	{
+		ImageDecoder decoder(path);
+		cloud.width = decoder.width;
+		cloud.height = decoder.height;
+		cloud.rgba.resize(cloud.width * cloud.height * 4);
+		decoder.Decode(ImageView(cloud.rgba.data(), decoder.width, decoder.height, cloud.width * 4, 0, PixelLayout::Interleaved));
+	}
+
+	struct JPEGError
+	{
+		jpeg_error_mgr mgr;
+		std::jmp_buf jump;
+		char message[JMSG_LENGTH_MAX];
+	};
+
+	void LoadJPEG(std::string const &path, PointCloud &cloud)
+	{
+		std::FILE *file(std::fopen(path.c_str(), "rb"));
+		if (!file)
+			throw std::runtime_error(path + ": cannot open");
+		jpeg_decompress_struct info;
+		JPEGError error;
+		info.err = jpeg_std_error(&error.mgr);
+		error.mgr.error_exit = [](j_common_ptr common) {
+			auto *e(reinterpret_cast<JPEGError *>(common->err));
+			e->mgr.format_message(common, e->message);
+			std::longjmp(e->jump, 1);
+		};
+		std::vector<std::uint8_t> row;
+		if (setjmp(error.jump))
+		{
+			jpeg_destroy_decompress(&info);
+			std::fclose(file);
+			throw std::runtime_error(path + ": " + error.message);
+		}
+		jpeg_create_decompress(&info);
+		jpeg_stdio_src(&info, file);
+		jpeg_read_header(&info, TRUE);
+		info.out_color_space = JCS_RGB;
+		jpeg_start_decompress(&info);
+		cloud.width = info.output_width;
+		cloud.height = info.output_height;
+		cloud.rgba.resize(cloud.width * cloud.height * 4);
+		row.resize(cloud.width * info.output_components);
+		for (float *dst(cloud.rgba.data()); info.output_scanline < info.output_height;)
+		{
+			JSAMPROW rows[1] = { row.data() };
+			jpeg_read_scanlines(&info, rows, 1);
+			for (std::size_t x(0); x < cloud.width; ++x, dst += 4)
+			{
+				dst[0] = static_cast<float>(row[x * 3 + 0]);
+				dst[1] = static_cast<float>(row[x * 3 + 1]);
+				dst[2] = static_cast<float>(row[x * 3 + 2]);
+				dst[3] = 255.0f;
+			}
+		}
+		jpeg_finish_decompress(&info);
+		jpeg_destroy_decompress(&info);
+		std::fclose(file);
+	}
+
+	PointCloud LoadImage(std::string const &path, std::string const &source)
+	{
+		PointCloud cloud;
+		cloud.name = path.substr(path.find_last_of("/\\") + 1);
+		cloud.source = source;
+		std::string extension(path.substr(path.find_last_of('.') + 1));
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		if (ImageDecoder::Supports(path))
+			LoadDecoded(path, cloud);
+		else if (extension == "jpg" || extension == "jpeg")
+			LoadJPEG(path, cloud);
+		else
+			throw std::runtime_error(path + ": only PNG, PPM/PGM, PFM and JPEG images are supported");
+		return cloud;
+	}
+
+	/*
+	 * Synthetic clouds
+	 */
+
+	PointCloud MakeSynthetic(std::string const &name, std::size_t count, std::uint32_t seed, std::function<vec3f(std::mt19937 &)> const &point)
+	{
+		PointCloud cloud;
+		cloud.name = name;
+		cloud.source = "synthetic";
+		cloud.width = 1024; // bands of 64K points for the incremental configuration
+		cloud.height = (count + cloud.width - 1) / cloud.width;
+		cloud.rgba.resize(count * 4);
+		std::mt19937 rng(seed);
+		for (std::size_t i(0); i < count; ++i)
+		{
+			vec3f const p(point(rng));
+			cloud.rgba[i * 4 + 0] = p.x;
+			cloud.rgba[i * 4 + 1] = p.y;
+			cloud.rgba[i * 4 + 2] = p.z;
+			cloud.rgba[i * 4 + 3] = 255.0f;
+		}
+		return cloud;
+	}
+
+	std::vector<PointCloud> MakeSyntheticClouds(std::size_t count, std::uint32_t seed)
+	{
+		std::vector<PointCloud> clouds;
+		clouds.push_back(MakeSynthetic("uniform_cube", count, seed, [](std::mt19937 &rng) {
+			std::uniform_real_distribution<float> u(0.0f, 255.0f);
+			float const r(u(rng)), g(u(rng)), b(u(rng));
+			return vec3f(r, g, b);
+		}));
+		clouds.push_back(MakeSynthetic("sphere_surface", count, seed, [](std::mt19937 &rng) {
+			std::normal_distribution<float> n(0.0f, 1.0f);
+			vec3f d;
+			do
+			{
+				float const x(n(rng)), y(n(rng)), z(n(rng));
+				d = vec3f(x, y, z);
+			} while (d.getLengthSquared() == 0.0f);
+			return vec3f(127.5f, 127.5f, 127.5f) + d.getNormalized() * 127.5f;
+		}));
+
+		// a few color clusters like the ones of a painting
+		std::mt19937 blob_rng(seed ^ 0x9e3779b9u);
+		std::uniform_real_distribution<float> center(32.0f, 223.0f), sigma(4.0f, 24.0f);
+		std::vector<std::pair<vec3f, float>> blobs;
+		for (int k(0); k < 8; ++k)
+		{
+			float const r(center(blob_rng)), g(center(blob_rng)), b(center(blob_rng));
+			blobs.emplace_back(vec3f(r, g, b), sigma(blob_rng));
+		}
+		clouds.push_back(MakeSynthetic("gaussian_blobs", count, seed, [&blobs](std::mt19937 &rng) {
+			std::normal_distribution<float> n(0.0f, 1.0f);
+			auto const &blob(blobs[rng() % blobs.size()]);
+			float const x(n(rng)), y(n(rng)), z(n(rng));
+			vec3f const p(blob.first + vec3f(x, y, z) * blob.second);
+			return vec3f(std::clamp(p.x, 0.0f, 255.0f), std::clamp(p.y, 0.0f, 255.0f), std::clamp(p.z, 0.0f, 255.0f));
+		}));
+
+		// 8-bit colors of a 16 level lattice, every one repeated many times
+		clouds.push_back(MakeSynthetic("duplicated_grid", count, seed, [](std::mt19937 &rng) {
+			std::uniform_int_distribution<int> level(0, 15);
+			int const r(level(rng)), g(level(rng)), b(level(rng));
+			return vec3f(static_cast<float>(r * 17), static_cast<float>(g * 17), static_cast<float>(b * 17));
+		}));
+		return clouds;
+	}
+
+	/*
+	 * Configurations
+	 */
+
+	struct BuildResult
+	{
+		bool skipped = false;
+		std::size_t faces = 0;
+		std::size_t vertices = 0;
+		std::size_t failed_horizon_edges = 0;
+		std::size_t hull_points = 0; // points the hull builder saw (after the prefilter, or kept by the incremental hull)
+		std::size_t hull_peak_bytes = 0; // CompactQuickHull::getPeakMemoryUsage
+		quickhull::ConvexHull<float> hull; // for --check
+		quickhull::PackedConvexHull<float> packed; // packed configuration only
+	};
+
+	struct Config
+	{
+		char const *name;
+		char const *description;
+		std::function<BuildResult(PointCloud const &)> build;
+	};
+
+	void SetHullSize(BuildResult &result, quickhull::ConvexHull<float> &&hull)
+	{
+		result.faces = hull.getIndexBuffer().size() / 3;
+		result.vertices = hull.getVertexBuffer().size();
+		result.hull = std::move(hull);
+	}
+
+	BuildResult BuildQuickHull(PointCloud const &cloud, std::size_t threads, bool simd)
+	{
+		BuildResult result;
+		quickhull::QuickHull<float> qh;
+		qh.setThreadCount(threads);
+		qh.setVectorizedClassification(simd);
+		SetHullSize(result, qh.getConvexHull(cloud.View(), true, false));
+		result.failed_horizon_edges = qh.getDiagnostics().m_failedHorizonEdges;
+		result.hull_points = cloud.Size();
+		return result;
+	}
+
+	BuildResult BuildPackedQuickHull(PointCloud const &cloud)
+	{
+		BuildResult result;
+		quickhull::QuickHull<float> qh;
+		result.packed = qh.getPackedConvexHull(cloud.View(), true);
+		result.faces = result.packed.getFaceCount();
+		result.vertices = result.packed.getVertexBuffer().size();
+		result.failed_horizon_edges = qh.getDiagnostics().m_failedHorizonEdges;
+		result.hull_points = cloud.Size();
+		return result;
+	}
+
+	BuildResult BuildCompactQuickHull(PointCloud const &cloud, std::size_t threads, bool prefilter)
+	{
+		BuildResult result;
+		auto points(cloud.View());
+		std::vector<vec3f> exterior;
+		if (prefilter)
+		{
+			quickhull::InteriorPointFilter<float> filter;
+			filter.setThreadCount(threads);
+			if (filter.setPolytope(points))
+			{
+				filter.copyExteriorPoints(points, exterior);
+				points = quickhull::VertexDataSource<float>(exterior);
+			}
+		}
+		quickhull::CompactQuickHull<float> qh;
+		qh.setThreadCount(threads);
+		SetHullSize(result, qh.getConvexHull(points, true, false));
+		result.failed_horizon_edges = qh.getDiagnostics().m_failedHorizonEdges;
+		result.hull_points = points.size();
+		result.hull_peak_bytes = qh.getPeakMemoryUsage();
+		return result;
+	}
+
+	BuildResult BuildIntegerQuickHull(PointCloud const &cloud)
+	{
+		BuildResult result;
+		if (!quickhull::IntegerQuickHull<float>::hasIntegerCoordinates(cloud.View()))
+		{
+			result.skipped = true;
+			return result;
+		}
+		quickhull::IntegerQuickHull<float> qh;
+		SetHullSize(result, qh.getConvexHull(cloud.View(), true, false));
+		result.failed_horizon_edges = qh.getDiagnostics().m_failedHorizonEdges;
+		result.hull_points = cloud.Size();
+		return result;
+	}
+
+	// Rows of the cloud in bands of 64, the way a decoder would hand them over
+	BuildResult BuildIncrementalQuickHull(PointCloud const &cloud)
+	{
+		BuildResult result;
+		quickhull::QuickHull<float> qh;
+		qh.beginIncremental();
+		std::size_t const band(cloud.width * 64);
+		std::vector<vec3f> points;
+		for (std::size_t first(0); first < cloud.Size(); first += band)
+		{
+			std::size_t const count(std::min(band, cloud.Size() - first));
+			points.resize(count);
+			for (std::size_t i(0); i < count; ++i)
+				points[i] = cloud.View()[first + i];
+			qh.addPoints(points);
+			result.hull_points = std::max(result.hull_points, qh.getKeptPointCount());
+		}
+		SetHullSize(result, qh.getIncrementalHull(true));
+		result.failed_horizon_edges = qh.getDiagnostics().m_failedHorizonEdges;
+		return result;
+	}
+
+	std::vector<Config> MakeConfigs()
+	{
+		return {
+			{ "quickhull", "QuickHull, one thread, vectorized classification", [](PointCloud const &c) { return BuildQuickHull(c, 1, true); } },
+			{ "quickhull_scalar", "QuickHull, one thread, scalar classification", [](PointCloud const &c) { return BuildQuickHull(c, 1, false); } },
+			{ "quickhull_parallel", "QuickHull, every core", [](PointCloud const &c) { return BuildQuickHull(c, 0, true); } },
+			{ "packed", "QuickHull::getPackedConvexHull, one thread", [](PointCloud const &c) { return BuildPackedQuickHull(c); } },
+			{ "compact", "CompactQuickHull, one thread", [](PointCloud const &c) { return BuildCompactQuickHull(c, 1, false); } },
+			{ "prefilter_compact", "InteriorPointFilter then CompactQuickHull, every core (PaintLight without the occupancy grid)", [](PointCloud const &c) { return BuildCompactQuickHull(c, 0, true); } },
+			{ "exact", "IntegerQuickHull, integer clouds only", [](PointCloud const &c) { return BuildIntegerQuickHull(c); } },
+			{ "incremental", "QuickHull::addPoints with bands of 64 rows", [](PointCloud const &c) { return BuildIncrementalQuickHull(c); } },
+		};
+	}
+
+	/*
+	 * Checks
+	 */
+
+	// Tolerance of QuickHull for the cloud: eps times the largest absolute coordinate
+	double Tolerance(PointCloud const &cloud)
+	{
+		auto const points(cloud.View());
+		double scale(0.0);
+		for (std::size_t i(0); i < points.size(); ++i)
+			scale = std::max({ scale, double(std::abs(points[i].x)), double(std::abs(points[i].y)), double(std::abs(points[i].z)) });
+		return double(quickhull::defaultEps<float>::value) * scale;
+	}
+
+	// Largest signed distance of a point of the cloud to the plane of a hull face, in units of the tolerance. The triangles
+	// are CCW ones from ConvexHull or PackedConvexHull, whose (v2 - v0) x (v1 - v0) points outwards.
+	double MaxDistanceOutside(PointCloud const &cloud, quickhull::PackedConvexHull<float> const &hull)
+	{
+		auto const points(cloud.View());
+		auto const &vertices(hull.getVertexBuffer());
+		auto const &indices(hull.getIndexBuffer());
+		std::vector<std::array<double, 4>> planes;
+		for (std::size_t f(0); f + 2 < indices.size(); f += 3)
+		{
+			vec3f const &a(vertices[indices[f]]), &b(vertices[indices[f + 1]]), &c(vertices[indices[f + 2]]);
+			double const u[3] = { double(c.x) - a.x, double(c.y) - a.y, double(c.z) - a.z };
+			double const v[3] = { double(b.x) - a.x, double(b.y) - a.y, double(b.z) - a.z };
+			double n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+			double const length(std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]));
+			if (length == 0.0)
+				continue;
+			for (double &x : n)
+				x /= length;
+			planes.push_back({ n[0], n[1], n[2], -(n[0] * a.x + n[1] * a.y + n[2] * a.z) });
+		}
+		double const tolerance(Tolerance(cloud));
+		double worst(0.0);
+		for (std::size_t i(0); i < points.size(); ++i)
+		{
+			vec3f const &p(points[i]);
+			for (auto const &plane : planes)
+				worst = std::max(worst, plane[0] * p.x + plane[1] * p.y + plane[2] * p.z + plane[3]);
+		}
+		return tolerance > 0.0 ? worst / tolerance : 0.0;
+	}
+
+	// Largest signed distance of a hull vertex to a face plane of getPlanes, in units of the tolerance. Outward planes
+	// give at most the rounding of the plane equations, the vertices of the face itself being on it.
+	double MaxVertexInFront(PointCloud const &cloud, quickhull::PackedConvexHull<float> const &hull)
+	{
+		double const tolerance(Tolerance(cloud));
+		double worst(0.0);
+		for (auto const &plane : hull.getPlanes())
+			for (vec3f const &v : hull.getVertexBuffer())
+				worst = std::max(worst, double(plane.m_N.x) * v.x + double(plane.m_N.y) * v.y + double(plane.m_N.z) * v.z + plane.m_D);
+		return tolerance > 0.0 ? worst / tolerance : 0.0;
+	}
+
+	/*
+	 * JSON output
+	 */
+
+	std::string Quote(std::string const &text)
+	{
+		std::string quoted("\"");
+		for (char const c : text)
+		{
+			if (c == '"' || c == '\\')
+				quoted += '\\';
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				quoted += escaped;
+				continue;
+			}
+			quoted += c;
+		}
+		return quoted + "\"";
+	}
+
+	struct Options
+	{
+		std::size_t points = 1000000;
+		std::size_t repeat = 5;
+		std::uint32_t seed = 1;
+		std::vector<std::string> configs;
+		std::string media = HULL_BENCHMARK_MEDIA_DIR;
+		bool synthetic = true;
+		bool bundled = true;
+		bool check = false;
+		std::string label;
+		std::string output;
+		std::size_t batch = 0;
+		std::size_t batch_threads = 0;
+		std::vector<std::string> images;
+	};
+
+	std::vector<std::string> Split(std::string const &list)
+	{
+		std::vector<std::string> items;
+		std::stringstream stream(list);
+		for (std::string item; std::getline(stream, item, ',');)
+			if (!item.empty())
+				items.push_back(item);
+		return items;
+	}
+
+	void RunCloud(PointCloud const &cloud, std::vector<Config> const &configs, Options const &options, std::ostream &out, bool first_cloud)
+	{
+		out << (first_cloud ? "\n" : ",\n") << "    {\n";
+		out << "      \"name\": " << Quote(cloud.name) << ",\n";
+		out << "      \"source\": " << Quote(cloud.source) << ",\n";
+		out << "      \"points\": " << cloud.Size() << ",\n";
+		out << "      \"integer_coordinates\": " << (quickhull::IntegerQuickHull<float>::hasIntegerCoordinates(cloud.View()) ? "true" : "false") << ",\n";
+		out << "      \"results\": [";
+		bool first_result(true);
+		for (auto const &config : configs)
+		{
+			std::vector<double> seconds;
+			BuildResult result;
+			std::size_t peak_bytes(0);
+			for (std::size_t r(0); r < options.repeat; ++r)
+			{
+				std::size_t const heap_before(g_heap_in_use.load());
+				g_heap_peak.store(heap_before);
+				auto const start(std::chrono::steady_clock::now());
+				result = config.build(cloud);
+				seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+				peak_bytes = std::max(peak_bytes, g_heap_peak.load() - heap_before);
+				if (result.skipped)
+					break;
+			}
+			std::sort(seconds.begin(), seconds.end());
+
+			out << (first_result ? "\n" : ",\n") << "        {";
+			first_result = false;
+			out << "\"config\": " << Quote(config.name);
+			if (result.skipped)
+			{
+				out << ", \"skipped\": true}";
+				continue;
+			}
+			char line[512];
+			std::snprintf(line, sizeof(line),
+				", \"build_seconds_min\": %.6f, \"build_seconds_median\": %.6f, \"faces\": %zu, \"vertices\": %zu"
+				", \"failed_horizon_edges\": %zu, \"hull_points\": %zu",
+				seconds.front(), seconds[seconds.size() / 2], result.faces, result.vertices,
+				result.failed_horizon_edges, result.hull_points);
+			out << line;
+			if (result.hull_peak_bytes)
+				out << ", \"hull_peak_bytes\": " << result.hull_peak_bytes;
+			out << ", \"peak_heap_bytes\": " << peak_bytes;
+			double outside(0.0), in_front(0.0);
+			if (options.check)
+			{
+				if (!result.packed.getFaceCount())
+					result.packed = quickhull::PackedConvexHull<float>(result.hull.getIndexBuffer(), result.hull.getVertexBuffer(), true);
+				outside = MaxDistanceOutside(cloud, result.packed);
+				in_front = MaxVertexInFront(cloud, result.packed);
+				std::snprintf(line, sizeof(line), ", \"max_outside_eps\": %.4f, \"packed_vertex_in_front_eps\": %.4f", outside, in_front);
+				out << line;
+			}
+			out << "}";
+			std::cerr << cloud.name << " " << config.name << ": " << seconds.front() * 1000.0 << " ms, " << result.faces << " faces" << std::endl;
+			if (outside > 1.01)
+				std::cerr << "  " << cloud.name << " " << config.name << ": points up to " << outside << " times the tolerance outside the hull" << std::endl;
+			if (in_front > 0.01)
+				std::cerr << "  " << cloud.name << " " << config.name << ": hull vertices up to " << in_front << " times the tolerance in front of a packed face plane" << std::endl;
+		}
+		out << "\n      ]\n    }";
+	}
+
+	double Median(std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		return values.empty() ? 0.0 : values[values.size() / 2];
+	}
+
+	void RunBatch(std::vector<PointCloud> const &clouds, Options const &options, std::ostream &out)
+	{
+		std::vector<quickhull::VertexDataSource<float>> views;
+		std::size_t points(0);
+		for (std::size_t i(0); i < options.batch; ++i)
+		{
+			views.push_back(clouds[i % clouds.size()].View());
+			points += views.back().size();
+		}
+
+		// warm: one HullBatch for every repetition, fresh: a new one each time
+		quickhull::HullBatch<float> batch;
+		batch.setThreadCount(options.batch_threads);
+		double cold_seconds(0.0);
+		std::vector<double> warm_seconds, fresh_seconds;
+		std::vector<std::vector<double>> latency(views.size());
+		std::vector<quickhull::HullBatch<float>::Result> results;
+		for (std::size_t r(0); r <= options.repeat; ++r)
+		{
+			results = batch.build(views, true);
+			if (r == 0)
+				cold_seconds = batch.getSeconds();
+			else
+				warm_seconds.push_back(batch.getSeconds());
+			for (std::size_t i(0); r && i < results.size(); ++i)
+				latency[i].push_back(results[i].m_seconds);
+
+			quickhull::HullBatch<float> fresh;
+			fresh.setThreadCount(options.batch_threads);
+			fresh.build(views, true);
+			fresh_seconds.push_back(fresh.getSeconds());
+		}
+
+		double const warm(Median(warm_seconds));
+		char line[512];
+		out << ",\n  \"batch\": {\n";
+		std::snprintf(line, sizeof(line),
+			"    \"images\": %zu, \"points\": %zu, \"workers\": %zu, \"cold_seconds\": %.6f, \"warm_seconds_median\": %.6f"
+			", \"fresh_seconds_median\": %.6f, \"hulls_per_second\": %.3f, \"points_per_second\": %.0f,\n",
+			views.size(), points, batch.getWorkerCount(), cold_seconds, warm, Median(fresh_seconds),
+			warm > 0.0 ? views.size() / warm : 0.0, warm > 0.0 ? points / warm : 0.0);
+		out << line;
+		out << "    \"latency\": [";
+		for (std::size_t i(0); i < views.size(); ++i)
+		{
+			auto const &cloud(clouds[i % clouds.size()]);
+			std::snprintf(line, sizeof(line), "{\"cloud\": %s, \"seconds_median\": %.6f, \"faces\": %zu}",
+				Quote(cloud.name).c_str(), Median(latency[i]), results[i].m_hull.getIndexBuffer().size() / 3);
+			out << (i ? ",\n      " : "\n      ") << line;
+		}
+		out << "\n    ]\n  }";
+		std::cerr << "batch of " << views.size() << " on " << batch.getWorkerCount() << " workers: " << warm * 1000.0 << " ms warm, "
+			<< Median(fresh_seconds) * 1000.0 << " ms fresh" << std::endl;
+	}
+
+	void PrintUsage()
+	{
+		std::cerr << "usage: hull_benchmark [--points N] [--repeat N] [--seed N] [--config A,B] [--media DIR] [--no-synthetic] [--no-bundled] [--label TEXT] [--output FILE] [--check] [--batch N] [--batch-threads N] [--list] [image...]" << std::endl;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	Options options;
+	auto configs(MakeConfigs());
+	try
+	{
+		for (int i(1); i < argc; ++i)
+		{
+			std::string const arg(argv[i]);
+			auto const value = [&]() -> std::string {
+				if (i + 1 >= argc)
+					throw std::runtime_error(arg + " needs a value");
+				return argv[++i];
+			};
+			if (arg == "--points")
+				options.points = std::stoull(value());
+			else if (arg == "--repeat")
+				options.repeat = std::max<std::size_t>(1, std::stoull(value()));
+			else if (arg == "--seed")
+				options.seed = static_cast<std::uint32_t>(std::stoul(value()));
+			else if (arg == "--config")
+				options.configs = Split(value());
+			else if (arg == "--media")
+				options.media = value();
+			else if (arg == "--no-synthetic")
+				options.synthetic = false;
+			else if (arg == "--no-bundled")
+				options.bundled = false;
+			else if (arg == "--label")
+				options.label = value();
+			else if (arg == "--output")
+				options.output = value();
+			else if (arg == "--check")
+				options.check = true;
+			else if (arg == "--batch")
+				options.batch = std::stoull(value());
+			else if (arg == "--batch-threads")
+				options.batch_threads = std::stoull(value());
+			else if (arg == "--list")
+			{
+				for (auto const &config : configs)
+					std::cout << config.name << "\t" << config.description << "\n";
+				return 0;
+			}
+			else if (arg == "--help" || arg == "-h")
+			{
+				PrintUsage();
+				return 0;
+			}
+			else if (!arg.empty() && arg[0] == '-')
+				throw std::runtime_error("unknown option " + arg);
+			else
+				options.images.push_back(arg);
+		}
+		if (!options.configs.empty())
+		{
+			std::vector<Config> selected;
+			for (auto const &name : options.configs)
+			{
+				auto const it(std::find_if(configs.begin(), configs.end(), [&name](Config const &c) { return name == c.name; }));
+				if (it == configs.end())
+					throw std::runtime_error("unknown configuration " + name);
+				selected.push_back(*it);
+			}
+			configs = selected;
+		}
+
+		std::ofstream file;
+		if (!options.output.empty())
+		{
+			file.open(options.output);
+			if (!file)
+				throw std::runtime_error(options.output + ": cannot write");
+		}
+		std::ostream &out(options.output.empty() ? std::cout : file);
+
+		out << "{\n";
+		out << "  \"benchmark\": \"convex_hull\",\n";
+		out << "  \"revision\": " << Quote(HULL_BENCHMARK_REVISION) << ",\n";
+		out << "  \"label\": " << Quote(options.label) << ",\n";
+#if defined(__VERSION__)
+		out << "  \"compiler\": " << Quote(__VERSION__) << ",\n";
+#endif
+#if defined(__AVX2__)
+		out << "  \"avx2\": true,\n";
+#else
+		out << "  \"avx2\": false,\n";
+#endif
+		out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+		out << "  \"repeat\": " << options.repeat << ",\n";
+		out << "  \"clouds\": [";
+
+		std::vector<PointCloud> clouds;
+		if (options.synthetic)
+			clouds = MakeSyntheticClouds(options.points, options.seed);
+		std::vector<std::pair<std::string, std::string>> images;
+		if (options.bundled)
+			for (char const *name : { "mukyu.jpg", "original.png" })
+				images.emplace_back(options.media + "/" + name, "bundled");
+		for (auto const &path : options.images)
+			images.emplace_back(path, "image");
+		for (auto const &image : images)
+			clouds.push_back(LoadImage(image.first, image.second));
+
+		bool first_cloud(true);
+		for (auto const &cloud : clouds)
+		{
+			RunCloud(cloud, configs, options, out, first_cloud);
+			first_cloud = false;
+		}
+		out << "\n  ]";
+		if (options.batch && !clouds.empty())
+			RunBatch(clouds, options, out);
+		out << "\n}\n";
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << "hull_benchmark: " << e.what() << std::endl;
+		PrintUsage();
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// The quickhull sources include DXUT.h first for the precompiled header of the Windows build. They use nothing from it,
+// so the Linux benchmark compiles them against this empty header.
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Structs/Vector3.hpp"
+
+// 256^3 bit occupancy grid of 8-bit RGB colors (2 MB)
+// A hull vertex is an extreme point, so it is the lowest or highest b of its (r, g) column.
+// GetBoundaryColors emits only those two colors per column, at most 131072 points for any image size,
+// and the convex hull of them is the convex hull of every marked color.
+// QuickHull is not exact though: with other input points its epsilon keeps or drops other near coplanar vertices, so
+// the hull built from them only approximates the one built from every pixel.
+class ColorOccupancy
+{
+private:
+	static constexpr std::size_t WordsPerColumn = 256 / 32;
+
+	std::vector<std::uint32_t> m_bits; // bit b of column (r, g) is word (r * 256 + g) * 8 + b / 32
+	std::size_t m_occupied;
+public:
+	ColorOccupancy() : m_bits(256 * 256 * WordsPerColumn, 0), m_occupied(0)
+	{
+
+	}
+public:
+	std::size_t GetOccupiedCount() const { return m_occupied; }
+	std::size_t GetMemoryUsage() const { return m_bits.capacity() * sizeof(std::uint32_t); }
+
+	// marks count RGBA pixels (4 floats each), returns false at the first channel that is not an integer in [0, 255]
+	bool Mark(float const *src, std::size_t count)
+	{
+		for (std::size_t i(0); i < count; ++i, src += 4)
+		{
+			float const r(src[0]), g(src[1]), b(src[2]);
+			if (!IsByte(r) || !IsByte(g) || !IsByte(b))
+				return false;
+			Mark(static_cast<std::uint32_t>(r), static_cast<std::uint32_t>(g), static_cast<std::uint32_t>(b));
+		}
+		return true;
+	}
+
+	void Mark(std::uint32_t r, std::uint32_t g, std::uint32_t b)
+	{
+		std::uint32_t &word(m_bits[(r * 256 + g) * WordsPerColumn + b / 32]);
+		std::uint32_t const bit(std::uint32_t(1) << (b % 32));
+		m_occupied += (word & bit) ? 0 : 1;
+		word |= bit;
+	}
+
+	// lowest and highest b of every occupied (r, g) column, in r, g order
+	template<typename FloatType>
+	std::vector<quickhull::Vector3<FloatType>> GetBoundaryColors() const
+	{
+		std::vector<quickhull::Vector3<FloatType>> ret;
+		for (std::uint32_t column(0); column < 256 * 256; ++column)
+		{
+			std::uint32_t const *words(m_bits.data() + column * WordsPerColumn);
+			int lo(-1), hi(-1);
+			for (int w(0); w < int(WordsPerColumn); ++w)
+			{
+				if (words[w])
+				{
+					lo = w * 32 + LowestBit(words[w]);
+					break;
+				}
+			}
+			if (lo < 0)
+				continue;
+			for (int w(int(WordsPerColumn) - 1); w >= 0; --w)
+			{
+				if (words[w])
+				{
+					hi = w * 32 + HighestBit(words[w]);
+					break;
+				}
+			}
+			FloatType const r(static_cast<FloatType>(column / 256)), g(static_cast<FloatType>(column % 256));
+			ret.emplace_back(r, g, static_cast<FloatType>(lo));
+			if (hi != lo)
+				ret.emplace_back(r, g, static_cast<FloatType>(hi));
+		}
+		return ret;
+	}
+private:
+	static bool IsByte(float v)
+	{
+		return v >= 0.0f && v <= 255.0f && static_cast<float>(static_cast<std::uint32_t>(v)) == v;
+	}
+
+	static int LowestBit(std::uint32_t v)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, v);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctz(v);
+#endif
+	}
+
+	static int HighestBit(std::uint32_t v)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse(&index, v);
+		return static_cast<int>(index);
+#else
+		return 31 - __builtin_clz(v);
+#endif
+	}
+};
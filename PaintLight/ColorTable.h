@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+
+// Open-addressing hash table (linear probing) of the distinct RGB triplets of an image
+// Colors are compared bitwise and numbered in order of first appearance, GetColors returns them as RGBA
+class ColorTable
+{
+private:
+	static constexpr std::uint32_t Empty = 0xffffffffu;
+
+	struct Slot
+	{
+		std::uint32_t r, g, b;
+		std::uint32_t index;
+	};
+
+	std::vector<Slot> m_slots;
+	std::size_t m_mask;
+	std::vector<float> m_colors;
+public:
+	ColorTable() : m_mask(0)
+	{
+
+	}
+	explicit ColorTable(std::size_t expected) : m_mask(0)
+	{
+		Reserve(expected);
+	}
+public:
+	std::size_t size() const { return m_colors.size() / 4; }
+	std::size_t GetCapacity() const { return m_slots.size(); }
+	std::size_t GetMemoryUsage() const { return m_slots.capacity() * sizeof(Slot) + m_colors.capacity() * sizeof(float); }
+	float const *GetColors() const { return m_colors.data(); }
+
+	void Reserve(std::size_t expected)
+	{
+		std::size_t capacity(16);
+		while (capacity < expected * 2)
+			capacity *= 2;
+		if (capacity > m_slots.size())
+			Rehash(capacity);
+		m_colors.reserve(expected * 4);
+	}
+
+	// returns the index of the color, adding it if it was not seen before
+	std::uint32_t Insert(float r, float g, float b)
+	{
+		if ((size() + 1) * 2 > m_slots.size())
+			Rehash(std::max<std::size_t>(m_slots.size() * 2, 16));
+
+		std::uint32_t const kr(Bits(r)), kg(Bits(g)), kb(Bits(b));
+		std::size_t pos(Hash(kr, kg, kb) & m_mask);
+		for (;;)
+		{
+			Slot &slot(m_slots[pos]);
+			if (slot.index == Empty)
+			{
+				slot = Slot{ kr, kg, kb, static_cast<std::uint32_t>(size()) };
+				m_colors.push_back(r);
+				m_colors.push_back(g);
+				m_colors.push_back(b);
+				m_colors.push_back(255.0f);
+				return slot.index;
+			}
+			if (slot.r == kr && slot.g == kg && slot.b == kb)
+				return slot.index;
+			pos = (pos + 1) & m_mask;
+		}
+	}
+private:
+	static std::uint32_t Bits(float v)
+	{
+		std::uint32_t ret;
+		std::memcpy(std::addressof(ret), std::addressof(v), sizeof(ret));
+		return ret;
+	}
+
+	static std::size_t Hash(std::uint32_t r, std::uint32_t g, std::uint32_t b)
+	{
+		std::uint64_t h((static_cast<std::uint64_t>(r) * 0x9E3779B97F4A7C15ull) ^ (static_cast<std::uint64_t>(g) * 0xC2B2AE3D27D4EB4Full) ^ (static_cast<std::uint64_t>(b) * 0x165667B19E3779F9ull));
+		h ^= h >> 29;
+		h *= 0xBF58476D1CE4E5B9ull;
+		h ^= h >> 32;
+		return static_cast<std::size_t>(h);
+	}
+
+	void Rehash(std::size_t capacity)
+	{
+		std::vector<Slot> old(std::move(m_slots));
+		m_slots.assign(capacity, Slot{ 0, 0, 0, Empty });
+		m_mask = capacity - 1;
+		for (auto const &slot : old)
+		{
+			if (slot.index == Empty)
+				continue;
+			std::size_t pos(Hash(slot.r, slot.g, slot.b) & m_mask);
+			while (m_slots[pos].index != Empty)
+				pos = (pos + 1) & m_mask;
+			m_slots[pos] = slot;
+		}
+	}
+};
@@ -0,0 +1,735 @@
+#include "MathUtils.hpp"
+#include <cmath>
+#include <cassert>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include "DXUT.h"
+#include "CompactQuickHull.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace quickhull {
+
+	template<typename T>
+	void CompactQuickHull<T>::setThreadCount(size_t threads) {
+#ifdef _OPENMP
+		m_threadCount = threads ? threads : static_cast<size_t>(omp_get_max_threads());
+#else
+		m_threadCount = 1;
+#endif
+	}
+
+	template<typename T>
+	ConvexHull<T> CompactQuickHull<T>::getConvexHull(const std::vector<Vector3<T>>& pointCloud, bool CCW, bool useOriginalIndices, T epsilon) {
+		VertexDataSource<T> vertexDataSource(pointCloud);
+		return getConvexHull(vertexDataSource,CCW,useOriginalIndices,epsilon);
+	}
+
+	template<typename T>
+	ConvexHull<T> CompactQuickHull<T>::getConvexHull(const Vector3<T>* vertexData, size_t vertexCount, bool CCW, bool useOriginalIndices, T epsilon) {
+		VertexDataSource<T> vertexDataSource(vertexData,vertexCount);
+		return getConvexHull(vertexDataSource,CCW,useOriginalIndices,epsilon);
+	}
+
+	template<typename T>
+	ConvexHull<T> CompactQuickHull<T>::getConvexHull(const VertexDataSource<T>& pointCloud, bool CCW, bool useOriginalIndices, T epsilon) {
+		buildMesh(pointCloud,epsilon);
+
+		// Same face traversal as the ConvexHull half edge mesh constructor
+		std::vector<size_t> faceVertices;
+		const size_t faceCount = m_faceHalfEdge.size();
+		std::vector<bool> faceProcessed(faceCount,false);
+		std::vector<Index> faceStack;
+		for (Index i=0;i<faceCount;i++) {
+			if (!isFaceDisabled(i)) {
+				faceStack.push_back(i);
+				break;
+			}
+		}
+		faceVertices.reserve((faceCount-m_disabledFaces.size())*3);
+		while (faceStack.size()) {
+			const Index top = faceStack.back();
+			faceStack.pop_back();
+			if (faceProcessed[top]) {
+				continue;
+			}
+			faceProcessed[top] = true;
+			for (auto heIndex : getHalfEdgeIndicesOfFace(top)) {
+				const Index a = m_halfEdges[m_halfEdges[heIndex].m_opp].m_face;
+				if (!faceProcessed[a] && !isFaceDisabled(a)) {
+					faceStack.push_back(a);
+				}
+			}
+			for (auto v : getVertexIndicesOfFace(top)) {
+				faceVertices.push_back(v);
+			}
+		}
+		return ConvexHull<T>(faceVertices,m_vertexData,CCW,useOriginalIndices);
+	}
+
+	template<typename T>
+	std::vector<Plane<T>> CompactQuickHull<T>::getFacePlanes() const {
+		std::vector<Plane<T>> planes;
+		planes.reserve(m_faceHalfEdge.size() - m_disabledFaces.size());
+		for (Index i=0;i<m_faceHalfEdge.size();i++) {
+			if (!isFaceDisabled(i)) {
+				Plane<T> P;
+				P.m_N = m_faceNormal[i];
+				P.m_D = m_faceD[i];
+				P.m_sqrNLength = m_faceSqrNLength[i];
+				planes.push_back(P);
+			}
+		}
+		return planes;
+	}
+
+	template<typename T>
+	void CompactQuickHull<T>::buildMesh(const VertexDataSource<T>& pointCloud, T epsilon) {
+		m_halfEdges.clear();
+		m_faceHalfEdge.clear();
+		m_disabledFaces.clear();
+		m_disabledHalfEdges.clear();
+		m_points.clear();
+		m_livePointCount = 0;
+		m_peakMemory = 0;
+		if (pointCloud.size()==0) {
+			m_vertexData = pointCloud;
+			return;
+		}
+		// Point indices and the extra point of the planar case must fit below InvalidIndex
+		assert(pointCloud.size() < static_cast<size_t>(InvalidIndex)-1);
+		m_vertexData = pointCloud;
+
+		m_extremeValues = getExtremeValues();
+		m_scale = getScale(m_extremeValues);
+		m_epsilon = epsilon*m_scale;
+		m_epsilonSquared = m_epsilon*m_epsilon;
+		m_diagnostics = DiagnosticsData();
+
+		m_planar = false;
+		createConvexHalfEdgeMesh();
+		if (m_planar) {
+			const Index extraPointIndex = static_cast<Index>(m_vertexData.size());
+			for (auto& he : m_halfEdges) {
+				if (he.m_endVertex == extraPointIndex) {
+					he.m_endVertex = 0;
+				}
+			}
+		}
+	}
+
+	/*
+	 * Mesh
+	 */
+
+	template<typename T>
+	void CompactQuickHull<T>::setupMesh(Index a, Index b, Index c, Index d) {
+		// Same half edges and faces as MeshBuilder::setup
+		m_halfEdges = {
+			{b,6,0,1}, {c,9,0,2}, {a,3,0,0},
+			{c,2,1,4}, {d,11,1,5}, {a,7,1,3},
+			{a,0,2,7}, {d,5,2,8}, {b,10,2,6},
+			{b,1,3,10}, {d,8,3,11}, {c,4,3,9}
+		};
+		m_disabledFaces.clear();
+		m_disabledHalfEdges.clear();
+		m_faceHalfEdge.clear();
+		m_faceNormal.clear();
+		m_faceD.clear();
+		m_faceSqrNLength.clear();
+		m_faceMostDistantPointDist.clear();
+		m_faceMostDistantPoint.clear();
+		m_faceVisibilityChecked.clear();
+		m_faceFlags.clear();
+		m_facePointsBegin.clear();
+		m_facePointsCount.clear();
+		for (Index he : {0,3,6,9}) {
+			m_faceHalfEdge[addFace()] = he;
+		}
+	}
+
+	template<typename T>
+	typename CompactQuickHull<T>::Index CompactQuickHull<T>::addFace() {
+		if (m_disabledFaces.size()) {
+			// A reused face keeps its flags like MeshBuilder::addFace
+			const Index index = m_disabledFaces.back();
+			assert(isFaceDisabled(index) && m_facePointsCount[index]==0);
+			m_faceMostDistantPointDist[index] = 0;
+			m_disabledFaces.pop_back();
+			return index;
+		}
+		const Plane<T> P{};
+		m_faceHalfEdge.push_back(InvalidIndex);
+		m_faceNormal.push_back(P.m_N);
+		m_faceD.push_back(P.m_D);
+		m_faceSqrNLength.push_back(P.m_sqrNLength);
+		m_faceMostDistantPointDist.push_back(0);
+		m_faceMostDistantPoint.push_back(0);
+		m_faceVisibilityChecked.push_back(0);
+		m_faceFlags.push_back(0);
+		m_facePointsBegin.push_back(0);
+		m_facePointsCount.push_back(0);
+		return static_cast<Index>(m_faceHalfEdge.size()-1);
+	}
+
+	template<typename T>
+	typename CompactQuickHull<T>::Index CompactQuickHull<T>::addHalfEdge() {
+		if (m_disabledHalfEdges.size()) {
+			const Index index = m_disabledHalfEdges.back();
+			m_disabledHalfEdges.pop_back();
+			return index;
+		}
+		m_halfEdges.emplace_back();
+		return static_cast<Index>(m_halfEdges.size()-1);
+	}
+
+	template<typename T>
+	void CompactQuickHull<T>::disableFace(Index faceIndex) {
+		m_faceHalfEdge[faceIndex] = InvalidIndex;
+		m_disabledFaces.push_back(faceIndex);
+		m_livePointCount -= m_facePointsCount[faceIndex];
+		m_facePointsCount[faceIndex] = 0;
+	}
+
+	template<typename T>
+	void CompactQuickHull<T>::disableHalfEdge(Index heIndex) {
+		m_halfEdges[heIndex].m_endVertex = InvalidIndex;
+		m_disabledHalfEdges.push_back(heIndex);
+	}
+
+	template<typename T>
+	std::array<typename CompactQuickHull<T>::Index,3> CompactQuickHull<T>::getHalfEdgeIndicesOfFace(Index faceIndex) const {
+		const Index he = m_faceHalfEdge[faceIndex];
+		return {he,m_halfEdges[he].m_next,m_halfEdges[m_halfEdges[he].m_next].m_next};
+	}
+
+	template<typename T>
+	std::array<typename CompactQuickHull<T>::Index,3> CompactQuickHull<T>::getVertexIndicesOfFace(Index faceIndex) const {
+		const HalfEdge* he = &m_halfEdges[m_faceHalfEdge[faceIndex]];
+		std::array<Index,3> v;
+		v[0] = he->m_endVertex;
+		he = &m_halfEdges[he->m_next];
+		v[1] = he->m_endVertex;
+		he = &m_halfEdges[he->m_next];
+		v[2] = he->m_endVertex;
+		return v;
+	}
+
+	template<typename T>
+	void CompactQuickHull<T>::setFacePlane(Index faceIndex, const Plane<T>& P) {
+		m_faceNormal[faceIndex] = P.m_N;
+		m_faceD[faceIndex] = P.m_D;
+		m_faceSqrNLength[faceIndex] = P.m_sqrNLength;
+	}
+
+	/*
+	 * Point assignment
+	 */
+
+	template<typename T>
+	size_t CompactQuickHull<T>::getBlockCount(size_t count) const {
+		if (m_threadCount <= 1 || count < ParallelMinPoints) {
+			return 1;
+		}
+		return (count + ParallelBlockSize - 1) / ParallelBlockSize;
+	}
+
+	template<typename T>
+	template<typename F>
+	void CompactQuickHull<T>::forEachBlock(size_t count, F f) {
+		const size_t blockCount = getBlockCount(count);
+		if (blockCount == 1) {
+			f(0, 0, count);
+			return;
+		}
+#pragma omp parallel for schedule(dynamic, 1) num_threads(static_cast<int>(m_threadCount))
+		for (std::ptrdiff_t b = 0; b < static_cast<std::ptrdiff_t>(blockCount); b++) {
+			const size_t begin = static_cast<size_t>(b)*ParallelBlockSize;
+			f(static_cast<size_t>(b), begin, std::min(begin+ParallelBlockSize, count));
+		}
+	}
+
+	template<typename T>
+	template<typename Slot, typename PointAt>
+	void CompactQuickHull<T>::assignPointsToFaces(size_t pointCount, PointAt pointAt, const Index* faceIndices, size_t faceCount, size_t skipPoint) {
+		constexpr Slot NoSlot = std::numeric_limits<Slot>::max();
+		assert(faceCount < NoSlot);
+		m_candidatePlanes.resize(faceCount);
+		for (size_t j=0;j<faceCount;j++) {
+			const Index f = faceIndices[j];
+			m_candidatePlanes[j] = {m_faceNormal[f], m_faceD[f], m_epsilonSquared*m_faceSqrNLength[f]};
+		}
+
+		// Classify each point to the first face that has it on its positive side, counting the points and finding the most
+		// distant point (first of equals) of each face in each block
+		const size_t blockCount = getBlockCount(pointCount);
+		m_blockResults.assign(blockCount*faceCount,ClassificationResult<T>());
+		m_slotCounts.resize(blockCount*faceCount);
+		auto& pointSlots = getPointSlots<Slot>();
+		pointSlots.resize(pointCount);
+		Slot* slots = pointSlots.data();
+		forEachBlock(pointCount, [&](size_t block, size_t begin, size_t end) {
+			classifyPoints(m_vertexData, pointAt, begin, end, skipPoint, m_candidatePlanes.data(), faceCount, slots,
+						   &m_blockResults[block*faceCount], m_vectorizedClassification);
+		});
+
+		// Give the faces consecutive spans at the end of the arena, and each block its write position in them
+		size_t arenaEnd = m_points.size();
+		for (size_t j=0;j<faceCount;j++) {
+			const Index f = faceIndices[j];
+			assert(m_facePointsCount[f]==0);
+			m_facePointsBegin[f] = static_cast<Index>(arenaEnd);
+			for (size_t b=0;b<blockCount;b++) {
+				const auto& result = m_blockResults[b*faceCount+j];
+				m_slotCounts[b*faceCount+j] = static_cast<Index>(arenaEnd);
+				arenaEnd += result.m_count;
+				if (result.m_count && result.m_mostDistantDist > m_faceMostDistantPointDist[f]) {
+					m_faceMostDistantPointDist[f] = result.m_mostDistantDist;
+					m_faceMostDistantPoint[f] = pointAt(result.m_mostDistantPosition);
+				}
+			}
+			m_facePointsCount[f] = static_cast<Index>(arenaEnd-m_facePointsBegin[f]);
+			m_livePointCount += m_facePointsCount[f];
+		}
+		assert(arenaEnd < InvalidIndex);
+		m_points.resize(arenaEnd);
+
+		// Fill the spans in point order
+		Index* points = m_points.data();
+		forEachBlock(pointCount, [&](size_t block, size_t begin, size_t end) {
+			const Slot* const blockSlots = slots;
+			Index* const blockPoints = points;
+			const PointAt blockPointAt = pointAt;
+			Index* positions = &m_slotCounts[block*faceCount];
+			for (size_t i=begin;i<end;i++) {
+				const Slot slot = blockSlots[i];
+				if (slot != NoSlot) {
+					blockPoints[positions[slot]++] = blockPointAt(i);
+				}
+			}
+		});
+	}
+
+	template<typename T>
+	void CompactQuickHull<T>::compactPoints() {
+		// Live spans in arena order, so moving each one down never overwrites a span that has not been moved yet
+		std::vector<std::pair<Index,Index>> spans; // (begin, face)
+		for (Index f=0;f<m_faceHalfEdge.size();f++) {
+			if (m_facePointsCount[f]) {
+				spans.emplace_back(m_facePointsBegin[f],f);
+			}
+		}
+		std::sort(spans.begin(),spans.end());
+		Index end = 0;
+		for (const auto& s : spans) {
+			const Index f = s.second;
+			std::copy(m_points.begin()+s.first,m_points.begin()+s.first+m_facePointsCount[f],m_points.begin()+end);
+			m_facePointsBegin[f] = end;
+			end += m_facePointsCount[f];
+		}
+		assert(end == m_livePointCount);
+		m_points.resize(end);
+	}
+
+	template<typename T>
+	void CompactQuickHull<T>::updatePeakMemory() {
+		const size_t bytes = m_halfEdges.capacity()*sizeof(HalfEdge) +
+			m_faceHalfEdge.capacity()*(sizeof(Index)*6 + sizeof(vec3) + sizeof(T)*3 + sizeof(std::uint8_t)) +
+			(m_disabledFaces.capacity()+m_disabledHalfEdges.capacity()+m_points.capacity()+m_newFaceIndices.capacity()+m_newHalfEdgeIndices.capacity()+
+			 m_visibleFaces.capacity()+m_horizonEdges.capacity()+m_reassignedPoints.capacity()+m_pointFaceSlot.capacity()+m_slotCounts.capacity()+m_faceList.size())*sizeof(Index) +
+			m_candidatePlanes.capacity()*sizeof(ClassificationPlane<T>) + m_blockResults.capacity()*sizeof(ClassificationResult<T>) +
+			m_possiblyVisibleFaces.capacity()*sizeof(FaceData) +
+			m_pointFaceSlotByte.capacity();
+		m_peakMemory = std::max(m_peakMemory,bytes);
+	}
+
+	/*
+	 * Iteration
+	 */
+
+	template<typename T>
+	void CompactQuickHull<T>::createConvexHalfEdgeMesh() {
+		m_visibleFaces.clear();
+		m_horizonEdges.clear();
+		m_possiblyVisibleFaces.clear();
+
+		setupInitialTetrahedron();
+		assert(m_faceHalfEdge.size()==4);
+		updatePeakMemory();
+
+		m_faceList.clear();
+		for (Index i=0;i < 4;i++) {
+			if (m_facePointsCount[i]>0) {
+				m_faceList.push_back(i);
+				m_faceFlags[i] |= InFaceStackFlag;
+			}
+		}
+
+		Index iter = 0;
+		while (!m_faceList.empty()) {
+			iter++;
+			if (iter == InvalidIndex) {
+				iter = 0;
+			}
+
+			const Index topFaceIndex = m_faceList.front();
+			m_faceList.pop_front();
+			m_faceFlags[topFaceIndex] &= ~InFaceStackFlag;
+			if (m_facePointsCount[topFaceIndex]==0 || isFaceDisabled(topFaceIndex)) {
+				continue;
+			}
+
+			const Index activePointIndex = m_faceMostDistantPoint[topFaceIndex];
+			const vec3& activePoint = m_vertexData[activePointIndex];
+
+			// Visible faces and horizon edges
+			m_horizonEdges.clear();
+			m_possiblyVisibleFaces.clear();
+			m_visibleFaces.clear();
+			m_possiblyVisibleFaces.emplace_back(topFaceIndex,InvalidIndex);
+			while (m_possiblyVisibleFaces.size()) {
+				const auto faceData = m_possiblyVisibleFaces.back();
+				m_possiblyVisibleFaces.pop_back();
+				const Index fi = faceData.m_faceIndex;
+				assert(!isFaceDisabled(fi));
+
+				if (m_faceVisibilityChecked[fi] == iter) {
+					if (m_faceFlags[fi] & VisibleFlag) {
+						continue;
+					}
+				}
+				else {
+					m_faceVisibilityChecked[fi] = iter;
+					const T d = m_faceNormal[fi].dotProduct(activePoint)+m_faceD[fi];
+					if (d>0) {
+						m_faceFlags[fi] = (m_faceFlags[fi] & InFaceStackFlag) | VisibleFlag;
+						m_visibleFaces.push_back(fi);
+						for (auto heIndex : getHalfEdgeIndicesOfFace(fi)) {
+							if (m_halfEdges[heIndex].m_opp != faceData.m_enteredFromHalfEdge) {
+								m_possiblyVisibleFaces.emplace_back(m_halfEdges[m_halfEdges[heIndex].m_opp].m_face,heIndex);
+							}
+						}
+						continue;
+					}
+					assert(fi != topFaceIndex);
+				}
+
+				m_faceFlags[fi] &= ~VisibleFlag;
+				m_horizonEdges.push_back(faceData.m_enteredFromHalfEdge);
+				const Index enteredFace = m_halfEdges[faceData.m_enteredFromHalfEdge].m_face;
+				const auto halfEdges = getHalfEdgeIndicesOfFace(enteredFace);
+				const int ind = (halfEdges[0]==faceData.m_enteredFromHalfEdge) ? 0 : (halfEdges[1]==faceData.m_enteredFromHalfEdge ? 1 : 2);
+				m_faceFlags[enteredFace] |= static_cast<std::uint8_t>(1<<(ind+HorizonEdgeShift));
+			}
+			const size_t horizonEdgeCount = m_horizonEdges.size();
+
+			if (!reorderHorizonEdges(m_horizonEdges)) {
+				m_diagnostics.m_failedHorizonEdges++;
+				std::cerr << "Failed to solve horizon edge." << std::endl;
+				const auto first = m_points.begin()+m_facePointsBegin[topFaceIndex];
+				const auto last = first+m_facePointsCount[topFaceIndex];
+				std::copy(std::find(first,last,activePointIndex)+1,last,std::find(first,last,activePointIndex));
+				m_facePointsCount[topFaceIndex]--;
+				m_livePointCount--;
+				continue;
+			}
+
+			// Recycle the half edges of the visible faces and gather their points
+			m_newFaceIndices.clear();
+			m_newHalfEdgeIndices.clear();
+			m_reassignedPoints.clear();
+			size_t disableCounter = 0;
+			for (auto faceIndex : m_visibleFaces) {
+				const auto halfEdges = getHalfEdgeIndicesOfFace(faceIndex);
+				for (size_t j=0;j<3;j++) {
+					if ((m_faceFlags[faceIndex] & (1<<(j+HorizonEdgeShift))) == 0) {
+						if (disableCounter < horizonEdgeCount*2) {
+							m_newHalfEdgeIndices.push_back(halfEdges[j]);
+							disableCounter++;
+						}
+						else {
+							disableHalfEdge(halfEdges[j]);
+						}
+					}
+				}
+				const auto first = m_points.begin()+m_facePointsBegin[faceIndex];
+				m_reassignedPoints.insert(m_reassignedPoints.end(),first,first+m_facePointsCount[faceIndex]);
+				disableFace(faceIndex);
+			}
+			if (disableCounter < horizonEdgeCount*2) {
+				const size_t newHalfEdgesNeeded = horizonEdgeCount*2-disableCounter;
+				for (size_t i=0;i<newHalfEdgesNeeded;i++) {
+					m_newHalfEdgeIndices.push_back(addHalfEdge());
+				}
+			}
+
+			// New faces from the horizon edge loop to the active point
+			for (size_t i = 0; i < horizonEdgeCount; i++) {
+				const Index AB = m_horizonEdges[i];
+				const Index A = m_halfEdges[m_halfEdges[AB].m_opp].m_endVertex;
+				const Index B = m_halfEdges[AB].m_endVertex;
+				const Index C = activePointIndex;
+
+				const Index newFaceIndex = addFace();
+				m_newFaceIndices.push_back(newFaceIndex);
+
+				const Index CA = m_newHalfEdgeIndices[2*i+0];
+				const Index BC = m_newHalfEdgeIndices[2*i+1];
+
+				m_halfEdges[AB].m_next = BC;
+				m_halfEdges[BC].m_next = CA;
+				m_halfEdges[CA].m_next = AB;
+
+				m_halfEdges[BC].m_face = newFaceIndex;
+				m_halfEdges[CA].m_face = newFaceIndex;
+				m_halfEdges[AB].m_face = newFaceIndex;
+
+				m_halfEdges[CA].m_endVertex = A;
+				m_halfEdges[BC].m_endVertex = C;
+
+				const Vector3<T> planeNormal = mathutils::getTriangleNormal(getMeshVertex(A),getMeshVertex(B),activePoint);
+				setFacePlane(newFaceIndex,Plane<T>(planeNormal,activePoint));
+				m_faceHalfEdge[newFaceIndex] = AB;
+
+				m_halfEdges[CA].m_opp = m_newHalfEdgeIndices[i>0 ? i*2-1 : 2*horizonEdgeCount-1];
+				m_halfEdges[BC].m_opp = m_newHalfEdgeIndices[((i+1)*2) % (horizonEdgeCount*2)];
+			}
+
+			// The spans of the visible faces are garbage now, compact before appending the spans of the new faces
+			if (m_points.size() > MinCompactionSize && m_points.size()-m_livePointCount > m_livePointCount) {
+				compactPoints();
+			}
+			auto reassignedPointAt = [reassigned = m_reassignedPoints.data()](size_t i) { return reassigned[i]; };
+			if (horizonEdgeCount < std::numeric_limits<std::uint8_t>::max()) {
+				assignPointsToFaces<std::uint8_t>(m_reassignedPoints.size(), reassignedPointAt, m_newFaceIndices.data(), horizonEdgeCount, activePointIndex);
+			}
+			else {
+				assignPointsToFaces<Index>(m_reassignedPoints.size(), reassignedPointAt, m_newFaceIndices.data(), horizonEdgeCount, activePointIndex);
+			}
+			updatePeakMemory();
+
+			for (const auto newFaceIndex : m_newFaceIndices) {
+				if (m_facePointsCount[newFaceIndex]) {
+					if (!(m_faceFlags[newFaceIndex] & InFaceStackFlag)) {
+						m_faceList.push_back(newFaceIndex);
+						m_faceFlags[newFaceIndex] |= InFaceStackFlag;
+					}
+				}
+			}
+		}
+
+		// Cleanup
+		updatePeakMemory();
+		std::vector<Index>().swap(m_points);
+		std::vector<Index>().swap(m_pointFaceSlot);
+		std::vector<std::uint8_t>().swap(m_pointFaceSlotByte);
+		std::vector<Index>().swap(m_reassignedPoints);
+		std::vector<ClassificationResult<T>>().swap(m_blockResults);
+		std::fill(m_facePointsCount.begin(),m_facePointsCount.end(),0);
+	}
+
+	template <typename T>
+	std::array<size_t,6> CompactQuickHull<T>::getExtremeValues() {
+		struct Extremes {
+			T vals[6];
+			std::array<size_t,6> indices;
+		};
+		const Vector3<T>& first = m_vertexData[0];
+		const size_t vCount = m_vertexData.size();
+		std::vector<Extremes> blocks(getBlockCount(vCount), Extremes{{first.x,first.x,first.y,first.y,first.z,first.z},{0,0,0,0,0,0}});
+		forEachBlock(vCount, [&](size_t block, size_t begin, size_t end) {
+			T* extremeVals = blocks[block].vals;
+			std::array<size_t,6>& outIndices = blocks[block].indices;
+			for (size_t i=std::max<size_t>(begin,1);i<end;i++) {
+				const Vector3<T>& pos = m_vertexData[i];
+				if (pos.x>extremeVals[0]) {
+					extremeVals[0]=pos.x;
+					outIndices[0]=i;
+				}
+				else if (pos.x<extremeVals[1]) {
+					extremeVals[1]=pos.x;
+					outIndices[1]=i;
+				}
+				if (pos.y>extremeVals[2]) {
+					extremeVals[2]=pos.y;
+					outIndices[2]=i;
+				}
+				else if (pos.y<extremeVals[3]) {
+					extremeVals[3]=pos.y;
+					outIndices[3]=i;
+				}
+				if (pos.z>extremeVals[4]) {
+					extremeVals[4]=pos.z;
+					outIndices[4]=i;
+				}
+				else if (pos.z<extremeVals[5]) {
+					extremeVals[5]=pos.z;
+					outIndices[5]=i;
+				}
+			}
+		});
+		Extremes result = blocks[0];
+		for (size_t b=1;b<blocks.size();b++) {
+			for (size_t i=0;i<6;i++) {
+				const T v = blocks[b].vals[i];
+				if ((i%2==0) ? v>result.vals[i] : v<result.vals[i]) {
+					result.vals[i] = v;
+					result.indices[i] = blocks[b].indices[i];
+				}
+			}
+		}
+		return result.indices;
+	}
+
+	template<typename T>
+	bool CompactQuickHull<T>::reorderHorizonEdges(std::vector<Index>& horizonEdges) {
+		const size_t horizonEdgeCount = horizonEdges.size();
+		for (size_t i=0;i<horizonEdgeCount-1;i++) {
+			const Index endVertex = m_halfEdges[ horizonEdges[i] ].m_endVertex;
+			bool foundNext = false;
+			for (size_t j=i+1;j<horizonEdgeCount;j++) {
+				const Index beginVertex = m_halfEdges[ m_halfEdges[horizonEdges[j]].m_opp ].m_endVertex;
+				if (beginVertex == endVertex) {
+					std::swap(horizonEdges[i+1],horizonEdges[j]);
+					foundNext = true;
+					break;
+				}
+			}
+			if (!foundNext) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template <typename T>
+	T CompactQuickHull<T>::getScale(const std::array<size_t,6>& extremeValues) {
+		T s = 0;
+		for (size_t i=0;i<6;i++) {
+			const T* v = (const T*)(&m_vertexData[extremeValues[i]]);
+			v += i/2;
+			auto a = std::abs(*v);
+			if (a>s) {
+				s = a;
+			}
+		}
+		return s;
+	}
+
+	template<typename T>
+	void CompactQuickHull<T>::setupInitialTetrahedron() {
+		const size_t vertexCount = m_vertexData.size();
+
+		// Degenerate tetrahedra without planes or points, like QuickHull
+		if (vertexCount <= 4) {
+			Index v[4] = {0,static_cast<Index>(std::min((size_t)1,vertexCount-1)),static_cast<Index>(std::min((size_t)2,vertexCount-1)),static_cast<Index>(std::min((size_t)3,vertexCount-1))};
+			const Vector3<T> N = mathutils::getTriangleNormal(m_vertexData[v[0]],m_vertexData[v[1]],m_vertexData[v[2]]);
+			const Plane<T> trianglePlane(N,m_vertexData[v[0]]);
+			if (trianglePlane.isPointOnPositiveSide(m_vertexData[v[3]])) {
+				std::swap(v[0],v[1]);
+			}
+			return setupMesh(v[0],v[1],v[2],v[3]);
+		}
+
+		T maxD = m_epsilonSquared;
+		std::pair<size_t,size_t> selectedPoints;
+		for (size_t i=0;i<6;i++) {
+			for (size_t j=i+1;j<6;j++) {
+				const T d = m_vertexData[ m_extremeValues[i] ].getSquaredDistanceTo( m_vertexData[ m_extremeValues[j] ] );
+				if (d > maxD) {
+					maxD=d;
+					selectedPoints={m_extremeValues[i],m_extremeValues[j]};
+				}
+			}
+		}
+		if (maxD == m_epsilonSquared) {
+			return setupMesh(0,static_cast<Index>(std::min((size_t)1,vertexCount-1)),static_cast<Index>(std::min((size_t)2,vertexCount-1)),static_cast<Index>(std::min((size_t)3,vertexCount-1)));
+		}
+		assert(selectedPoints.first != selectedPoints.second);
+
+		const Ray<T> r(m_vertexData[selectedPoints.first], (m_vertexData[selectedPoints.second] - m_vertexData[selectedPoints.first]));
+		const size_t vCount = m_vertexData.size();
+		std::vector<std::pair<T,size_t>> blockMax(getBlockCount(vCount), {m_epsilonSquared,std::numeric_limits<size_t>::max()});
+		forEachBlock(vCount, [&](size_t block, size_t begin, size_t end) {
+			auto& bm = blockMax[block];
+			for (size_t i=begin;i<end;i++) {
+				const T distToRay = mathutils::getSquaredDistanceBetweenPointAndRay(m_vertexData[i],r);
+				if (distToRay > bm.first) {
+					bm = {distToRay,i};
+				}
+			}
+		});
+		maxD = m_epsilonSquared;
+		size_t maxI=std::numeric_limits<size_t>::max();
+		for (const auto& bm : blockMax) {
+			if (bm.first > maxD) {
+				maxD=bm.first;
+				maxI=bm.second;
+			}
+		}
+		if (maxD == m_epsilonSquared) {
+			auto it = std::find_if(m_vertexData.begin(),m_vertexData.end(),[&](const vec3& ve) {
+				return ve != m_vertexData[selectedPoints.first] && ve != m_vertexData[selectedPoints.second];
+			});
+			const size_t thirdPoint = (it == m_vertexData.end()) ? selectedPoints.first : std::distance(m_vertexData.begin(),it);
+			it = std::find_if(m_vertexData.begin(),m_vertexData.end(),[&](const vec3& ve) {
+				return ve != m_vertexData[selectedPoints.first] && ve != m_vertexData[selectedPoints.second] && ve != m_vertexData[thirdPoint];
+			});
+			const size_t fourthPoint = (it == m_vertexData.end()) ? selectedPoints.first : std::distance(m_vertexData.begin(),it);
+			return setupMesh(static_cast<Index>(selectedPoints.first),static_cast<Index>(selectedPoints.second),static_cast<Index>(thirdPoint),static_cast<Index>(fourthPoint));
+		}
+
+		assert(selectedPoints.first != maxI && selectedPoints.second != maxI);
+		std::array<size_t,3> baseTriangle{selectedPoints.first, selectedPoints.second, maxI};
+		const Vector3<T> baseTriangleVertices[]={ m_vertexData[baseTriangle[0]], m_vertexData[baseTriangle[1]],  m_vertexData[baseTriangle[2]] };
+
+		maxD=m_epsilon;
+		maxI=0;
+		const Vector3<T> N = mathutils::getTriangleNormal(baseTriangleVertices[0],baseTriangleVertices[1],baseTriangleVertices[2]);
+		Plane<T> trianglePlane(N,baseTriangleVertices[0]);
+		blockMax.assign(getBlockCount(vCount), {m_epsilon,0});
+		forEachBlock(vCount, [&](size_t block, size_t begin, size_t end) {
+			findMostDistantPoint(m_vertexData, begin, end, trianglePlane, blockMax[block], m_vectorizedClassification);
+		});
+		for (const auto& bm : blockMax) {
+			if (bm.first > maxD) {
+				maxD=bm.first;
+				maxI=bm.second;
+			}
+		}
+		if (maxD == m_epsilon) {
+			// Planar point cloud: add one extra point so that the hull has volume
+			m_planar = true;
+			const vec3 N = mathutils::getTriangleNormal(baseTriangleVertices[1],baseTriangleVertices[2],baseTriangleVertices[0]);
+			m_planarExtraPoint = N + m_vertexData[0];
+			maxI = vCount;
+		}
+
+		const Plane<T> triPlane(N,baseTriangleVertices[0]);
+		if (triPlane.isPointOnPositiveSide(getMeshVertex(maxI))) {
+			std::swap(baseTriangle[0],baseTriangle[1]);
+		}
+
+		setupMesh(static_cast<Index>(baseTriangle[0]),static_cast<Index>(baseTriangle[1]),static_cast<Index>(baseTriangle[2]),static_cast<Index>(maxI));
+		for (Index f=0;f<4;f++) {
+			auto v = getVertexIndicesOfFace(f);
+			const Vector3<T>& va = getMeshVertex(v[0]);
+			const Vector3<T>& vb = getMeshVertex(v[1]);
+			const Vector3<T>& vc = getMeshVertex(v[2]);
+			const Vector3<T> N = mathutils::getTriangleNormal(va, vb, vc);
+			setFacePlane(f,Plane<T>(N,va));
+		}
+
+		const Index faceIndices[4] = {0,1,2,3};
+		assignPointsToFaces<std::uint8_t>(vCount, [](size_t i) { return static_cast<Index>(i); }, faceIndices, 4, InvalidIndex);
+	}
+
+	/*
+	 * Explicit template specifications for float and double
+	 */
+
+	template class CompactQuickHull<float>;
+	template class CompactQuickHull<double>;
+}
@@ -0,0 +1,193 @@
+#ifndef COMPACTQUICKHULL_HPP_
+#define COMPACTQUICKHULL_HPP_
+#include <deque>
+#include <vector>
+#include <array>
+#include <limits>
+#include <cstdint>
+#include "Structs/Vector3.hpp"
+#include "Structs/Plane.hpp"
+#include "Structs/VertexDataSource.hpp"
+#include "ConvexHull.hpp"
+#include "MathUtils.hpp"
+#include "QuickHull.hpp"
+#include "PlaneKernels.hpp"
+
+/*
+ * QuickHull with a compact memory layout
+ *
+ * The same algorithm as QuickHull, giving the same hull with the same index and vertex buffers, with a different layout of
+ * the mesh it works on:
+ *   - half edge, face and point indices are 32-bit, so the point cloud can have at most 2^32-2 points
+ *   - the face data is kept in one array per field (SoA) instead of one struct per face
+ *   - the points on the positive side of all faces live in one arena, each face owns a span of it instead of a pooled
+ *     std::vector. The points of the faces removed by an extrusion are classified first and the new faces get exactly
+ *     sized spans at the end of the arena. Spans of removed faces become garbage, and the arena is compacted between
+ *     iterations when the garbage outweighs the live points.
+ *
+ * Point classification uses the same parallel blocks and kernels as QuickHull::setThreadCount and
+ * QuickHull::setVectorizedClassification.
+ * */
+
+namespace quickhull {
+
+	template<typename FloatType>
+	class CompactQuickHull {
+		using vec3 = Vector3<FloatType>;
+		using Index = std::uint32_t;
+		static constexpr Index InvalidIndex = std::numeric_limits<Index>::max();
+		static constexpr size_t ParallelBlockSize = 4096; // points per task
+		static constexpr size_t ParallelMinPoints = 32768; // fewer points are classified on the calling thread
+		static constexpr size_t MinCompactionSize = 65536; // arenas smaller than this are never compacted
+
+		struct HalfEdge {
+			Index m_endVertex;
+			Index m_opp;
+			Index m_face;
+			Index m_next;
+		};
+
+		// m_faceFlags bits
+		static constexpr std::uint8_t VisibleFlag = 1; // visible face on the iteration in m_faceVisibilityChecked
+		static constexpr std::uint8_t InFaceStackFlag = 2;
+		static constexpr std::uint8_t HorizonEdgeShift = 2; // one bit for each half edge of the face that is on the horizon
+
+		FloatType m_epsilon, m_epsilonSquared, m_scale;
+		bool m_planar;
+		vec3 m_planarExtraPoint; // apex added to a planar point cloud so that the hull has volume, vertex index m_vertexData.size()
+		VertexDataSource<FloatType> m_vertexData;
+		std::array<size_t,6> m_extremeValues;
+		DiagnosticsData m_diagnostics;
+		size_t m_threadCount = 1;
+		bool m_vectorizedClassification = true;
+
+		// Mesh, faces as SoA
+		std::vector<HalfEdge> m_halfEdges;
+		std::vector<Index> m_faceHalfEdge; // InvalidIndex for disabled faces
+		std::vector<vec3> m_faceNormal;
+		std::vector<FloatType> m_faceD;
+		std::vector<FloatType> m_faceSqrNLength;
+		std::vector<FloatType> m_faceMostDistantPointDist;
+		std::vector<Index> m_faceMostDistantPoint;
+		std::vector<Index> m_faceVisibilityChecked;
+		std::vector<std::uint8_t> m_faceFlags;
+		std::vector<Index> m_facePointsBegin, m_facePointsCount; // span of m_points
+		std::vector<Index> m_disabledFaces, m_disabledHalfEdges;
+
+		// Arena of the points on the positive side of the faces
+		std::vector<Index> m_points;
+		size_t m_livePointCount;
+		size_t m_peakMemory;
+
+		// Temporary variables used during iteration process
+		std::vector<Index> m_newFaceIndices;
+		std::vector<Index> m_newHalfEdgeIndices;
+		std::vector<Index> m_visibleFaces;
+		std::vector<Index> m_horizonEdges;
+		struct FaceData {
+			Index m_faceIndex;
+			Index m_enteredFromHalfEdge; // If the face turns out not to be visible, this half edge will be marked as horizon edge
+			FaceData(Index fi, Index he) : m_faceIndex(fi),m_enteredFromHalfEdge(he) {}
+		};
+		std::vector<FaceData> m_possiblyVisibleFaces;
+		std::deque<Index> m_faceList;
+		std::vector<Index> m_reassignedPoints;
+		std::vector<Index> m_pointFaceSlot; // candidate face of each point being assigned, when there are 255 or more
+		std::vector<std::uint8_t> m_pointFaceSlotByte; // the same for fewer candidates
+		std::vector<Index> m_slotCounts; // per block and face: write position in the arena
+		std::vector<ClassificationResult<FloatType>> m_blockResults; // per block and face
+		std::vector<ClassificationPlane<FloatType>> m_candidatePlanes;
+
+		void setupMesh(Index a, Index b, Index c, Index d);
+		Index addFace();
+		Index addHalfEdge();
+		void disableFace(Index faceIndex);
+		void disableHalfEdge(Index heIndex);
+		std::array<Index,3> getHalfEdgeIndicesOfFace(Index faceIndex) const;
+		std::array<Index,3> getVertexIndicesOfFace(Index faceIndex) const;
+		void setFacePlane(Index faceIndex, const Plane<FloatType>& P);
+		bool isFaceDisabled(Index faceIndex) const {
+			return m_faceHalfEdge[faceIndex] == InvalidIndex;
+		}
+
+		void setupInitialTetrahedron();
+		bool reorderHorizonEdges(std::vector<Index>& horizonEdges);
+		std::array<size_t,6> getExtremeValues();
+		FloatType getScale(const std::array<size_t,6>& extremeValues);
+		void createConvexHalfEdgeMesh();
+		void buildMesh(const VertexDataSource<FloatType>& pointCloud, FloatType eps);
+		const vec3& getMeshVertex(size_t index) const {
+			return index == m_vertexData.size() ? m_planarExtraPoint : m_vertexData[index];
+		}
+
+		size_t getBlockCount(size_t count) const;
+		template<typename F>
+		void forEachBlock(size_t count, F f);
+
+		// Gives each point pointAt(i), i in [0, pointCount), to the first of the faces it is on the positive side of (skipping
+		// skipPoint). The faces must have no points yet, their spans are appended to the arena in point order. The face of each
+		// point is kept as a Slot between counting and filling, so faceCount must be below the maximum of Slot.
+		template<typename Slot, typename PointAt>
+		void assignPointsToFaces(size_t pointCount, PointAt pointAt, const Index* faceIndices, size_t faceCount, size_t skipPoint);
+		template<typename Slot>
+		std::vector<Slot>& getPointSlots();
+
+		// Moves the live spans to the front of the arena, keeping their order
+		void compactPoints();
+		void updatePeakMemory();
+	public:
+		// Same parameters as the QuickHull functions of the same name
+		ConvexHull<FloatType> getConvexHull(const VertexDataSource<FloatType>& pointCloud,
+											bool CCW,
+											bool useOriginalIndices,
+											FloatType eps = defaultEps<FloatType>::value);
+		ConvexHull<FloatType> getConvexHull(const std::vector<Vector3<FloatType>>& pointCloud,
+											bool CCW,
+											bool useOriginalIndices,
+											FloatType eps = defaultEps<FloatType>::value);
+		ConvexHull<FloatType> getConvexHull(const Vector3<FloatType>* vertexData,
+											size_t vertexCount,
+											bool CCW,
+											bool useOriginalIndices,
+											FloatType eps = defaultEps<FloatType>::value);
+
+		void setThreadCount(size_t threads);
+		size_t getThreadCount() const {
+			return m_threadCount;
+		}
+
+		void setVectorizedClassification(bool enabled) {
+			m_vectorizedClassification = enabled;
+		}
+		bool getVectorizedClassification() const {
+			return m_vectorizedClassification;
+		}
+
+		const DiagnosticsData& getDiagnostics() {
+			return m_diagnostics;
+		}
+
+		// Highest number of bytes held by the mesh, the point arena and the temporary buffers during the last build
+		size_t getPeakMemoryUsage() const {
+			return m_peakMemory;
+		}
+
+		// Get the planes of the faces of last generated convex hull. Normals point outwards and are not normalized.
+		std::vector<Plane<FloatType>> getFacePlanes() const;
+	};
+
+	template<typename FloatType>
+	template<typename Slot>
+	std::vector<Slot>& CompactQuickHull<FloatType>::getPointSlots() {
+		if constexpr (sizeof(Slot) == 1) {
+			return m_pointFaceSlotByte;
+		}
+		else {
+			return m_pointFaceSlot;
+		}
+	}
+
+}
+
+
+#endif /* COMPACTQUICKHULL_HPP_ */
@@ -142,6 +142,42 @@ namespace quickhull {
 			}
 		}
 
+		// Construct vertex and index buffers from the vertex indices of the faces, three per face in half edge order and in the
+		// order of the face traversal above. Gives the same buffers as the half edge mesh constructor.
+		ConvexHull(const std::vector<size_t>& faceVertices, const VertexDataSource<T>& pointCloud, bool CCW, bool useOriginalIndices) {
+			if (!useOriginalIndices) {
+				m_optimizedVertexBuffer.reset(new std::vector<Vector3<T>>());
+			}
+			std::unordered_map<size_t,size_t> vertexIndexMapping;
+			const size_t iCCW = CCW ? 1 : 0;
+			m_indices.reserve(faceVertices.size());
+			for (size_t i=0;i+2<faceVertices.size();i+=3) {
+				std::array<size_t,3> vertices{faceVertices[i],faceVertices[i+1],faceVertices[i+2]};
+				if (!useOriginalIndices) {
+					for (auto& v : vertices) {
+						auto it = vertexIndexMapping.find(v);
+						if (it == vertexIndexMapping.end()) {
+							m_optimizedVertexBuffer->push_back(pointCloud[v]);
+							vertexIndexMapping[v] = m_optimizedVertexBuffer->size()-1;
+							v = m_optimizedVertexBuffer->size()-1;
+						}
+						else {
+							v = it->second;
+						}
+					}
+				}
+				m_indices.push_back(vertices[0]);
+				m_indices.push_back(vertices[1 + iCCW]);
+				m_indices.push_back(vertices[2 - iCCW]);
+			}
+			if (!useOriginalIndices) {
+				m_vertices = VertexDataSource<T>(*m_optimizedVertexBuffer);
+			}
+			else {
+				m_vertices = pointCloud;
+			}
+		}
+
 		std::vector<size_t>& getIndexBuffer() {
 			return m_indices;
 		}
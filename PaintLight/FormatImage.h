@@ -0,0 +1,296 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <tuple>
+#include <new>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <variant>
+#include <cmath>
+
+#include "ImageView.h"
+#include "PixelFormat.h"
+
+// RGBARGBARGBA... (or one sample per pixel with Channels 1) with samples of Format, rows start on ImageAlignment bytes
+// scale is the value of the largest UNORM sample: 255.0f for colors, 1.0f for the stroke density
+// RGBAImage is the FP32 image the GPU code and the decoder use, a FormatImage<PixelFormat::Float32> holds the same values,
+// a FormatImage<PixelFormat::Float32, 1> those of a ScalarImage
+template<PixelFormat Format, std::uint32_t Channels = 4>
+class FormatImage
+{
+public:
+	using Sample = typename PixelFormatTraits<Format>::Sample;
+
+	Sample *data;
+	std::uint32_t width, height;
+	std::size_t pitch; // samples from one row to the next
+	float scale;
+public:
+	explicit FormatImage(float scale = 255.0f) :data(nullptr), width(0), height(0), pitch(0), scale(scale)
+	{
+
+	}
+	~FormatImage()
+	{
+		Release();
+	}
+	FormatImage(FormatImage const &other) :data(nullptr), width(other.width), height(other.height), pitch(other.pitch), scale(other.scale)
+	{
+		if (other.data)
+		{
+			data = Allocate(pitch * height);
+			std::uninitialized_copy_n(other.data, pitch * height, data);
+		}
+	}
+	FormatImage &operator=(FormatImage const &other)
+	{
+		if (std::addressof(other) != this)
+		{
+			FormatImage copy(other);
+			*this = std::move(copy);
+		}
+		return *this;
+	}
+	FormatImage(FormatImage &&other) noexcept :data(other.data), width(other.width), height(other.height), pitch(other.pitch), scale(other.scale)
+	{
+		other.data = nullptr;
+		other.width = other.height = 0;
+		other.pitch = 0;
+	}
+	FormatImage &operator=(FormatImage &&other) noexcept
+	{
+		if (std::addressof(other) != this)
+		{
+			Release();
+			data = other.data;
+			width = other.width;
+			height = other.height;
+			pitch = other.pitch;
+			scale = other.scale;
+			other.data = nullptr;
+			other.width = other.height = 0;
+			other.pitch = 0;
+		}
+		return *this;
+	}
+	operator bool() const noexcept
+	{
+		return width != 0 && height != 0 && data != nullptr;
+	}
+public:
+	std::tuple<std::uint32_t, std::uint32_t> GetSize() const { return { width,height }; }
+	Sample *Row(std::uint32_t i) const { return data + i * pitch; }
+	std::size_t GetMemoryUsage() const { return data ? pitch * height * sizeof(Sample) : 0; }
+	// FP32 RGBA pixels are an ImageView as they are, e.g. for ImageDecoder on machines without RGBAImage
+	ImageView GetView() const
+	{
+		static_assert(Format == PixelFormat::Float32 && Channels == 4, "ImageView pixels are FP32 RGBA");
+		return ImageView(data, width, height, pitch, 0, PixelLayout::Interleaved);
+	}
+
+	void Setup(std::uint32_t width, std::uint32_t height)
+	{
+		std::size_t const samples(ImageAlignment / sizeof(Sample));
+		std::size_t const new_pitch((std::size_t(width) * Channels + samples - 1) / samples * samples);
+		Sample *new_data(Allocate(new_pitch * height));
+		std::fill_n(new_data, new_pitch * height, Sample(0));
+		Release();
+		this->width = width;
+		this->height = height;
+		this->pitch = new_pitch;
+		this->data = new_data;
+	}
+	void Release() noexcept
+	{
+		if (data)
+		{
+			::operator delete[](data, std::align_val_t(ImageAlignment));
+			data = nullptr;
+		}
+		width = height = 0;
+		pitch = 0;
+	}
+
+	// width pixels of row i from or to floats
+	void EncodeRow(std::uint32_t i, float const *src)
+	{
+		EncodeSamples<Format>(src, Row(i), std::size_t(width) * Channels, scale);
+	}
+	void DecodeRow(std::uint32_t i, float *dst) const
+	{
+		DecodeSamples<Format>(Row(i), dst, std::size_t(width) * Channels, scale);
+	}
+
+	// RGBA only
+	std::tuple<float, float, float> At(std::uint32_t i, std::uint32_t j) const
+	{
+		static_assert(Channels == 4, "At reads RGB");
+		float rgba[4];
+		DecodeSamples<Format>(Row(i) + j * 4, rgba, 4, scale);
+		return { rgba[0], rgba[1], rgba[2] };
+	}
+	void Set(std::uint32_t i, std::uint32_t j, float r2, float g2, float b2)
+	{
+		static_assert(Channels == 4, "Set writes RGB");
+		float rgb[3] = { r2, g2, b2 };
+		EncodeSamples<Format>(rgb, Row(i) + j * 4, 3, scale);
+	}
+	// one channel only
+	void Set(std::uint32_t i, std::uint32_t j, float k)
+	{
+		static_assert(Channels == 1, "Set writes one sample");
+		EncodeSamples<Format>(&k, Row(i) + j, 1, scale);
+	}
+
+	// set up with the size of src and encode its pixels, planar images are interleaved on the way (RGBA only)
+	void Encode(ImageView const &src)
+	{
+		static_assert(Channels == 4, "ImageView pixels are RGBA");
+		Setup(src.width, src.height);
+		std::vector<float> row(std::size_t(width) * 4);
+		ImageView const row_view(row.data(), width, 1, row.size(), 0, PixelLayout::Interleaved);
+		for (std::uint32_t i(0); i < height; ++i)
+		{
+			if (src.layout == PixelLayout::Interleaved)
+			{
+				EncodeRow(i, src.Row(i));
+				continue;
+			}
+			src.SubView(i, 0, 1, width).CopyTo(row_view);
+			EncodeRow(i, row.data());
+		}
+	}
+	// decode to an image of the same size
+	void Decode(ImageView const &dst) const
+	{
+		static_assert(Channels == 4, "ImageView pixels are RGBA");
+		std::vector<float> row(std::size_t(width) * 4);
+		ImageView const row_view(row.data(), width, 1, row.size(), 0, PixelLayout::Interleaved);
+		for (std::uint32_t i(0); i < std::min(height, dst.height); ++i)
+		{
+			DecodeRow(i, row.data());
+			row_view.SubView(0, 0, 1, dst.width).CopyTo(dst.SubView(i, 0, 1, dst.width));
+		}
+	}
+private:
+	static Sample *Allocate(std::size_t count)
+	{
+		return static_cast<Sample *>(::operator new[](count * sizeof(Sample), std::align_val_t(ImageAlignment)));
+	}
+};
+
+// a FormatImage whose format is picked at run time, Visit calls f with the FormatImage of that format
+template<std::uint32_t Channels = 4>
+class AnyFormatImage
+{
+	// alternatives in the order of PixelFormat
+	std::variant<FormatImage<PixelFormat::Float32, Channels>, FormatImage<PixelFormat::Float16, Channels>,
+		FormatImage<PixelFormat::UNorm16, Channels>, FormatImage<PixelFormat::UNorm8, Channels>> m_image;
+public:
+	explicit AnyFormatImage(PixelFormat format = PixelFormat::Float32, float scale = 255.0f)
+	{
+		Reset(format, scale);
+	}
+	operator bool() const noexcept
+	{
+		return Visit([](auto const &image) { return static_cast<bool>(image); });
+	}
+public:
+	PixelFormat GetFormat() const { return static_cast<PixelFormat>(m_image.index()); }
+	std::size_t GetMemoryUsage() const { return Visit([](auto const &image) { return image.GetMemoryUsage(); }); }
+
+	// an empty image of format, Setup through Visit
+	void Reset(PixelFormat format, float scale)
+	{
+		switch (format)
+		{
+		case PixelFormat::Float16:
+			m_image.template emplace<1>(scale);
+			break;
+		case PixelFormat::UNorm16:
+			m_image.template emplace<2>(scale);
+			break;
+		case PixelFormat::UNorm8:
+			m_image.template emplace<3>(scale);
+			break;
+		case PixelFormat::Float32:
+		default:
+			m_image.template emplace<0>(scale);
+			break;
+		}
+	}
+	void Release() noexcept
+	{
+		std::visit([](auto &image) { image.Release(); }, m_image);
+	}
+
+	template<typename F>
+	decltype(auto) Visit(F &&f)
+	{
+		return std::visit(std::forward<F>(f), m_image);
+	}
+	template<typename F>
+	decltype(auto) Visit(F &&f) const
+	{
+		return std::visit(std::forward<F>(f), m_image);
+	}
+};
+
+// RGB difference of an image against the FP32 image it approximates
+struct FormatError
+{
+	double max_error;
+	double rms_error;
+};
+
+template<PixelFormat Format>
+FormatError MeasureFormatError(ImageView const &reference, FormatImage<Format> const &image)
+{
+	FormatError error{ 0.0, 0.0 };
+	std::uint32_t const rows(std::min(reference.height, image.height)), columns(std::min(reference.width, image.width));
+	std::vector<float> row(std::size_t(image.width) * 4);
+	double sum(0.0);
+	for (std::uint32_t i(0); i < rows; ++i)
+	{
+		image.DecodeRow(i, row.data());
+		for (std::uint32_t j(0); j < columns; ++j)
+		{
+			auto const [r, g, b] = reference.At(i, j);
+			double const d[3] = { double(row[j * 4 + 0]) - r, double(row[j * 4 + 1]) - g, double(row[j * 4 + 2]) - b };
+			for (double const e : d)
+			{
+				error.max_error = std::max(error.max_error, std::fabs(e));
+				sum += e * e;
+			}
+		}
+	}
+	if (rows && columns)
+		error.rms_error = std::sqrt(sum / (double(rows) * columns * 3));
+	return error;
+}
+
+// a one channel image against the FP32 one it approximates, Reference is a ScalarImage or anything with float rows
+template<PixelFormat Format, typename Reference>
+FormatError MeasureFormatError(Reference const &reference, FormatImage<Format, 1> const &image)
+{
+	FormatError error{ 0.0, 0.0 };
+	std::uint32_t const rows(std::min(reference.height, image.height)), columns(std::min(reference.width, image.width));
+	std::vector<float> row(image.width);
+	double sum(0.0);
+	for (std::uint32_t i(0); i < rows; ++i)
+	{
+		image.DecodeRow(i, row.data());
+		float const *expected(reference.Row(i));
+		for (std::uint32_t j(0); j < columns; ++j)
+		{
+			double const e(double(row[j]) - expected[j]);
+			error.max_error = std::max(error.max_error, std::fabs(e));
+			sum += e * e;
+		}
+	}
+	if (rows && columns)
+		error.rms_error = std::sqrt(sum / (double(rows) * columns));
+	return error;
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+#include "RayIntersect.h"
+
+// Bounding volume hierarchy over the triangles of a convex hull, for rays from one origin
+// Intersect returns the hit with the lowest face index, which is exactly what the linear scan
+// over the index buffer returns, so the palette stays bit-identical to rayHullIntersectLinear
+class HullBVH
+{
+private:
+	static constexpr std::uint32_t LeafSize = 4;
+	static constexpr std::uint32_t StackSize = 64;
+
+	struct Node
+	{
+		vec3f bbMin, bbMax;
+		std::uint32_t first; // first child for inner nodes, first slot in m_order for leaves
+		std::uint32_t count; // number of faces for leaves, 0 for inner nodes
+		std::uint32_t minFace; // lowest face index in this subtree
+	};
+
+	std::vector<Node> m_nodes;
+	std::vector<std::uint32_t> m_order; // face indices, grouped by leaf
+	std::vector<RayTriangle> m_triangles; // per face, for rays from m_origin
+	std::vector<vec3f> m_faceMin, m_faceMax; // bounds of each face
+	std::vector<vec3f> m_centers;
+	vec3f m_origin;
+	std::uint32_t m_depth;
+	float m_padding;
+public:
+	HullBVH() : m_origin(0.0f, 0.0f, 0.0f), m_depth(0), m_padding(0.0f)
+	{
+
+	}
+	// origin: all rays start here
+	HullBVH(quickhull::PackedConvexHull<float> const &hull, vec3f const &origin) : m_origin(origin), m_depth(0), m_padding(0.0f)
+	{
+		std::size_t const faceCount(hull.getFaceCount());
+		if (faceCount == 0)
+			return;
+		m_triangles = MakeRayTriangles(origin, hull);
+		m_faceMin.reserve(faceCount);
+		m_faceMax.reserve(faceCount);
+		m_centers.reserve(faceCount);
+		m_order.reserve(faceCount);
+		auto const &indexBuffer(hull.getIndexBuffer());
+		auto const &vertexBuffer(hull.getVertexBuffer());
+		for (std::size_t f(0); f < faceCount; ++f)
+		{
+			auto const vertex1(vertexBuffer[indexBuffer[f * 3 + 0]]);
+			auto const vertex2(vertexBuffer[indexBuffer[f * 3 + 1]]);
+			auto const vertex3(vertexBuffer[indexBuffer[f * 3 + 2]]);
+			m_faceMin.emplace_back(std::min({ vertex1.x, vertex2.x, vertex3.x }), std::min({ vertex1.y, vertex2.y, vertex3.y }), std::min({ vertex1.z, vertex2.z, vertex3.z }));
+			m_faceMax.emplace_back(std::max({ vertex1.x, vertex2.x, vertex3.x }), std::max({ vertex1.y, vertex2.y, vertex3.y }), std::max({ vertex1.z, vertex2.z, vertex3.z }));
+			m_centers.push_back((vertex1 + vertex2 + vertex3) / 3.0f);
+			m_order.push_back(static_cast<std::uint32_t>(f));
+		}
+
+		// boxes are padded so that rays grazing an edge still reach the exact triangle test
+		vec3f bbMin, bbMax;
+		Bounds(0, static_cast<std::uint32_t>(faceCount), bbMin, bbMax);
+		m_padding = std::max({ bbMax.x - bbMin.x, bbMax.y - bbMin.y, bbMax.z - bbMin.z }) * 1e-4f + 1e-6f;
+
+		m_nodes.reserve(faceCount * 2);
+		m_nodes.emplace_back();
+		Build(0, 0, static_cast<std::uint32_t>(faceCount), 1);
+	}
+public:
+	std::size_t GetFaceCount() const { return m_order.size(); }
+	std::size_t GetNodeCount() const { return m_nodes.size(); }
+	std::uint32_t GetDepth() const { return m_depth; }
+	operator bool() const
+	{
+		return !m_nodes.empty();
+	}
+
+	// rays start at the origin the hierarchy was built for
+	std::tuple<bool, vec3f> Intersect(const vec3f &dir) const
+	{
+		if (m_nodes.empty())
+			return { false,vec3f(0,0,0) };
+
+		vec3f const invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+		std::uint32_t bestFace(std::numeric_limits<std::uint32_t>::max());
+		vec3f bestPoint(0, 0, 0);
+
+		std::uint32_t stack[StackSize];
+		std::uint32_t top(0);
+		stack[top++] = 0;
+		while (top)
+		{
+			Node const &node(m_nodes[stack[--top]]);
+			// a lower face index already hit, nothing in this subtree can replace it
+			if (node.minFace >= bestFace || !HitBox(node, m_origin, dir, invDir))
+				continue;
+			if (node.count)
+			{
+				for (std::uint32_t i(node.first); i < node.first + node.count; ++i)
+				{
+					std::uint32_t const f(m_order[i]);
+					if (f >= bestFace)
+						continue;
+					auto const [hit, hit_point] = rayTriangleIntersect(m_origin, dir, m_triangles[f]);
+					if (hit)
+					{
+						bestFace = f;
+						bestPoint = hit_point;
+					}
+				}
+			}
+			else
+			{
+				// visit the child holding the lower face index first
+				std::uint32_t const left(node.first), right(node.first + 1);
+				if (m_nodes[left].minFace < m_nodes[right].minFace)
+				{
+					stack[top++] = right;
+					stack[top++] = left;
+				}
+				else
+				{
+					stack[top++] = left;
+					stack[top++] = right;
+				}
+			}
+		}
+		if (bestFace == std::numeric_limits<std::uint32_t>::max())
+			return { false,vec3f(0,0,0) };
+		return { true,bestPoint };
+	}
+private:
+	void Bounds(std::uint32_t begin, std::uint32_t end, vec3f &bbMin, vec3f &bbMax) const
+	{
+		float const inf(std::numeric_limits<float>::infinity());
+		bbMin = vec3f(inf, inf, inf);
+		bbMax = vec3f(-inf, -inf, -inf);
+		for (std::uint32_t i(begin); i < end; ++i)
+		{
+			std::uint32_t const f(m_order[i]);
+			vec3f const &lo(m_faceMin[f]), &hi(m_faceMax[f]);
+			bbMin = vec3f(std::min(bbMin.x, lo.x), std::min(bbMin.y, lo.y), std::min(bbMin.z, lo.z));
+			bbMax = vec3f(std::max(bbMax.x, hi.x), std::max(bbMax.y, hi.y), std::max(bbMax.z, hi.z));
+		}
+	}
+
+	void Build(std::uint32_t nodeIndex, std::uint32_t begin, std::uint32_t end, std::uint32_t depth)
+	{
+		m_depth = std::max(m_depth, depth);
+		{
+			Node &node(m_nodes[nodeIndex]);
+			vec3f bbMin, bbMax;
+			Bounds(begin, end, bbMin, bbMax);
+			vec3f const pad(m_padding, m_padding, m_padding);
+			node.bbMin = bbMin - pad;
+			node.bbMax = bbMax + pad;
+			node.minFace = *std::min_element(m_order.begin() + begin, m_order.begin() + end);
+			node.first = begin;
+			node.count = end - begin;
+		}
+		// StackSize bounds the depth, the median split makes hitting it require far more faces than a hull has
+		if (end - begin <= LeafSize || depth + 1 >= StackSize / 2)
+			return;
+
+		// split at the median face center along the widest axis of the centers
+		float const inf(std::numeric_limits<float>::infinity());
+		vec3f cMin(inf, inf, inf), cMax(-inf, -inf, -inf);
+		for (std::uint32_t i(begin); i < end; ++i)
+		{
+			vec3f const &c(m_centers[m_order[i]]);
+			cMin = vec3f(std::min(cMin.x, c.x), std::min(cMin.y, c.y), std::min(cMin.z, c.z));
+			cMax = vec3f(std::max(cMax.x, c.x), std::max(cMax.y, c.y), std::max(cMax.z, c.z));
+		}
+		vec3f const extent(cMax - cMin);
+		int const axis(extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2));
+		auto const key = [this, axis](std::uint32_t f) {
+			vec3f const &c(m_centers[f]);
+			return axis == 0 ? c.x : (axis == 1 ? c.y : c.z);
+		};
+		std::uint32_t const mid(begin + (end - begin) / 2);
+		std::nth_element(m_order.begin() + begin, m_order.begin() + mid, m_order.begin() + end, [&key](std::uint32_t a, std::uint32_t b) {
+			return key(a) < key(b);
+		});
+
+		std::uint32_t const left(static_cast<std::uint32_t>(m_nodes.size()));
+		m_nodes.emplace_back();
+		m_nodes.emplace_back();
+		m_nodes[nodeIndex].first = left;
+		m_nodes[nodeIndex].count = 0;
+		Build(left, begin, mid, depth + 1);
+		Build(left + 1, mid, end, depth + 1);
+	}
+
+	bool HitBox(Node const &node, const vec3f &orig, const vec3f &dir, const vec3f &invDir) const
+	{
+		// the exit point lies in front of the centroid, allow the padding behind it for rays through an edge
+		float tmin(-m_padding), tmax(std::numeric_limits<float>::infinity());
+		float const o[3] = { orig.x, orig.y, orig.z };
+		float const d[3] = { dir.x, dir.y, dir.z };
+		float const inv[3] = { invDir.x, invDir.y, invDir.z };
+		float const lo[3] = { node.bbMin.x, node.bbMin.y, node.bbMin.z };
+		float const hi[3] = { node.bbMax.x, node.bbMax.y, node.bbMax.z };
+		for (int k(0); k < 3; ++k)
+		{
+			if (d[k] == 0.0f)
+			{
+				if (o[k] < lo[k] || o[k] > hi[k])
+					return false;
+				continue;
+			}
+			float t1((lo[k] - o[k]) * inv[k]);
+			float t2((hi[k] - o[k]) * inv[k]);
+			if (t1 > t2)
+				std::swap(t1, t2);
+			tmin = std::max(tmin, t1);
+			tmax = std::min(tmax, t2);
+			if (tmin > tmax)
+				return false;
+		}
+		return true;
+	}
+};
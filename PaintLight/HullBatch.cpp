@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <chrono>
+#include "DXUT.h"
+#include "HullBatch.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace quickhull {
+
+	template<typename T>
+	std::vector<typename HullBatch<T>::Result> HullBatch<T>::build(const std::vector<VertexDataSource<T>>& pointClouds, bool CCW, T epsilon) {
+		size_t threads = 1;
+#ifdef _OPENMP
+		threads = m_threadCount ? m_threadCount : static_cast<size_t>(omp_get_max_threads());
+#endif
+		threads = std::max<size_t>(1, std::min(threads, pointClouds.size()));
+		while (m_workers.size() < threads) {
+			m_workers.emplace_back(new QuickHull<T>());
+			m_workers.back()->setKeepBuffers(true);
+		}
+		for (auto& qh : m_workers) {
+			// one thread per hull, the batch is the parallelism
+			qh->setThreadCount(1);
+			qh->setVectorizedClassification(m_vectorizedClassification);
+		}
+
+		std::vector<Result> results(pointClouds.size());
+		const auto start = std::chrono::steady_clock::now();
+		const std::ptrdiff_t count = static_cast<std::ptrdiff_t>(pointClouds.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(static_cast<int>(threads))
+		for (std::ptrdiff_t i = 0; i < count; i++) {
+			size_t worker = 0;
+#ifdef _OPENMP
+			worker = static_cast<size_t>(omp_get_thread_num());
+#endif
+			auto& qh = *m_workers[worker];
+			auto& result = results[i];
+			const auto hullStart = std::chrono::steady_clock::now();
+			result.m_hull = qh.getConvexHull(pointClouds[i], CCW, false, epsilon);
+			result.m_facePlanes = qh.getFacePlanes();
+			result.m_diagnostics = qh.getDiagnostics();
+			result.m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - hullStart).count();
+			result.m_worker = worker;
+		}
+		m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		m_hullCount = pointClouds.size();
+		m_pointCount = 0;
+		for (const auto& pointCloud : pointClouds) {
+			m_pointCount += pointCloud.size();
+		}
+		return results;
+	}
+
+	template class HullBatch<float>;
+	template class HullBatch<double>;
+}
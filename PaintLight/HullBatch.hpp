@@ -0,0 +1,78 @@
+#ifndef HULLBATCH_HPP_
+#define HULLBATCH_HPP_
+#include <vector>
+#include <memory>
+#include "Structs/Plane.hpp"
+#include "Structs/VertexDataSource.hpp"
+#include "QuickHull.hpp"
+
+/*
+ * Convex hulls of many point clouds (e.g. the pixels of a batch of images) built concurrently
+ *
+ * Each cloud is built on one thread. Every worker thread has its own QuickHull, kept for the lifetime of the HullBatch
+ * with setKeepBuffers, so after the first batch the mesh, face lists, point lists and assignment buffers of a worker are
+ * reused from cloud to cloud instead of being allocated again. A QuickHull is only used by one thread at a time, as the
+ * class requires, and the hulls are the same as those of a fresh QuickHull per cloud.
+ * */
+
+namespace quickhull {
+
+	template<typename FloatType>
+	class HullBatch {
+	public:
+		struct Result {
+			ConvexHull<FloatType> m_hull; // own vertex buffer, independent of the point cloud
+			std::vector<Plane<FloatType>> m_facePlanes;
+			DiagnosticsData m_diagnostics;
+			double m_seconds = 0; // latency of this cloud: build time on its worker
+			size_t m_worker = 0;
+		};
+	private:
+		std::vector<std::unique_ptr<QuickHull<FloatType>>> m_workers;
+		size_t m_threadCount = 0;
+		bool m_vectorizedClassification = true;
+		
+		// Last batch
+		double m_seconds = 0;
+		size_t m_hullCount = 0;
+		size_t m_pointCount = 0;
+	public:
+		// Computes the convex hull of every point cloud, like QuickHull::getConvexHull(pointCloud, CCW, false, eps).
+		// Results are in the order of the point clouds.
+		std::vector<Result> build(const std::vector<VertexDataSource<FloatType>>& pointClouds,
+								  bool CCW,
+								  FloatType eps = defaultEps<FloatType>::value);
+		
+		// Number of clouds built at the same time, 0 for every core (1 if OpenMP is not enabled)
+		void setThreadCount(size_t threads) {
+			m_threadCount = threads;
+		}
+		size_t getThreadCount() const {
+			return m_threadCount;
+		}
+		
+		// See QuickHull::setVectorizedClassification
+		void setVectorizedClassification(bool enabled) {
+			m_vectorizedClassification = enabled;
+		}
+		
+		// Worker QuickHull objects created so far
+		size_t getWorkerCount() const {
+			return m_workers.size();
+		}
+		
+		// Wall time and throughput of the last build
+		double getSeconds() const {
+			return m_seconds;
+		}
+		double getHullsPerSecond() const {
+			return m_seconds > 0 ? m_hullCount/m_seconds : 0;
+		}
+		double getPointsPerSecond() const {
+			return m_seconds > 0 ? m_pointCount/m_seconds : 0;
+		}
+	};
+
+}
+
+#endif /* HULLBATCH_HPP_ */
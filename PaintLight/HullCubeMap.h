@@ -0,0 +1,256 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+
+#include "RayIntersect.h"
+
+// Cube map of directions around a point inside a convex hull
+// Every cell lists the faces whose solid angle seen from the origin overlaps the cell, in ascending face index order.
+// A ray is answered by looking up the cell of its direction and testing only those faces with rayTriangleIntersect
+// (on the triangle constants precomputed for the origin),
+// the first hit is the hit with the lowest face index, the same one rayHullIntersectLinear returns.
+// The map only depends on the hull and the origin, so it can be kept for any image with the same hull (see Matches).
+class HullCubeMap
+{
+public:
+	static constexpr std::uint32_t DefaultResolution = 64;
+private:
+	std::uint32_t m_resolution; // cells along the side of each cube face
+	vec3f m_origin;
+	std::vector<std::uint32_t> m_offsets; // candidates of cell c are m_candidates[m_offsets[c] .. m_offsets[c + 1])
+	std::vector<std::uint32_t> m_candidates;
+	std::vector<vec3f> m_vertices; // three vertices per face, in index buffer order
+	std::vector<RayTriangle> m_triangles; // per face, for rays from m_origin
+	std::uint32_t m_maxCandidates;
+public:
+	HullCubeMap() : m_resolution(0), m_origin(0.0f, 0.0f, 0.0f), m_maxCandidates(0)
+	{
+
+	}
+	// origin: a point inside the hull, all rays start here
+	// resolution: cells along the side of each of the six cube faces
+	HullCubeMap(quickhull::PackedConvexHull<float> const &hull, vec3f const &origin, std::uint32_t resolution = DefaultResolution) :
+		m_resolution(std::max<std::uint32_t>(resolution, 1)),
+		m_origin(origin),
+		m_maxCandidates(0)
+	{
+		std::size_t const faceCount(hull.getFaceCount());
+		m_vertices.reserve(faceCount * 3);
+		for (auto const i : hull.getIndexBuffer())
+			m_vertices.push_back(hull.getVertexBuffer()[i]);
+		m_triangles = MakeRayTriangles(origin, hull);
+
+		// (cell, face) pairs, faces come in ascending order so a stable counting sort keeps every cell sorted
+		std::vector<std::uint32_t> pairs;
+		for (std::uint32_t f(0); f < faceCount; ++f)
+			for (std::uint32_t side(0); side < 6; ++side)
+				Rasterize(f, side, pairs);
+
+		std::size_t const cellCount(GetCellCount());
+		m_offsets.assign(cellCount + 1, 0);
+		for (std::size_t i(0); i < pairs.size(); i += 2)
+			++m_offsets[pairs[i] + 1];
+		for (std::size_t c(0); c < cellCount; ++c)
+		{
+			m_maxCandidates = std::max(m_maxCandidates, m_offsets[c + 1]);
+			m_offsets[c + 1] += m_offsets[c];
+		}
+		m_candidates.resize(pairs.size() / 2);
+		std::vector<std::uint32_t> fill(m_offsets.begin(), m_offsets.end() - 1);
+		for (std::size_t i(0); i < pairs.size(); i += 2)
+			m_candidates[fill[pairs[i]]++] = pairs[i + 1];
+	}
+public:
+	std::size_t GetFaceCount() const { return m_vertices.size() / 3; }
+	std::size_t GetCellCount() const { return std::size_t(6) * m_resolution * m_resolution; }
+	std::uint32_t GetResolution() const { return m_resolution; }
+	std::uint32_t GetMaxCandidates() const { return m_maxCandidates; }
+	float GetAverageCandidates() const { return m_offsets.empty() ? 0.0f : float(m_candidates.size()) / float(GetCellCount()); }
+	std::size_t GetMemoryUsage() const
+	{
+		return m_offsets.capacity() * sizeof(std::uint32_t) + m_candidates.capacity() * sizeof(std::uint32_t) + m_vertices.capacity() * sizeof(vec3f) + m_triangles.capacity() * sizeof(RayTriangle);
+	}
+	operator bool() const
+	{
+		return !m_offsets.empty();
+	}
+
+	// true if this map was built for exactly this hull, origin and resolution
+	bool Matches(quickhull::PackedConvexHull<float> const &hull, vec3f const &origin, std::uint32_t resolution = DefaultResolution) const
+	{
+		auto const &indexBuffer(hull.getIndexBuffer());
+		auto const &vertexBuffer(hull.getVertexBuffer());
+		if (m_offsets.empty() || m_resolution != resolution || indexBuffer.size() != m_vertices.size())
+			return false;
+		if (m_origin.x != origin.x || m_origin.y != origin.y || m_origin.z != origin.z)
+			return false;
+		for (std::size_t i(0); i < m_vertices.size(); ++i)
+		{
+			auto const v(vertexBuffer[indexBuffer[i]]);
+			if (v.x != m_vertices[i].x || v.y != m_vertices[i].y || v.z != m_vertices[i].z)
+				return false;
+		}
+		return true;
+	}
+
+	// rays start at the origin the map was built for
+	std::tuple<bool, vec3f> Intersect(const vec3f &dir) const
+	{
+		if (m_offsets.empty())
+			return { false,vec3f(0,0,0) };
+		std::uint32_t const cell(Cell(dir));
+		if (cell == Invalid)
+			return { false,vec3f(0,0,0) };
+		for (std::uint32_t i(m_offsets[cell]); i < m_offsets[cell + 1]; ++i)
+		{
+			std::uint32_t const f(m_candidates[i]);
+			auto const [hit, hit_point] = rayTriangleIntersect(m_origin, dir, m_triangles[f]);
+			if (hit)
+				return { true,hit_point };
+		}
+		return { false,vec3f(0,0,0) };
+	}
+private:
+	static constexpr std::uint32_t Invalid = 0xffffffffu;
+	// faces are widened by this many cells so rays grazing a cell border still see every face they can hit
+	static constexpr float CellPadding = 0.05f;
+
+	// cube face side covers directions whose component on axis side / 2 has sign + for even and - for odd sides
+	// and dominates the other two, u and v are the other two components divided by it
+	static void Project(vec3f const &d, std::uint32_t side, float &major, float &u, float &v)
+	{
+		float const c[3] = { d.x, d.y, d.z };
+		std::uint32_t const axis(side / 2);
+		major = (side & 1) ? -c[axis] : c[axis];
+		u = c[(axis + 1) % 3];
+		v = c[(axis + 2) % 3];
+	}
+
+	std::uint32_t ToCell(float t) const
+	{
+		float const x((t + 1.0f) * 0.5f * float(m_resolution));
+		if (!(x > 0.0f))
+			return 0;
+		return std::min(static_cast<std::uint32_t>(x), m_resolution - 1);
+	}
+
+	std::uint32_t Cell(vec3f const &d) const
+	{
+		float const ax(std::fabs(d.x)), ay(std::fabs(d.y)), az(std::fabs(d.z));
+		std::uint32_t side;
+		if (ax >= ay && ax >= az)
+			side = d.x >= 0.0f ? 0 : 1;
+		else if (ay >= az)
+			side = d.y >= 0.0f ? 2 : 3;
+		else
+			side = d.z >= 0.0f ? 4 : 5;
+		float major, u, v;
+		Project(d, side, major, u, v);
+		// zero or NaN direction
+		if (!(major > 0.0f))
+			return Invalid;
+		return (side * m_resolution + ToCell(v / major)) * m_resolution + ToCell(u / major);
+	}
+
+	// add (cell, f) for every cell of cube face side that the solid angle of face f overlaps
+	void Rasterize(std::uint32_t f, std::uint32_t side, std::vector<std::uint32_t> &pairs) const
+	{
+		// the face clipped to the pyramid of directions of this cube face, |u| <= major and |v| <= major
+		std::vector<vec3f> poly{ m_vertices[f * 3 + 0] - m_origin, m_vertices[f * 3 + 1] - m_origin, m_vertices[f * 3 + 2] - m_origin };
+		for (int k(0); k < 4 && !poly.empty(); ++k)
+			poly = Clip(poly, side, k);
+		if (poly.empty())
+			return;
+
+		// gnomonic projection keeps straight edges straight, so the covered cells form a convex polygon
+		std::vector<float> pu, pv;
+		float uMin(1.0f), uMax(-1.0f), vMin(1.0f), vMax(-1.0f);
+		for (auto const &p : poly)
+		{
+			float major, u, v;
+			Project(p, side, major, u, v);
+			if (!(major > 0.0f))
+				continue;
+			pu.push_back(std::clamp(u / major, -1.0f, 1.0f));
+			pv.push_back(std::clamp(v / major, -1.0f, 1.0f));
+			uMin = std::min(uMin, pu.back());
+			uMax = std::max(uMax, pu.back());
+			vMin = std::min(vMin, pv.back());
+			vMax = std::max(vMax, pv.back());
+		}
+		if (pu.empty())
+			return;
+
+		float const cellSize(2.0f / float(m_resolution));
+		float const pad(cellSize * CellPadding);
+		std::uint32_t const i0(ToCell(uMin - pad)), i1(ToCell(uMax + pad));
+		std::uint32_t const j0(ToCell(vMin - pad)), j1(ToCell(vMax + pad));
+		for (std::uint32_t j(j0); j <= j1; ++j)
+		{
+			for (std::uint32_t i(i0); i <= i1; ++i)
+			{
+				float const cu0(-1.0f + float(i) * cellSize - pad), cu1(-1.0f + float(i + 1) * cellSize + pad);
+				float const cv0(-1.0f + float(j) * cellSize - pad), cv1(-1.0f + float(j + 1) * cellSize + pad);
+				if (!Separated(pu, pv, cu0, cu1, cv0, cv1))
+				{
+					pairs.push_back((side * m_resolution + j) * m_resolution + i);
+					pairs.push_back(f);
+				}
+			}
+		}
+	}
+
+	// keep the part of a polygon of directions on the inner side of plane k of the pyramid of cube face side
+	static std::vector<vec3f> Clip(std::vector<vec3f> const &poly, std::uint32_t side, int k)
+	{
+		auto const dist = [side, k](vec3f const &p) {
+			float major, u, v;
+			Project(p, side, major, u, v);
+			float const other(k < 2 ? u : v);
+			return (k & 1) ? major + other : major - other;
+		};
+		std::vector<vec3f> out;
+		for (std::size_t i(0); i < poly.size(); ++i)
+		{
+			vec3f const &a(poly[i]);
+			vec3f const &b(poly[(i + 1) % poly.size()]);
+			float const da(dist(a)), db(dist(b));
+			if (da >= 0.0f)
+				out.push_back(a);
+			if ((da >= 0.0f) != (db >= 0.0f))
+				out.push_back(a + (b - a) * (da / (da - db)));
+		}
+		return out;
+	}
+
+	// separating axis test between a convex polygon and a rectangle
+	static bool Separated(std::vector<float> const &pu, std::vector<float> const &pv, float u0, float u1, float v0, float v1)
+	{
+		if (*std::max_element(pu.begin(), pu.end()) < u0 || *std::min_element(pu.begin(), pu.end()) > u1)
+			return true;
+		if (*std::max_element(pv.begin(), pv.end()) < v0 || *std::min_element(pv.begin(), pv.end()) > v1)
+			return true;
+		std::size_t const n(pu.size());
+		for (std::size_t i(0); i < n; ++i)
+		{
+			std::size_t const next((i + 1) % n);
+			float const nu(pv[next] - pv[i]), nv(pu[i] - pu[next]);
+			float pMin(std::numeric_limits<float>::infinity()), pMax(-std::numeric_limits<float>::infinity());
+			for (std::size_t k(0); k < n; ++k)
+			{
+				float const d(pu[k] * nu + pv[k] * nv);
+				pMin = std::min(pMin, d);
+				pMax = std::max(pMax, d);
+			}
+			float const r0(u0 * nu + v0 * nv), r1(u1 * nu + v0 * nv), r2(u0 * nu + v1 * nv), r3(u1 * nu + v1 * nv);
+			if (std::max({ r0, r1, r2, r3 }) < pMin || std::min({ r0, r1, r2, r3 }) > pMax)
+				return true;
+		}
+		return false;
+	}
+};
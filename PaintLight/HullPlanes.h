@@ -0,0 +1,154 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "RayIntersect.h"
+#include "Structs/Plane.hpp"
+#include "HullPlanesKernels.h"
+
+// Convex hull as SoA plane arrays, for casting rays that start inside the hull
+// A ray o + t * d crosses plane i at t_i = s_i / (n_i . d) where s_i = -(n_i . o + D_i) > 0 for an interior o,
+// and it leaves the hull at the smallest positive t_i. With the normals prescaled by 1 / s_i this becomes
+// t = 1 / max_i(m_i . d), a dense max-reduction over all planes without the per-face branches of rayTriangleIntersect.
+// The pixel loop runs 16 (AVX-512) or 8 (AVX2) rays per step when the CPU has those instructions, checked once at run
+// time, and one ray per step otherwise. No kernel fuses a multiply and an add, so all of them give the scalar loop's bits.
+class HullPlanes
+{
+private:
+	struct KernelInfo
+	{
+		hullplanes::Kernel kernel; // null for the scalar loop
+		char const *name;
+	};
+
+	std::vector<float> m_x, m_y, m_z; // plane normals divided by the distance from the origin
+	vec3f m_origin;
+public:
+	HullPlanes() : m_origin(0.0f, 0.0f, 0.0f)
+	{
+
+	}
+	// planes: quickhull::Plane with outward normals, e.g. QuickHull::getFacePlanes
+	// origin: a point inside the hull, all rays start here
+	template<typename Planes>
+	HullPlanes(Planes const &planes, vec3f const &origin) : m_origin(origin)
+	{
+		m_x.reserve(planes.size());
+		m_y.reserve(planes.size());
+		m_z.reserve(planes.size());
+		for (auto const &plane : planes)
+		{
+			float const nx(static_cast<float>(plane.m_N.x));
+			float const ny(static_cast<float>(plane.m_N.y));
+			float const nz(static_cast<float>(plane.m_N.z));
+			float s(-(nx * origin.x + ny * origin.y + nz * origin.z + static_cast<float>(plane.m_D)));
+			// an origin on the plane (degenerate hull) makes every ray through that plane exit at the origin
+			s = std::max(s, 1e-20f);
+			m_x.push_back(nx / s);
+			m_y.push_back(ny / s);
+			m_z.push_back(nz / s);
+		}
+	}
+public:
+	std::size_t GetPlaneCount() const { return m_x.size(); }
+	static char const *GetKernelName() { return GetKernel().name; }
+
+	// dir does not need to be normalized, the hit is false only for a zero direction
+	std::tuple<bool, vec3f> Intersect(vec3f const &dir) const
+	{
+		float best(0.0f);
+		for (std::size_t p(0); p < m_x.size(); ++p)
+			best = std::max(best, m_x[p] * dir.x + m_y[p] * dir.y + m_z[p] * dir.z);
+		if (!(best > 0.0f))
+			return { false,vec3f(0,0,0) };
+		return { true,m_origin + dir * (1.0f / best) };
+	}
+
+	// exit points for the rays from the origin through count RGBA pixels (4 floats each)
+	// xyz of the exit point goes to dst, alpha is left untouched; hit[i] is 0 where the pixel equals the origin
+	void Intersect(float const *src, float *dst, std::uint8_t *hit, std::size_t count) const
+	{
+		std::size_t i(0);
+		if (hullplanes::Kernel const kernel = GetKernel().kernel)
+		{
+			float const origin[3] = { m_origin.x, m_origin.y, m_origin.z };
+			i = kernel(m_x.data(), m_y.data(), m_z.data(), m_x.size(), origin, src, dst, hit, count);
+		}
+		for (; i < count; ++i)
+		{
+			vec3f const dir(src[i * 4 + 0] - m_origin.x, src[i * 4 + 1] - m_origin.y, src[i * 4 + 2] - m_origin.z);
+			auto const [h, hit_point] = Intersect(dir);
+			hit[i] = h ? 1 : 0;
+			if (h)
+			{
+				dst[i * 4 + 0] = hit_point.x;
+				dst[i * 4 + 1] = hit_point.y;
+				dst[i * 4 + 2] = hit_point.z;
+			}
+		}
+	}
+private:
+	static KernelInfo const &GetKernel()
+	{
+		static KernelInfo const kernel(SelectKernel());
+		return kernel;
+	}
+
+	// the widest kernel the CPU and the operating system (saved register state in XCR0) support
+	static KernelInfo SelectKernel()
+	{
+#if defined(_M_X64) || defined(__x86_64__)
+		unsigned int info[4];
+		Cpuid(0, info);
+		if (info[0] < 7)
+			return { nullptr, "scalar" };
+		Cpuid(1, info);
+		bool const osxsave((info[2] >> 27) & 1), avx((info[2] >> 28) & 1);
+		if (!osxsave || !avx)
+			return { nullptr, "scalar" };
+		std::uint64_t const xcr0(GetXCR0());
+		Cpuid(7, info);
+		bool const avx2((info[1] >> 5) & 1), avx512f((info[1] >> 16) & 1);
+		// XMM, YMM and with AVX-512 the opmask and both halves of the ZMM registers
+		if (avx512f && (xcr0 & 0xE6) == 0xE6)
+			return { hullplanes::IntersectAVX512, "AVX-512" };
+		if (avx2 && (xcr0 & 0x6) == 0x6)
+			return { hullplanes::IntersectAVX2, "AVX2" };
+#endif
+		return { nullptr, "scalar" };
+	}
+
+#if defined(_M_X64) || defined(__x86_64__)
+	static void Cpuid(unsigned int leaf, unsigned int info[4])
+	{
+#if defined(_MSC_VER)
+		int regs[4];
+		__cpuidex(regs, static_cast<int>(leaf), 0);
+		for (int k(0); k < 4; ++k)
+			info[k] = static_cast<unsigned int>(regs[k]);
+#else
+		__cpuid_count(leaf, 0, info[0], info[1], info[2], info[3]);
+#endif
+	}
+
+	static std::uint64_t GetXCR0()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int lo, hi;
+		__asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		return (std::uint64_t(hi) << 32) | lo;
+#endif
+	}
+#endif
+};
@@ -0,0 +1,65 @@
+#include <immintrin.h>
+#include "HullPlanesKernels.h"
+
+namespace hullplanes
+{
+	std::size_t IntersectAVX2(float const *x, float const *y, float const *z, std::size_t planes, float const origin[3],
+		float const *src, float *dst, std::uint8_t *hit, std::size_t count)
+	{
+		std::size_t i(0);
+		for (; i + 8 <= count; i += 8, src += 32, dst += 32, hit += 8)
+		{
+			alignas(32) float dx[8], dy[8], dz[8];
+			for (std::size_t k(0); k < 8; ++k)
+			{
+				dx[k] = src[k * 4 + 0] - origin[0];
+				dy[k] = src[k * 4 + 1] - origin[1];
+				dz[k] = src[k * 4 + 2] - origin[2];
+			}
+			__m256 const vx(_mm256_load_ps(dx));
+			__m256 const vy(_mm256_load_ps(dy));
+			__m256 const vz(_mm256_load_ps(dz));
+
+			// two accumulators to hide the latency of the max chain
+			__m256 best0(_mm256_setzero_ps()), best1(_mm256_setzero_ps());
+			std::size_t p(0);
+			for (; p + 2 <= planes; p += 2)
+			{
+				__m256 q0(_mm256_mul_ps(_mm256_set1_ps(x[p]), vx));
+				__m256 q1(_mm256_mul_ps(_mm256_set1_ps(x[p + 1]), vx));
+				q0 = _mm256_add_ps(q0, _mm256_mul_ps(_mm256_set1_ps(y[p]), vy));
+				q1 = _mm256_add_ps(q1, _mm256_mul_ps(_mm256_set1_ps(y[p + 1]), vy));
+				q0 = _mm256_add_ps(q0, _mm256_mul_ps(_mm256_set1_ps(z[p]), vz));
+				q1 = _mm256_add_ps(q1, _mm256_mul_ps(_mm256_set1_ps(z[p + 1]), vz));
+				best0 = _mm256_max_ps(best0, q0);
+				best1 = _mm256_max_ps(best1, q1);
+			}
+			for (; p < planes; ++p)
+			{
+				__m256 q(_mm256_mul_ps(_mm256_set1_ps(x[p]), vx));
+				q = _mm256_add_ps(q, _mm256_mul_ps(_mm256_set1_ps(y[p]), vy));
+				q = _mm256_add_ps(q, _mm256_mul_ps(_mm256_set1_ps(z[p]), vz));
+				best0 = _mm256_max_ps(best0, q);
+			}
+			__m256 const best(_mm256_max_ps(best0, best1));
+			__m256 const t(_mm256_div_ps(_mm256_set1_ps(1.0f), best));
+
+			alignas(32) float hx[8], hy[8], hz[8];
+			_mm256_store_ps(hx, _mm256_add_ps(_mm256_set1_ps(origin[0]), _mm256_mul_ps(vx, t)));
+			_mm256_store_ps(hy, _mm256_add_ps(_mm256_set1_ps(origin[1]), _mm256_mul_ps(vy, t)));
+			_mm256_store_ps(hz, _mm256_add_ps(_mm256_set1_ps(origin[2]), _mm256_mul_ps(vz, t)));
+			int const mask(_mm256_movemask_ps(_mm256_cmp_ps(best, _mm256_setzero_ps(), _CMP_GT_OQ)));
+			for (std::size_t k(0); k < 8; ++k)
+			{
+				hit[k] = (mask >> k) & 1;
+				if (hit[k])
+				{
+					dst[k * 4 + 0] = hx[k];
+					dst[k * 4 + 1] = hy[k];
+					dst[k * 4 + 2] = hz[k];
+				}
+			}
+		}
+		return i;
+	}
+}
@@ -0,0 +1,65 @@
+#include <immintrin.h>
+#include "HullPlanesKernels.h"
+
+namespace hullplanes
+{
+	std::size_t IntersectAVX512(float const *x, float const *y, float const *z, std::size_t planes, float const origin[3],
+		float const *src, float *dst, std::uint8_t *hit, std::size_t count)
+	{
+		std::size_t i(0);
+		for (; i + 16 <= count; i += 16, src += 64, dst += 64, hit += 16)
+		{
+			alignas(64) float dx[16], dy[16], dz[16];
+			for (std::size_t k(0); k < 16; ++k)
+			{
+				dx[k] = src[k * 4 + 0] - origin[0];
+				dy[k] = src[k * 4 + 1] - origin[1];
+				dz[k] = src[k * 4 + 2] - origin[2];
+			}
+			__m512 const vx(_mm512_load_ps(dx));
+			__m512 const vy(_mm512_load_ps(dy));
+			__m512 const vz(_mm512_load_ps(dz));
+
+			// two accumulators to hide the latency of the max chain
+			__m512 best0(_mm512_setzero_ps()), best1(_mm512_setzero_ps());
+			std::size_t p(0);
+			for (; p + 2 <= planes; p += 2)
+			{
+				__m512 q0(_mm512_mul_ps(_mm512_set1_ps(x[p]), vx));
+				__m512 q1(_mm512_mul_ps(_mm512_set1_ps(x[p + 1]), vx));
+				q0 = _mm512_add_ps(q0, _mm512_mul_ps(_mm512_set1_ps(y[p]), vy));
+				q1 = _mm512_add_ps(q1, _mm512_mul_ps(_mm512_set1_ps(y[p + 1]), vy));
+				q0 = _mm512_add_ps(q0, _mm512_mul_ps(_mm512_set1_ps(z[p]), vz));
+				q1 = _mm512_add_ps(q1, _mm512_mul_ps(_mm512_set1_ps(z[p + 1]), vz));
+				best0 = _mm512_max_ps(best0, q0);
+				best1 = _mm512_max_ps(best1, q1);
+			}
+			for (; p < planes; ++p)
+			{
+				__m512 q(_mm512_mul_ps(_mm512_set1_ps(x[p]), vx));
+				q = _mm512_add_ps(q, _mm512_mul_ps(_mm512_set1_ps(y[p]), vy));
+				q = _mm512_add_ps(q, _mm512_mul_ps(_mm512_set1_ps(z[p]), vz));
+				best0 = _mm512_max_ps(best0, q);
+			}
+			__m512 const best(_mm512_max_ps(best0, best1));
+			__m512 const t(_mm512_div_ps(_mm512_set1_ps(1.0f), best));
+
+			alignas(64) float hx[16], hy[16], hz[16];
+			_mm512_store_ps(hx, _mm512_add_ps(_mm512_set1_ps(origin[0]), _mm512_mul_ps(vx, t)));
+			_mm512_store_ps(hy, _mm512_add_ps(_mm512_set1_ps(origin[1]), _mm512_mul_ps(vy, t)));
+			_mm512_store_ps(hz, _mm512_add_ps(_mm512_set1_ps(origin[2]), _mm512_mul_ps(vz, t)));
+			__mmask16 const mask(_mm512_cmp_ps_mask(best, _mm512_setzero_ps(), _CMP_GT_OQ));
+			for (std::size_t k(0); k < 16; ++k)
+			{
+				hit[k] = (mask >> k) & 1;
+				if (hit[k])
+				{
+					dst[k * 4 + 0] = hx[k];
+					dst[k * 4 + 1] = hy[k];
+					dst[k * 4 + 2] = hz[k];
+				}
+			}
+		}
+		return i;
+	}
+}
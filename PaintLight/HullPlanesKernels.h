@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Vector kernels of HullPlanes::Intersect, each in its own translation unit compiled for its instruction set
+// (HullPlanesAVX2.cpp with /arch:AVX2, HullPlanesAVX512.cpp with /arch:AVX512). They include nothing but the
+// intrinsics so no inline function of a shared header is compiled with those instructions, and HullPlanes only calls
+// the one the CPU supports. Each solves the first count rounded down to its width of pixels and returns that number.
+// The dot products are a multiply and an add per term, without fused multiply-adds, like the scalar loop.
+namespace hullplanes
+{
+	using Kernel = std::size_t (*)(float const *x, float const *y, float const *z, std::size_t planes, float const origin[3],
+		float const *src, float *dst, std::uint8_t *hit, std::size_t count);
+
+	std::size_t IntersectAVX2(float const *x, float const *y, float const *z, std::size_t planes, float const origin[3],
+		float const *src, float *dst, std::uint8_t *hit, std::size_t count);
+	std::size_t IntersectAVX512(float const *x, float const *y, float const *z, std::size_t planes, float const origin[3],
+		float const *src, float *dst, std::uint8_t *hit, std::size_t count);
+}
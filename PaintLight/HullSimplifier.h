@@ -0,0 +1,437 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+#include <algorithm>
+
+#include "RayIntersect.h"
+#include "Structs/Plane.hpp"
+
+// Convex hull with at most a given number of faces or vertices that still encloses the input hull
+// The hull is the intersection of the half-spaces of its face planes. Dropping a plane only grows it, by the
+// "cap" between the dropped plane and the planes around it, so planes are dropped greedily in order of
+// smallest cap volume until the budget is met. Near-coplanar faces of noisy hulls have caps of almost no
+// volume and go first. Only the caps that the dropped plane bounded change, so only those are recomputed.
+// The output uses the index buffer winding of QuickHull::getConvexHull with CCW set, faces are planar polygons
+// triangulated as fans, so GetTriangleCount can be larger than GetFaceCount.
+class HullSimplifier
+{
+private:
+	using vec3d = quickhull::Vector3<double>;
+
+	struct Polygon
+	{
+		std::vector<vec3d> points;
+		vec3d n; // outward unit normal
+		double d;
+		std::int32_t plane; // index into m_planes, -1 for the bounding box
+	};
+	using Polyhedron = std::vector<Polygon>;
+
+	struct Cap
+	{
+		double volume;
+		std::uint32_t plane;
+		std::uint32_t version;
+		bool operator<(Cap const &other) const { return volume > other.volume; }
+	};
+
+	std::vector<vec3d> m_n; // outward unit normals of the input planes
+	std::vector<double> m_d;
+	std::vector<std::uint8_t> m_alive;
+	std::vector<std::vector<std::uint32_t>> m_near; // planes with the closest normals, tried first to shrink a cap quickly
+	std::vector<std::uint32_t> m_version; // stale caps in the queue have an older version
+	std::vector<std::vector<std::uint32_t>> m_bounded; // caps that plane i bounds
+	std::priority_queue<Cap> m_queue;
+	vec3d m_boxMin, m_boxMax;
+	double m_epsilon;
+	static constexpr std::size_t NearPlanes = 24;
+
+	std::vector<vec3f> m_vertices;
+	std::vector<std::size_t> m_indices;
+	std::vector<quickhull::Plane<float>> m_planes;
+	double m_volume, m_originalVolume;
+public:
+	HullSimplifier() : m_epsilon(0.0), m_volume(0.0), m_originalVolume(0.0)
+	{
+
+	}
+	// planes: outward face planes of the hull, e.g. QuickHull::getFacePlanes
+	// indexBuffer, vertexBuffer: the triangles of the same hull, for its volume and bounds
+	// maxFaces, maxVertices: budgets, 0 for no limit
+	template<typename Planes, typename IndexBuffer, typename VertexBuffer>
+	HullSimplifier(Planes const &planes, IndexBuffer const &indexBuffer, VertexBuffer const &vertexBuffer, std::size_t maxFaces, std::size_t maxVertices) :
+		m_epsilon(0.0),
+		m_volume(0.0),
+		m_originalVolume(0.0)
+	{
+		if (indexBuffer.size() < 12)
+			return;
+		double const inf(std::numeric_limits<double>::infinity());
+		vec3d lo(inf, inf, inf), hi(-inf, -inf, -inf), center(0, 0, 0);
+		for (std::size_t i(0); i < indexBuffer.size(); ++i)
+		{
+			vec3d const v(ToDouble(vertexBuffer[indexBuffer[i]]));
+			lo = vec3d(std::min(lo.x, v.x), std::min(lo.y, v.y), std::min(lo.z, v.z));
+			hi = vec3d(std::max(hi.x, v.x), std::max(hi.y, v.y), std::max(hi.z, v.z));
+			center += v;
+		}
+		center /= double(indexBuffer.size());
+		for (std::size_t i(0); i < indexBuffer.size(); i += 3)
+		{
+			vec3d const a(ToDouble(vertexBuffer[indexBuffer[i + 0]]) - center);
+			vec3d const b(ToDouble(vertexBuffer[indexBuffer[i + 1]]) - center);
+			vec3d const c(ToDouble(vertexBuffer[indexBuffer[i + 2]]) - center);
+			m_originalVolume += std::fabs(a.dotProduct(b.crossProduct(c))) / 6.0;
+		}
+		double const extent(std::max({ hi.x - lo.x, hi.y - lo.y, hi.z - lo.z, 1.0 }));
+		m_epsilon = extent * 1e-9;
+		// caps that reach this box are unbounded, dropping their plane would open the hull
+		m_boxMin = lo - vec3d(extent, extent, extent) * 1000.0;
+		m_boxMax = hi + vec3d(extent, extent, extent) * 1000.0;
+
+		for (auto const &plane : planes)
+		{
+			vec3d n(plane.m_N.x, plane.m_N.y, plane.m_N.z);
+			double const length(n.getLength());
+			if (!(length > 0.0))
+				continue;
+			m_n.push_back(n / length);
+			m_d.push_back(double(plane.m_D) / length);
+		}
+		m_alive.assign(m_n.size(), 1);
+		m_version.assign(m_n.size(), 0);
+		m_bounded.resize(m_n.size());
+		m_near.resize(m_n.size());
+		std::vector<std::pair<double, std::uint32_t>> order;
+		for (std::uint32_t i(0); i < m_n.size(); ++i)
+		{
+			order.clear();
+			for (std::uint32_t j(0); j < m_n.size(); ++j)
+				if (j != i)
+					order.emplace_back(-m_n[i].dotProduct(m_n[j]), j);
+			std::size_t const count(std::min(NearPlanes, order.size()));
+			std::partial_sort(order.begin(), order.begin() + count, order.end());
+			for (std::size_t k(0); k < count; ++k)
+				m_near[i].push_back(order[k].second);
+		}
+
+		// any polyhedron has at least faces / 2 + 2 vertices, so fewer faces than that are needed for the vertex budget
+		if (maxVertices)
+			maxFaces = maxFaces ? std::min(maxFaces, 2 * maxVertices) : 2 * maxVertices;
+		Simplify(maxFaces);
+		Polyhedron hull(Build());
+		// a drop removes about two vertices, step by a quarter of the excess to stay close to the budget without many rebuilds
+		for (std::size_t vertices(CountVertices(hull)); maxVertices && vertices > maxVertices; vertices = CountVertices(hull))
+		{
+			std::size_t const faces(CountFaces());
+			if (!Simplify(faces - std::min(faces, std::max<std::size_t>(1, (vertices - maxVertices) / 4))))
+				break;
+			hull = Build();
+		}
+		Output(hull);
+	}
+public:
+	std::vector<vec3f> const &GetVertexBuffer() const { return m_vertices; }
+	std::vector<std::size_t> const &GetIndexBuffer() const { return m_indices; }
+	std::vector<quickhull::Plane<float>> const &GetPlanes() const { return m_planes; }
+	std::size_t GetFaceCount() const { return m_planes.size(); }
+	std::size_t GetTriangleCount() const { return m_indices.size() / 3; }
+	std::size_t GetVertexCount() const { return m_vertices.size(); }
+	double GetVolume() const { return m_volume; }
+	double GetOriginalVolume() const { return m_originalVolume; }
+	// relative volume added by the simplification
+	double GetVolumeError() const { return m_originalVolume > 0.0 ? (m_volume - m_originalVolume) / m_originalVolume : 0.0; }
+	operator bool() const
+	{
+		return !m_indices.empty();
+	}
+private:
+	template<typename V>
+	static vec3d ToDouble(V const &v)
+	{
+		return vec3d(double(v.x), double(v.y), double(v.z));
+	}
+
+	std::size_t CountFaces() const
+	{
+		return static_cast<std::size_t>(std::count(m_alive.begin(), m_alive.end(), std::uint8_t(1)));
+	}
+
+	// drops planes until at most maxFaces are left, returns false if no plane could be dropped
+	bool Simplify(std::size_t maxFaces)
+	{
+		std::size_t faces(CountFaces());
+		if (!maxFaces || faces <= maxFaces)
+			return true;
+
+		// the queue persists between calls, so dropping one plane at a time for the vertex budget is cheap
+		std::vector<std::uint32_t> active;
+		auto const evaluate = [&](std::uint32_t i) {
+			double const volume(CapVolume(i, active));
+			for (std::uint32_t j : active)
+				m_bounded[j].push_back(i);
+			m_queue.push(Cap{ volume, i, ++m_version[i] });
+		};
+		if (m_queue.empty())
+		{
+			for (std::uint32_t i(0); i < m_n.size(); ++i)
+				if (m_alive[i])
+					evaluate(i);
+		}
+
+		bool dropped(false);
+		while (faces > maxFaces && !m_queue.empty())
+		{
+			Cap const cap(m_queue.top());
+			if (cap.volume == std::numeric_limits<double>::infinity())
+				break;
+			m_queue.pop();
+			if (!m_alive[cap.plane] || cap.version != m_version[cap.plane])
+				continue;
+			m_alive[cap.plane] = 0;
+			--faces;
+			dropped = true;
+			std::vector<std::uint32_t> affected;
+			affected.swap(m_bounded[cap.plane]);
+			std::sort(affected.begin(), affected.end());
+			affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+			for (std::uint32_t i : affected)
+				if (m_alive[i])
+					evaluate(i);
+		}
+		return dropped;
+	}
+
+	// volume the hull grows by when plane i is dropped, the planes that bound the cap go to active
+	double CapVolume(std::uint32_t i, std::vector<std::uint32_t> &active) const
+	{
+		active.clear();
+		Polyhedron cap(Box());
+		Clip(cap, m_n[i] * -1.0, -m_d[i], static_cast<std::int32_t>(i));
+		for (std::uint32_t j : m_near[i])
+		{
+			if (m_alive[j] && !cap.empty() && Clip(cap, m_n[j], m_d[j], static_cast<std::int32_t>(j)))
+				active.push_back(j);
+		}
+		// the rest only needs a bounding sphere test, planes already applied cut nothing and are not added twice
+		vec3d center;
+		double radius(Bounds(cap, center));
+		for (std::uint32_t j(0); j < m_n.size() && !cap.empty(); ++j)
+		{
+			if (j == i || !m_alive[j] || m_n[j].dotProduct(center) + m_d[j] <= -radius)
+				continue;
+			if (Clip(cap, m_n[j], m_d[j], static_cast<std::int32_t>(j)))
+			{
+				active.push_back(j);
+				radius = Bounds(cap, center);
+			}
+		}
+		for (auto const &face : cap)
+			if (face.plane < 0)
+				return std::numeric_limits<double>::infinity();
+		return Volume(cap);
+	}
+
+	Polyhedron Build() const
+	{
+		Polyhedron hull(Box());
+		for (std::uint32_t j(0); j < m_n.size(); ++j)
+			if (m_alive[j])
+				Clip(hull, m_n[j], m_d[j], static_cast<std::int32_t>(j));
+		return hull;
+	}
+
+	Polyhedron Box() const
+	{
+		vec3d const &a(m_boxMin), &b(m_boxMax);
+		vec3d const corner[8] = {
+			vec3d(a.x, a.y, a.z), vec3d(b.x, a.y, a.z), vec3d(b.x, b.y, a.z), vec3d(a.x, b.y, a.z),
+			vec3d(a.x, a.y, b.z), vec3d(b.x, a.y, b.z), vec3d(b.x, b.y, b.z), vec3d(a.x, b.y, b.z)
+		};
+		auto const face = [&corner](int p, int q, int r, int s, vec3d const &n, double d) {
+			return Polygon{ { corner[p], corner[q], corner[r], corner[s] }, n, d, -1 };
+		};
+		return {
+			face(0, 3, 2, 1, vec3d(0, 0, -1), a.z), face(4, 5, 6, 7, vec3d(0, 0, 1), -b.z),
+			face(0, 1, 5, 4, vec3d(0, -1, 0), a.y), face(3, 7, 6, 2, vec3d(0, 1, 0), -b.y),
+			face(0, 4, 7, 3, vec3d(-1, 0, 0), a.x), face(1, 2, 6, 5, vec3d(1, 0, 0), -b.x)
+		};
+	}
+
+	// keeps the part of a convex polyhedron with n . x + d <= 0, returns true if the plane cut anything off
+	bool Clip(Polyhedron &poly, vec3d const &n, double d, std::int32_t plane) const
+	{
+		bool outside(false), inside(false);
+		for (auto const &face : poly)
+		{
+			for (auto const &p : face.points)
+			{
+				double const dist(n.dotProduct(p) + d);
+				outside |= dist > m_epsilon;
+				inside |= dist < -m_epsilon;
+			}
+		}
+		if (!outside)
+			return false;
+		if (!inside)
+		{
+			poly.clear();
+			return true;
+		}
+
+		std::vector<vec3d> section;
+		Polyhedron ret;
+		ret.reserve(poly.size() + 1);
+		for (auto &face : poly)
+		{
+			std::vector<vec3d> kept;
+			std::size_t const count(face.points.size());
+			for (std::size_t k(0); k < count; ++k)
+			{
+				vec3d const &a(face.points[k]);
+				vec3d const &b(face.points[(k + 1) % count]);
+				double const da(n.dotProduct(a) + d), db(n.dotProduct(b) + d);
+				if (da <= m_epsilon)
+					kept.push_back(a);
+				if (std::fabs(da) <= m_epsilon)
+					section.push_back(a);
+				if ((da < -m_epsilon && db > m_epsilon) || (da > m_epsilon && db < -m_epsilon))
+				{
+					vec3d const p(a + (b - a) * (da / (da - db)));
+					kept.push_back(p);
+					section.push_back(p);
+				}
+			}
+			if (kept.size() >= 3)
+			{
+				face.points = std::move(kept);
+				ret.push_back(std::move(face));
+			}
+		}
+
+		// the new face is the convex polygon of the section points, ordered by angle around their mean
+		if (section.size() >= 3)
+		{
+			vec3d mean(0, 0, 0);
+			for (auto const &p : section)
+				mean += p;
+			mean /= double(section.size());
+			vec3d const u(Perpendicular(n));
+			vec3d const v(n.crossProduct(u));
+			std::sort(section.begin(), section.end(), [&](vec3d const &a, vec3d const &b) {
+				return std::atan2((a - mean).dotProduct(v), (a - mean).dotProduct(u)) < std::atan2((b - mean).dotProduct(v), (b - mean).dotProduct(u));
+			});
+			std::vector<vec3d> points;
+			for (auto const &p : section)
+				if (points.empty() || (p - points.back()).getLengthSquared() > m_epsilon * m_epsilon)
+					points.push_back(p);
+			while (points.size() > 1 && (points.front() - points.back()).getLengthSquared() <= m_epsilon * m_epsilon)
+				points.pop_back();
+			if (points.size() >= 3)
+				ret.push_back(Polygon{ std::move(points), n, d, plane });
+		}
+		poly = std::move(ret);
+		return true;
+	}
+
+	// center and radius of a sphere around the polyhedron
+	static double Bounds(Polyhedron const &poly, vec3d &center)
+	{
+		center = vec3d(0, 0, 0);
+		std::size_t count(0);
+		for (auto const &face : poly)
+		{
+			for (auto const &p : face.points)
+				center += p;
+			count += face.points.size();
+		}
+		if (!count)
+			return 0.0;
+		center /= double(count);
+		double radius(0.0);
+		for (auto const &face : poly)
+			for (auto const &p : face.points)
+				radius = std::max(radius, (p - center).getLengthSquared());
+		return std::sqrt(radius);
+	}
+
+	static vec3d Perpendicular(vec3d const &n)
+	{
+		vec3d const axis(std::fabs(n.x) < 0.6 ? vec3d(1, 0, 0) : vec3d(0, 1, 0));
+		vec3d u(axis - n * n.dotProduct(axis));
+		return u / u.getLength();
+	}
+
+	static double Volume(Polyhedron const &poly)
+	{
+		if (poly.empty())
+			return 0.0;
+		// sum of the pyramids from a point of the polyhedron over every face
+		vec3d const apex(poly.front().points.front());
+		double volume(0.0);
+		for (auto const &face : poly)
+		{
+			vec3d area(0, 0, 0);
+			for (std::size_t k(1); k + 1 < face.points.size(); ++k)
+				area += (face.points[k] - face.points[0]).crossProduct(face.points[k + 1] - face.points[0]);
+			volume += area.getLength() * 0.5 * std::fabs(face.n.dotProduct(apex) + face.d) / 3.0;
+		}
+		return volume;
+	}
+
+	std::size_t CountVertices(Polyhedron const &poly) const
+	{
+		std::vector<vec3d> unique;
+		for (auto const &face : poly)
+			for (auto const &p : face.points)
+				Find(unique, p);
+		return unique.size();
+	}
+
+	// index of the point within a small distance of p, adding p if there is none
+	std::size_t Find(std::vector<vec3d> &points, vec3d const &p) const
+	{
+		double const tolerance(m_epsilon * 1000.0);
+		for (std::size_t k(0); k < points.size(); ++k)
+			if ((points[k] - p).getLengthSquared() <= tolerance * tolerance)
+				return k;
+		points.push_back(p);
+		return points.size() - 1;
+	}
+
+	void Output(Polyhedron const &poly)
+	{
+		m_volume = Volume(poly);
+		std::vector<vec3d> unique;
+		for (auto const &face : poly)
+		{
+			std::vector<std::size_t> ids;
+			for (auto const &p : face.points)
+			{
+				std::size_t const id(Find(unique, p));
+				if (ids.empty() || (ids.back() != id && ids.front() != id))
+					ids.push_back(id);
+			}
+			if (ids.size() < 3)
+				continue;
+			vec3d const n(face.n);
+			m_planes.emplace_back(vec3f(float(n.x), float(n.y), float(n.z)), vec3f(float(-n.x * face.d), float(-n.y * face.d), float(-n.z * face.d)));
+			// the fan winds against the outward normal like the QuickHull output
+			vec3d const &a(unique[ids[0]]), &b(unique[ids[1]]), &c(unique[ids[2]]);
+			bool const reverse((b - a).crossProduct(c - a).dotProduct(n) > 0.0);
+			for (std::size_t k(1); k + 1 < ids.size(); ++k)
+			{
+				m_indices.push_back(ids[0]);
+				m_indices.push_back(reverse ? ids[k + 1] : ids[k]);
+				m_indices.push_back(reverse ? ids[k] : ids[k + 1]);
+			}
+		}
+		m_vertices.reserve(unique.size());
+		for (auto const &p : unique)
+			m_vertices.emplace_back(float(p.x), float(p.y), float(p.z));
+	}
+};
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+
+#include "ImageView.h"
+#include "PixelFormat.h"
+
+// libpng is optional, without it PNG files are left to WIC
+#if __has_include(<png.h>)
+#include <png.h>
+#define IMAGEDECODER_PNG
+#endif
+
+// Decoder of PNG, binary PPM/PGM (P6/P5, up to 16 bit) and PFM files without WIC, COM or a GPU.
+// The constructor reads the header, Decode then streams the file one row at a time into an image of width x height
+// pixels: samples become floats from 0 to 255 (PFM values from 0 to 1 are scaled by 255), gray is copied to R, G and B,
+// alpha is 255 unless the file has one and Decode keeps it. Only an interlaced PNG is read whole before the conversion.
+class ImageDecoder
+{
+public:
+	enum class FileFormat
+	{
+		PNG,
+		PNM, // P5 gray or P6 RGB, maxval up to 65535
+		PFM, // Pf gray or PF RGB, 32 bit floats, rows bottom to top
+	};
+
+	// largest width x height accepted, 4 GiB of RGBA floats; 32-bit builds also need the image to fit in size_t
+	static constexpr std::uint64_t MaxPixels = std::uint64_t(1) << 28;
+
+	FileFormat format;
+	std::uint32_t width, height;
+	std::uint32_t channels; // samples per pixel in the file after expansion: 1 gray, 2 gray and alpha, 3 RGB, 4 RGBA
+	std::uint32_t bit_depth; // bits per sample: 8, 16, or 32 for PFM
+private:
+	std::ifstream m_file;
+	std::filesystem::path m_path;
+	std::uint32_t m_maxval; // samples from 0 to m_maxval, 255 or 65535 for PNG
+	bool m_swap; // 16 bit or float samples of the other byte order than this machine
+	bool m_keep_alpha;
+	std::vector<std::uint8_t> m_raw8; // one row of the file, of the sample type of bit_depth
+	std::vector<std::uint16_t> m_raw16;
+	std::vector<float> m_raw32;
+	std::vector<float> m_samples; // one row of float samples before gray or RGB is expanded
+	std::vector<float> m_row; // one RGBA row for planar images
+#if defined(IMAGEDECODER_PNG)
+	png_structp m_png;
+	png_infop m_info;
+	int m_passes;
+#endif
+public:
+	explicit ImageDecoder(std::filesystem::path const &path) :format(FileFormat::PNM), width(0), height(0), channels(0), bit_depth(0),
+		m_file(path, std::ios::binary), m_path(path), m_maxval(255), m_swap(false), m_keep_alpha(false)
+#if defined(IMAGEDECODER_PNG)
+		, m_png(nullptr), m_info(nullptr), m_passes(1)
+#endif
+	{
+		if (!m_file)
+			Fail("cannot open");
+		char magic[8]{};
+		m_file.read(magic, 8);
+		m_file.clear();
+		m_file.seekg(0);
+		if (std::memcmp(magic, "\x89PNG\r\n\x1a\n", 8) == 0)
+			ReadPNGHeader();
+		else if (magic[0] == 'P' && (magic[1] == '5' || magic[1] == '6'))
+			ReadPNMHeader();
+		else if (magic[0] == 'P' && (magic[1] == 'f' || magic[1] == 'F'))
+			ReadPFMHeader();
+		else
+			Fail("not a PNG, binary PPM/PGM or PFM file");
+		// in 64 bits the product of two 32-bit sizes cannot overflow
+		std::uint64_t const pixels(std::uint64_t(width) * height);
+		if (pixels == 0 || pixels > MaxPixels || pixels > SIZE_MAX / (4 * sizeof(float)))
+			Fail("bad image size");
+	}
+	~ImageDecoder()
+	{
+#if defined(IMAGEDECODER_PNG)
+		if (m_png)
+			png_destroy_read_struct(&m_png, &m_info, nullptr);
+#endif
+	}
+	ImageDecoder(ImageDecoder const &other) = delete;
+	ImageDecoder &operator=(ImageDecoder const &other) = delete;
+
+	// files this decoder reads, by extension
+	static bool Supports(std::filesystem::path const &path)
+	{
+		std::string extension(path.extension().string());
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+#if defined(IMAGEDECODER_PNG)
+		if (extension == ".png")
+			return true;
+#endif
+		return extension == ".ppm" || extension == ".pgm" || extension == ".pnm" || extension == ".pfm";
+	}
+public:
+	// every row of the file into dst, which needs at least width x height pixels, once per decoder
+	// alpha is 255 unless keep_alpha is set and the file has one
+	void Decode(ImageView const &dst, bool keep_alpha = false)
+	{
+		if (dst.width < width || dst.height < height)
+			Fail("destination image too small");
+		m_keep_alpha = keep_alpha;
+		m_samples.resize(std::size_t(width) * channels);
+		if (dst.layout != PixelLayout::Interleaved)
+			m_row.resize(std::size_t(width) * 4);
+		switch (format)
+		{
+		case FileFormat::PNG:
+			DecodePNG(dst);
+			break;
+		case FileFormat::PNM:
+			for (std::uint32_t y(0); y < height; ++y)
+				ConvertRow(ReadRow(), dst, y);
+			break;
+		case FileFormat::PFM:
+			for (std::uint32_t y(0); y < height; ++y)
+				ConvertRow(ReadRow(), dst, height - 1 - y);
+			break;
+		}
+	}
+private:
+	[[noreturn]] void Fail(char const *message) const
+	{
+		throw std::runtime_error(m_path.string() + ": " + message);
+	}
+
+	static bool IsLittleEndian()
+	{
+		std::uint16_t const one(1);
+		std::uint8_t first;
+		std::memcpy(&first, &one, 1);
+		return first == 1;
+	}
+
+	// next whitespace separated token of a PNM or PFM header, skipping comments
+	std::string ReadToken()
+	{
+		std::string token;
+		for (int c(m_file.get()); c != EOF; c = m_file.get())
+		{
+			if (c == '#' && token.empty())
+			{
+				while (c != EOF && c != '\n')
+					c = m_file.get();
+				continue;
+			}
+			if (std::isspace(c))
+			{
+				if (token.empty())
+					continue;
+				break; // the single whitespace character after the last header field is consumed here
+			}
+			token.push_back(static_cast<char>(c));
+		}
+		if (token.empty())
+			Fail("truncated header");
+		return token;
+	}
+	std::uint32_t ReadNumber()
+	{
+		std::string const token(ReadToken());
+		if (token.find_first_not_of("0123456789") != std::string::npos || token.size() > 9)
+			Fail("bad header");
+		return static_cast<std::uint32_t>(std::stoul(token));
+	}
+
+	void ReadPNMHeader()
+	{
+		format = FileFormat::PNM;
+		channels = ReadToken() == "P6" ? 3 : 1;
+		width = ReadNumber();
+		height = ReadNumber();
+		m_maxval = ReadNumber();
+		if (m_maxval == 0 || m_maxval > 65535)
+			Fail("bad maxval");
+		bit_depth = m_maxval > 255 ? 16 : 8;
+		m_swap = bit_depth == 16 && IsLittleEndian(); // big endian
+	}
+	void ReadPFMHeader()
+	{
+		format = FileFormat::PFM;
+		channels = ReadToken() == "PF" ? 3 : 1;
+		width = ReadNumber();
+		height = ReadNumber();
+		double const scale(std::stod(ReadToken()));
+		bit_depth = 32;
+		m_swap = (scale < 0.0) != IsLittleEndian(); // a negative scale means little endian
+	}
+
+	// the raw samples of the next row, byte swapped to this machine
+	void const *ReadRow()
+	{
+		std::size_t const count(std::size_t(width) * channels);
+		if (bit_depth == 8)
+		{
+			m_raw8.resize(count);
+			Read(m_raw8.data(), count);
+			return m_raw8.data();
+		}
+		if (bit_depth == 16)
+		{
+			m_raw16.resize(count);
+			Read(m_raw16.data(), count * sizeof(std::uint16_t));
+			if (m_swap)
+				for (auto &s : m_raw16)
+					s = static_cast<std::uint16_t>((s >> 8) | (s << 8));
+			return m_raw16.data();
+		}
+		m_raw32.resize(count);
+		Read(m_raw32.data(), count * sizeof(float));
+		if (m_swap)
+		{
+			for (auto &s : m_raw32)
+			{
+				std::uint32_t bits;
+				std::memcpy(&bits, &s, sizeof(bits));
+				bits = (bits >> 24) | ((bits >> 8) & 0xff00u) | ((bits << 8) & 0xff0000u) | (bits << 24);
+				std::memcpy(&s, &bits, sizeof(bits));
+			}
+		}
+		return m_raw32.data();
+	}
+	void Read(void *dst, std::size_t bytes)
+	{
+		if (!m_file.read(static_cast<char *>(dst), static_cast<std::streamsize>(bytes)))
+			Fail("truncated pixel data");
+	}
+
+	// one row of raw samples to row y of dst
+	void ConvertRow(void const *raw, ImageView const &dst, std::uint32_t y)
+	{
+		std::size_t const count(std::size_t(width) * channels);
+		float *rgba(dst.layout == PixelLayout::Interleaved ? dst.Row(y) : m_row.data());
+		// RGBA files go straight to the destination row
+		float *samples(channels == 4 ? rgba : m_samples.data());
+		if (bit_depth == 8)
+			DecodeSamples<PixelFormat::UNorm8>(static_cast<std::uint8_t const *>(raw), samples, count, 255.0f * 255.0f / m_maxval);
+		else if (bit_depth == 16)
+			DecodeSamples<PixelFormat::UNorm16>(static_cast<std::uint16_t const *>(raw), samples, count, 255.0f * 65535.0f / m_maxval);
+		else
+			for (std::size_t i(0); i < count; ++i)
+				samples[i] = static_cast<float const *>(raw)[i] * 255.0f;
+
+		switch (channels)
+		{
+		case 1:
+			for (std::uint32_t x(0); x < width; ++x)
+			{
+				rgba[x * 4 + 0] = rgba[x * 4 + 1] = rgba[x * 4 + 2] = samples[x];
+				rgba[x * 4 + 3] = 255.0f;
+			}
+			break;
+		case 2:
+			for (std::uint32_t x(0); x < width; ++x)
+			{
+				rgba[x * 4 + 0] = rgba[x * 4 + 1] = rgba[x * 4 + 2] = samples[x * 2];
+				rgba[x * 4 + 3] = m_keep_alpha ? samples[x * 2 + 1] : 255.0f;
+			}
+			break;
+		case 3:
+			for (std::uint32_t x(0); x < width; ++x)
+			{
+				rgba[x * 4 + 0] = samples[x * 3 + 0];
+				rgba[x * 4 + 1] = samples[x * 3 + 1];
+				rgba[x * 4 + 2] = samples[x * 3 + 2];
+				rgba[x * 4 + 3] = 255.0f;
+			}
+			break;
+		default:
+			if (!m_keep_alpha)
+				for (std::uint32_t x(0); x < width; ++x)
+					rgba[x * 4 + 3] = 255.0f;
+			break;
+		}
+		if (dst.layout != PixelLayout::Interleaved)
+			ImageView(rgba, width, 1, std::size_t(width) * 4, 0, PixelLayout::Interleaved).CopyTo(dst.SubView(y, 0, 1, width));
+	}
+
+#if defined(IMAGEDECODER_PNG)
+	static void ReadPNGData(png_structp png, png_bytep data, std::size_t length)
+	{
+		auto *file(static_cast<std::ifstream *>(png_get_io_ptr(png)));
+		if (!file->read(reinterpret_cast<char *>(data), static_cast<std::streamsize>(length)))
+			png_error(png, "truncated file");
+	}
+
+	// libpng reports errors with longjmp, only members live across the setjmp
+	void ReadPNGHeader()
+	{
+		format = FileFormat::PNG;
+		m_png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+		if (m_png)
+			m_info = png_create_info_struct(m_png);
+		if (!m_png || !m_info)
+			Fail("out of memory");
+		if (setjmp(png_jmpbuf(m_png)))
+			Fail("bad PNG file");
+		png_set_read_fn(m_png, &m_file, ReadPNGData);
+		png_read_info(m_png, m_info);
+		png_set_expand(m_png); // palette to RGB, 1, 2 and 4 bit gray to 8 bit, tRNS to alpha
+		if (png_get_bit_depth(m_png, m_info) == 16 && IsLittleEndian())
+			png_set_swap(m_png);
+		m_passes = png_set_interlace_handling(m_png);
+		png_read_update_info(m_png, m_info);
+		width = png_get_image_width(m_png, m_info);
+		height = png_get_image_height(m_png, m_info);
+		channels = png_get_channels(m_png, m_info);
+		bit_depth = png_get_bit_depth(m_png, m_info);
+		m_maxval = bit_depth == 16 ? 65535 : 255;
+	}
+	void DecodePNG(ImageView const &dst)
+	{
+		std::size_t const count(std::size_t(width) * channels);
+		std::size_t const rows(m_passes > 1 ? height : 1);
+		if (bit_depth == 16)
+			m_raw16.resize(count * rows);
+		else
+			m_raw8.resize(count * rows);
+		if (setjmp(png_jmpbuf(m_png)))
+			Fail("bad PNG file");
+		// an interlaced image needs every pass before a row is complete
+		if (m_passes > 1)
+		{
+			for (int pass(0); pass < m_passes; ++pass)
+				for (std::uint32_t y(0); y < height; ++y)
+					png_read_row(m_png, RawRow(y), nullptr);
+		}
+		for (std::uint32_t y(0); y < height; ++y)
+		{
+			png_bytep const raw(RawRow(m_passes > 1 ? y : 0));
+			if (m_passes == 1)
+				png_read_row(m_png, raw, nullptr);
+			ConvertRow(raw, dst, y);
+		}
+		png_read_end(m_png, nullptr);
+	}
+	png_bytep RawRow(std::uint32_t y)
+	{
+		std::size_t const count(std::size_t(width) * channels);
+		if (bit_depth == 16)
+			return reinterpret_cast<png_bytep>(m_raw16.data() + y * count);
+		return m_raw8.data() + y * count;
+	}
+#else
+	void ReadPNGHeader()
+	{
+		Fail("PNG needs libpng");
+	}
+	void DecodePNG(ImageView const &)
+	{
+		Fail("PNG needs libpng");
+	}
+#endif
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <tuple>
+#include <algorithm>
+
+// how the samples of an image are stored
+enum class PixelLayout
+{
+	Interleaved, // RGBARGBARGBA..., pitch floats from one row to the next
+	Planar, // an R, a G and a B plane of height rows of pitch floats each, plane_pitch floats apart, alpha is implicitly 255
+};
+
+// rows and planes of images set up with a padded pitch start on this many bytes
+constexpr std::size_t ImageAlignment = 64;
+
+// floats per pixel in one row of a layout
+constexpr std::size_t SamplesPerPixel(PixelLayout layout)
+{
+	return layout == PixelLayout::Interleaved ? 4 : 1;
+}
+
+// planes of a layout
+constexpr std::size_t PlaneCount(PixelLayout layout)
+{
+	return layout == PixelLayout::Interleaved ? 1 : 3;
+}
+
+// Pixels of an image, or of a rectangle of them, without owning them. Views of an RGBAImage stay valid until it is set
+// up again or released.
+class ImageView
+{
+public:
+	float *data; // first sample of the first row, of the R plane if planar
+	std::uint32_t width, height;
+	std::size_t pitch; // floats from one row to the next
+	std::size_t plane_pitch; // floats from one plane to the next, planar only
+	PixelLayout layout;
+public:
+	ImageView() :data(nullptr), width(0), height(0), pitch(0), plane_pitch(0), layout(PixelLayout::Interleaved)
+	{
+
+	}
+	ImageView(float *data, std::uint32_t width, std::uint32_t height, std::size_t pitch, std::size_t plane_pitch, PixelLayout layout) :
+		data(data), width(width), height(height), pitch(pitch), plane_pitch(plane_pitch), layout(layout)
+	{
+
+	}
+public:
+	std::tuple<std::uint32_t, std::uint32_t> GetSize() const { return { width,height }; }
+
+	// row i of a channel, the channel only matters for planar images
+	float *Row(std::uint32_t i, std::uint32_t channel = 0) const
+	{
+		return data + channel * plane_pitch + i * pitch;
+	}
+
+	std::tuple<float, float, float> At(std::uint32_t i, std::uint32_t j) const
+	{
+		if (layout == PixelLayout::Interleaved)
+		{
+			float const *pos(data + i * pitch + j * 4);
+			return { pos[0], pos[1], pos[2] };
+		}
+		float const *pos(data + i * pitch + j);
+		return { pos[0], pos[plane_pitch], pos[plane_pitch * 2] };
+	}
+	void Set(std::uint32_t i, std::uint32_t j, float r2, float g2, float b2) const
+	{
+		if (layout == PixelLayout::Interleaved)
+		{
+			float *pos(data + i * pitch + j * 4);
+			pos[0] = r2;
+			pos[1] = g2;
+			pos[2] = b2;
+			return;
+		}
+		float *pos(data + i * pitch + j);
+		pos[0] = r2;
+		pos[plane_pitch] = g2;
+		pos[plane_pitch * 2] = b2;
+	}
+
+	// rows row .. row + rows and columns column .. column + columns, clamped to the image
+	ImageView SubView(std::uint32_t row, std::uint32_t column, std::uint32_t rows, std::uint32_t columns) const
+	{
+		row = std::min(row, height);
+		column = std::min(column, width);
+		rows = std::min(rows, height - row);
+		columns = std::min(columns, width - column);
+		return ImageView(data + row * pitch + column * SamplesPerPixel(layout), columns, rows, pitch, plane_pitch, layout);
+	}
+
+	// f(tile, row, column) for every tile of tile_height x tile_width pixels in row major order, the last ones are smaller
+	template<typename F>
+	void ForEachTile(std::uint32_t tile_height, std::uint32_t tile_width, F f) const
+	{
+		tile_height = std::max<std::uint32_t>(tile_height, 1);
+		tile_width = std::max<std::uint32_t>(tile_width, 1);
+		for (std::uint32_t row(0); row < height; row += tile_height)
+			for (std::uint32_t column(0); column < width; column += tile_width)
+				f(SubView(row, column, tile_height, tile_width), row, column);
+	}
+
+	// RGBA rows without gaps, so the pixels can be read as one array of width * height * 4 floats
+	bool IsPacked() const
+	{
+		return layout == PixelLayout::Interleaved && pitch == std::size_t(width) * 4;
+	}
+
+	// copy the RGB of every pixel to an image of the same size in any layout, alpha is 255 in interleaved images
+	void CopyTo(ImageView const &dst) const
+	{
+		std::uint32_t const rows(std::min(height, dst.height)), columns(std::min(width, dst.width));
+		for (std::uint32_t i(0); i < rows; ++i)
+		{
+			if (layout == PixelLayout::Interleaved && dst.layout == PixelLayout::Interleaved)
+			{
+				std::copy_n(Row(i), std::size_t(columns) * 4, dst.Row(i));
+				continue;
+			}
+			if (layout == PixelLayout::Planar && dst.layout == PixelLayout::Planar)
+			{
+				for (std::uint32_t c(0); c < 3; ++c)
+					std::copy_n(Row(i, c), columns, dst.Row(i, c));
+				continue;
+			}
+			for (std::uint32_t j(0); j < columns; ++j)
+			{
+				auto const [r, g, b] = At(i, j);
+				dst.Set(i, j, r, g, b);
+				if (dst.layout == PixelLayout::Interleaved)
+					dst.Row(i)[j * 4 + 3] = 255.0f;
+			}
+		}
+	}
+};
@@ -0,0 +1,436 @@
+#include "MathUtils.hpp"
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include "DXUT.h"
+#include "IntegerQuickHull.hpp"
+
+namespace quickhull {
+
+	template<typename T, typename I>
+	bool IntegerQuickHull<T,I>::hasIntegerCoordinates(const VertexDataSource<T>& pointCloud) {
+		const T maxCoordinate = static_cast<T>(MaxCoordinate);
+		return std::all_of(pointCloud.begin(), pointCloud.end(), [maxCoordinate](const vec3& v) {
+			for (const T c : {v.x, v.y, v.z}) {
+				if (!(std::abs(c) <= maxCoordinate) || std::floor(c) != c) {
+					return false;
+				}
+			}
+			return true;
+		});
+	}
+
+	template<typename T, typename I>
+	ConvexHull<T> IntegerQuickHull<T,I>::getConvexHull(const std::vector<Vector3<T>>& pointCloud, bool CCW, bool useOriginalIndices) {
+		VertexDataSource<T> vertexDataSource(pointCloud);
+		return getConvexHull(vertexDataSource,CCW,useOriginalIndices);
+	}
+
+	template<typename T, typename I>
+	ConvexHull<T> IntegerQuickHull<T,I>::getConvexHull(const VertexDataSource<T>& pointCloud, bool CCW, bool useOriginalIndices) {
+		m_vertexData = pointCloud;
+		m_diagnostics = DiagnosticsData();
+		m_degenerate = false;
+		m_mesh = MeshBuilder<I>();
+		if (pointCloud.size()==0) {
+			return ConvexHull<T>();
+		}
+		// Convert the points, finding the extreme points along the axes (max x, min x, max y, min y, max z, min z) on the way,
+		// the first of equals
+		m_points.resize(pointCloud.size());
+		m_extremeValues.fill(0);
+		std::array<I,6> extremes;
+		for (size_t i=0;i<pointCloud.size();i++) {
+			const vec3& v = pointCloud[i];
+			assert(std::abs(v.x) <= MaxCoordinate && std::abs(v.y) <= MaxCoordinate && std::abs(v.z) <= MaxCoordinate);
+			const I c[3] = {static_cast<I>(v.x), static_cast<I>(v.y), static_cast<I>(v.z)};
+			m_points[i] = ivec3(c[0], c[1], c[2]);
+			for (size_t k=0;k<3;k++) {
+				if (i==0 || c[k] > extremes[2*k]) {
+					extremes[2*k] = c[k];
+					m_extremeValues[2*k] = i;
+				}
+				if (i==0 || c[k] < extremes[2*k+1]) {
+					extremes[2*k+1] = c[k];
+					m_extremeValues[2*k+1] = i;
+				}
+			}
+		}
+
+		if (!setupInitialTetrahedron()) {
+			std::vector<ivec3>().swap(m_points);
+			m_degenerate = true;
+			return m_degenerateHull.getConvexHull(pointCloud, CCW, useOriginalIndices);
+		}
+		createConvexHalfEdgeMesh();
+		std::vector<ivec3>().swap(m_points);
+
+		// Same face traversal as the ConvexHull half edge mesh constructor
+		std::vector<size_t> faceVertices;
+		const size_t faceCount = m_mesh.m_faces.size();
+		std::vector<bool> faceProcessed(faceCount,false);
+		std::vector<size_t> faceStack;
+		for (size_t i=0;i<faceCount;i++) {
+			if (!m_mesh.m_faces[i].isDisabled()) {
+				faceStack.push_back(i);
+				break;
+			}
+		}
+		faceVertices.reserve((faceCount-m_mesh.m_disabledFaces.size())*3);
+		while (faceStack.size()) {
+			const size_t top = faceStack.back();
+			faceStack.pop_back();
+			if (faceProcessed[top]) {
+				continue;
+			}
+			faceProcessed[top] = true;
+			for (auto heIndex : m_mesh.getHalfEdgeIndicesOfFace(m_mesh.m_faces[top])) {
+				const size_t a = m_mesh.m_halfEdges[m_mesh.m_halfEdges[heIndex].m_opp].m_face;
+				if (!faceProcessed[a] && !m_mesh.m_faces[a].isDisabled()) {
+					faceStack.push_back(a);
+				}
+			}
+			for (auto v : m_mesh.getVertexIndicesOfFace(m_mesh.m_faces[top])) {
+				faceVertices.push_back(v);
+			}
+		}
+		return ConvexHull<T>(faceVertices,m_vertexData,CCW,useOriginalIndices);
+	}
+
+	template<typename T, typename I>
+	std::vector<Plane<T>> IntegerQuickHull<T,I>::getFacePlanes() const {
+		if (m_degenerate) {
+			return m_degenerateHull.getFacePlanes();
+		}
+		std::vector<Plane<T>> planes;
+		planes.reserve(m_mesh.m_faces.size() - m_mesh.m_disabledFaces.size());
+		for (const auto& f : m_mesh.m_faces) {
+			if (!f.isDisabled()) {
+				Plane<T> P;
+				P.m_N = vec3(static_cast<T>(f.m_P.m_N.x), static_cast<T>(f.m_P.m_N.y), static_cast<T>(f.m_P.m_N.z));
+				P.m_D = static_cast<T>(f.m_P.m_D);
+				P.m_sqrNLength = P.m_N.dotProduct(P.m_N);
+				planes.push_back(P);
+			}
+		}
+		return planes;
+	}
+
+	template<typename T, typename I>
+	Plane<I> IntegerQuickHull<T,I>::getTrianglePlane(size_t a, size_t b, size_t c) const {
+		Plane<I> P;
+		P.m_N = mathutils::getTriangleNormal(m_points[a], m_points[b], m_points[c]);
+		P.m_D = -P.m_N.dotProduct(m_points[a]);
+		P.m_sqrNLength = 0; // would overflow I
+		return P;
+	}
+
+	template<typename T, typename I>
+	void IntegerQuickHull<T,I>::createConvexHalfEdgeMesh() {
+		m_visibleFaces.clear();
+		m_horizonEdges.clear();
+		m_possiblyVisibleFaces.clear();
+
+		// Init face stack with those faces that have points assigned to them
+		m_faceList.clear();
+		for (size_t i=0;i < 4;i++) {
+			auto& f = m_mesh.m_faces[i];
+			if (f.m_pointsOnPositiveSide && f.m_pointsOnPositiveSide->size()>0) {
+				m_faceList.push_back(i);
+				f.m_inFaceStack = 1;
+			}
+		}
+
+		// Process faces until the face list is empty.
+		size_t iter = 0;
+		while (!m_faceList.empty()) {
+			iter++;
+			if (iter == std::numeric_limits<size_t>::max()) {
+				iter = 0;
+			}
+
+			const size_t topFaceIndex = m_faceList.front();
+			m_faceList.pop_front();
+
+			auto& tf = m_mesh.m_faces[topFaceIndex];
+			tf.m_inFaceStack = 0;
+
+			assert(!tf.m_pointsOnPositiveSide || tf.m_pointsOnPositiveSide->size()>0);
+			if (!tf.m_pointsOnPositiveSide || tf.isDisabled()) {
+				continue;
+			}
+
+			// Pick the most distant point to this triangle plane as the point to which we extrude
+			const size_t activePointIndex = tf.m_mostDistantPoint;
+
+			// Find out the faces that have the active point strictly on their positive side and the horizon edges around them
+			m_horizonEdges.clear();
+			m_possiblyVisibleFaces.clear();
+			m_visibleFaces.clear();
+			m_possiblyVisibleFaces.emplace_back(topFaceIndex,std::numeric_limits<size_t>::max());
+			while (m_possiblyVisibleFaces.size()) {
+				const auto faceData = m_possiblyVisibleFaces.back();
+				m_possiblyVisibleFaces.pop_back();
+				auto& pvf = m_mesh.m_faces[faceData.m_faceIndex];
+				assert(!pvf.isDisabled());
+
+				if (pvf.m_visibilityCheckedOnIteration == iter) {
+					if (pvf.m_isVisibleFaceOnCurrentIteration) {
+						continue;
+					}
+				}
+				else {
+					pvf.m_visibilityCheckedOnIteration = iter;
+					if (getSignedDistance(pvf.m_P, activePointIndex)>0) {
+						pvf.m_isVisibleFaceOnCurrentIteration = 1;
+						pvf.m_horizonEdgesOnCurrentIteration = 0;
+						m_visibleFaces.push_back(faceData.m_faceIndex);
+						for (auto heIndex : m_mesh.getHalfEdgeIndicesOfFace(pvf)) {
+							if (m_mesh.m_halfEdges[heIndex].m_opp != faceData.m_enteredFromHalfEdge) {
+								m_possiblyVisibleFaces.emplace_back( m_mesh.m_halfEdges[m_mesh.m_halfEdges[heIndex].m_opp].m_face,heIndex );
+							}
+						}
+						continue;
+					}
+					assert(faceData.m_faceIndex != topFaceIndex);
+				}
+
+				// The face is not visible. Therefore, the halfedge we came from is part of the horizon edge.
+				pvf.m_isVisibleFaceOnCurrentIteration = 0;
+				m_horizonEdges.push_back(faceData.m_enteredFromHalfEdge);
+				const auto halfEdges = m_mesh.getHalfEdgeIndicesOfFace(m_mesh.m_faces[m_mesh.m_halfEdges[faceData.m_enteredFromHalfEdge].m_face]);
+				const std::int8_t ind = (halfEdges[0]==faceData.m_enteredFromHalfEdge) ? 0 : (halfEdges[1]==faceData.m_enteredFromHalfEdge ? 1 : 2);
+				m_mesh.m_faces[m_mesh.m_halfEdges[faceData.m_enteredFromHalfEdge].m_face].m_horizonEdgesOnCurrentIteration |= (1<<ind);
+			}
+			const size_t horizonEdgeCount = m_horizonEdges.size();
+
+			// With exact visibility the horizon is always a loop. Coordinates out of range overflow I and can break that, in
+			// which case the point is dropped like QuickHull does and the failure counted.
+			if (!reorderHorizonEdges(m_horizonEdges)) {
+				assert(false);
+				m_diagnostics.m_failedHorizonEdges++;
+				auto it = std::find(tf.m_pointsOnPositiveSide->begin(),tf.m_pointsOnPositiveSide->end(),activePointIndex);
+				tf.m_pointsOnPositiveSide->erase(it);
+				if (tf.m_pointsOnPositiveSide->size()==0) {
+					reclaimToIndexVectorPool(tf.m_pointsOnPositiveSide);
+				}
+				continue;
+			}
+
+			// Disable the visible faces and their half edges except for the horizon, keeping their points and half edge slots
+			m_newFaceIndices.clear();
+			m_newHalfEdgeIndices.clear();
+			m_disabledFacePointVectors.clear();
+			size_t disableCounter = 0;
+			for (auto faceIndex : m_visibleFaces) {
+				auto& disabledFace = m_mesh.m_faces[faceIndex];
+				auto halfEdges = m_mesh.getHalfEdgeIndicesOfFace(disabledFace);
+				for (size_t j=0;j<3;j++) {
+					if ((disabledFace.m_horizonEdgesOnCurrentIteration & (1<<j)) == 0) {
+						if (disableCounter < horizonEdgeCount*2) {
+							m_newHalfEdgeIndices.push_back(halfEdges[j]);
+							disableCounter++;
+						}
+						else {
+							m_mesh.disableHalfEdge(halfEdges[j]);
+						}
+					}
+				}
+				auto t = std::move(m_mesh.disableFace(faceIndex));
+				if (t) {
+					assert(t->size());
+					m_disabledFacePointVectors.push_back(std::move(t));
+				}
+			}
+			if (disableCounter < horizonEdgeCount*2) {
+				const size_t newHalfEdgesNeeded = horizonEdgeCount*2-disableCounter;
+				for (size_t i=0;i<newHalfEdgesNeeded;i++) {
+					m_newHalfEdgeIndices.push_back(m_mesh.addHalfEdge());
+				}
+			}
+
+			// Create new faces using the edgeloop
+			for (size_t i = 0; i < horizonEdgeCount; i++) {
+				const size_t AB = m_horizonEdges[i];
+
+				auto horizonEdgeVertexIndices = m_mesh.getVertexIndicesOfHalfEdge(m_mesh.m_halfEdges[AB]);
+				const size_t A = horizonEdgeVertexIndices[0];
+				const size_t B = horizonEdgeVertexIndices[1];
+				const size_t C = activePointIndex;
+
+				const size_t newFaceIndex = m_mesh.addFace();
+				m_newFaceIndices.push_back(newFaceIndex);
+
+				const size_t CA = m_newHalfEdgeIndices[2*i+0];
+				const size_t BC = m_newHalfEdgeIndices[2*i+1];
+
+				m_mesh.m_halfEdges[AB].m_next = BC;
+				m_mesh.m_halfEdges[BC].m_next = CA;
+				m_mesh.m_halfEdges[CA].m_next = AB;
+
+				m_mesh.m_halfEdges[BC].m_face = newFaceIndex;
+				m_mesh.m_halfEdges[CA].m_face = newFaceIndex;
+				m_mesh.m_halfEdges[AB].m_face = newFaceIndex;
+
+				m_mesh.m_halfEdges[CA].m_endVertex = A;
+				m_mesh.m_halfEdges[BC].m_endVertex = C;
+
+				auto& newFace = m_mesh.m_faces[newFaceIndex];
+				newFace.m_P = getTrianglePlane(A, B, C);
+				newFace.m_he = AB;
+
+				m_mesh.m_halfEdges[CA].m_opp = m_newHalfEdgeIndices[i>0 ? i*2-1 : 2*horizonEdgeCount-1];
+				m_mesh.m_halfEdges[BC].m_opp = m_newHalfEdgeIndices[((i+1)*2) % (horizonEdgeCount*2)];
+			}
+
+			// Assign points that were on the positive side of the disabled faces to the new faces.
+			for (auto& disabledPoints : m_disabledFacePointVectors) {
+				assert(disabledPoints);
+				for (const auto& point : *(disabledPoints)) {
+					if (point == activePointIndex) {
+						continue;
+					}
+					for (size_t j=0;j<horizonEdgeCount;j++) {
+						if (addPointToFace(m_mesh.m_faces[m_newFaceIndices[j]], point)) {
+							break;
+						}
+					}
+				}
+				reclaimToIndexVectorPool(disabledPoints);
+			}
+
+			// Increase face stack size if needed
+			for (const auto newFaceIndex : m_newFaceIndices) {
+				auto& newFace = m_mesh.m_faces[newFaceIndex];
+				if (newFace.m_pointsOnPositiveSide) {
+					assert(newFace.m_pointsOnPositiveSide->size()>0);
+					if (!newFace.m_inFaceStack) {
+						m_faceList.push_back(newFaceIndex);
+						newFace.m_inFaceStack = 1;
+					}
+				}
+			}
+		}
+
+		// Cleanup
+		m_indexVectorPool.clear();
+	}
+
+	template<typename T, typename I>
+	bool IntegerQuickHull<T,I>::reorderHorizonEdges(std::vector<size_t>& horizonEdges) {
+		const size_t horizonEdgeCount = horizonEdges.size();
+		for (size_t i=0;i<horizonEdgeCount-1;i++) {
+			const size_t endVertex = m_mesh.m_halfEdges[ horizonEdges[i] ].m_endVertex;
+			bool foundNext = false;
+			for (size_t j=i+1;j<horizonEdgeCount;j++) {
+				const size_t beginVertex = m_mesh.m_halfEdges[ m_mesh.m_halfEdges[horizonEdges[j]].m_opp ].m_endVertex;
+				if (beginVertex == endVertex) {
+					std::swap(horizonEdges[i+1],horizonEdges[j]);
+					foundNext = true;
+					break;
+				}
+			}
+			if (!foundNext) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template<typename T, typename I>
+	bool IntegerQuickHull<T,I>::setupInitialTetrahedron() {
+		const size_t vCount = m_points.size();
+
+		const auto& extremeValues = m_extremeValues;
+
+		// Largest value(i) over the points and the first point that has it. The maximum is a reduction that can be vectorized,
+		// the point is found by a second pass that stops there.
+		const auto findMaximum = [vCount](auto value) {
+			auto maxValue = value(0);
+			for (size_t i=1;i<vCount;i++) {
+				const auto v = value(i);
+				maxValue = v > maxValue ? v : maxValue;
+			}
+			size_t i = 0;
+			while (value(i) != maxValue) {
+				i++;
+			}
+			return std::make_pair(maxValue, i);
+		};
+
+		// The two most distant extreme points. Squared distances are at most 12C^2, in 64 bits.
+		std::int64_t maxD = 0;
+		std::pair<size_t,size_t> selectedPoints;
+		for (size_t i=0;i<6;i++) {
+			for (size_t j=i+1;j<6;j++) {
+				const ivec3 d = m_points[extremeValues[i]] - m_points[extremeValues[j]];
+				const std::int64_t sqrD = std::int64_t(d.x)*d.x + std::int64_t(d.y)*d.y + std::int64_t(d.z)*d.z;
+				if (sqrD > maxD) {
+					maxD = sqrD;
+					selectedPoints = {extremeValues[i],extremeValues[j]};
+				}
+			}
+		}
+		if (maxD == 0) {
+			return false;
+		}
+
+		// The point farthest from the line through them. The cross products are exact and at most 8C^2, their squared lengths
+		// are exact in WideType for int32 and rank the points in double for int64. They are zero only on the line.
+		const ivec3 a = m_points[selectedPoints.first];
+		const ivec3 ab = m_points[selectedPoints.second] - a;
+		const auto line = findMaximum([this, a, ab](size_t i) {
+			const ivec3 ap = m_points[i] - a;
+			const WideType x = static_cast<WideType>(ap.y*ab.z - ap.z*ab.y);
+			const WideType y = static_cast<WideType>(ap.z*ab.x - ap.x*ab.z);
+			const WideType z = static_cast<WideType>(ap.x*ab.y - ap.y*ab.x);
+			return x*x + y*y + z*z;
+		});
+		if (line.first == 0) {
+			return false;
+		}
+		size_t maxI = line.second;
+		std::array<size_t,3> baseTriangle{selectedPoints.first, selectedPoints.second, maxI};
+
+		// The point farthest from the plane of the triangle, on either side
+		const Plane<I> trianglePlane = getTrianglePlane(baseTriangle[0], baseTriangle[1], baseTriangle[2]);
+		const auto plane = findMaximum([this, &trianglePlane](size_t i) {
+			const I d = getSignedDistance(trianglePlane, i);
+			return d < 0 ? -d : d;
+		});
+		if (plane.first == 0) {
+			return false;
+		}
+		maxI = plane.second;
+
+		// CCW orientation like QuickHull
+		if (getSignedDistance(trianglePlane, maxI) > 0) {
+			std::swap(baseTriangle[0],baseTriangle[1]);
+		}
+		m_mesh.setup(baseTriangle[0],baseTriangle[1],baseTriangle[2],maxI);
+		for (auto& f : m_mesh.m_faces) {
+			const auto v = m_mesh.getVertexIndicesOfFace(f);
+			f.m_P = getTrianglePlane(v[0], v[1], v[2]);
+		}
+
+		// Assign a face for each point outside the tetrahedron. The vertices of the tetrahedron are on or behind every face.
+		for (size_t i=0;i<vCount;i++) {
+			for (auto& f : m_mesh.m_faces) {
+				if (addPointToFace(f, i)) {
+					break;
+				}
+			}
+		}
+		return true;
+	}
+
+	/*
+	 * Explicit template specifications for float and double with both determinant widths
+	 */
+
+	template class IntegerQuickHull<float, std::int32_t>;
+	template class IntegerQuickHull<float, std::int64_t>;
+	template class IntegerQuickHull<double, std::int32_t>;
+	template class IntegerQuickHull<double, std::int64_t>;
+}
@@ -0,0 +1,173 @@
+#ifndef INTEGERQUICKHULL_HPP_
+#define INTEGERQUICKHULL_HPP_
+#include <deque>
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstdint>
+#include <type_traits>
+#include "Structs/Vector3.hpp"
+#include "Structs/Plane.hpp"
+#include "Structs/Pool.hpp"
+#include "Structs/Mesh.hpp"
+#include "Structs/VertexDataSource.hpp"
+#include "ConvexHull.hpp"
+#include "QuickHull.hpp"
+
+/*
+ * QuickHull for points with small integer coordinates
+ *
+ * Colors of 8-bit images are points with integer coordinates in [0, 255]. For those the plane of three points and the
+ * signed distance of a point to it can be computed exactly in integers: with coordinates in [-C, C] the normal components
+ * are at most 8C^2 and the distance at most 48C^3, which fits int32 for C = 255 and int64 for C = 65535.
+ *
+ * With exact distances no epsilon is needed. A point is outside of a face only if its distance is strictly positive, so
+ * points on a face plane are never extruded to, and the faces visible from a point are exactly the ones it is strictly in
+ * front of. The visible faces then always form a disc and its horizon a single loop, so the horizon edge failures of
+ * QuickHull (DiagnosticsData::m_failedHorizonEdges) do not happen. Coplanar points are kept out of the hull instead of
+ * being resolved by the tolerance, so the hull can have coplanar neighbouring triangles but no concave edge.
+ *
+ * Point clouds without volume (fewer than four points not on one plane) are passed to QuickHull<FloatType>, which
+ * handles them with its tolerance.
+ * */
+
+namespace quickhull {
+
+	// Largest coordinate magnitude for which the distances of IntegerQuickHull fit IntType
+	template<typename IntType>
+	struct maxExactCoordinate
+	{
+	};
+
+	template<>
+	struct maxExactCoordinate<std::int32_t>
+	{
+		static inline constexpr std::int32_t value = 255;
+	};
+
+	template<>
+	struct maxExactCoordinate<std::int64_t>
+	{
+		static inline constexpr std::int64_t value = 65535;
+	};
+
+	template<typename FloatType, typename IntType = std::int32_t>
+	class IntegerQuickHull {
+		using vec3 = Vector3<FloatType>;
+		using ivec3 = Vector3<IntType>;
+		using WideType = typename std::conditional<sizeof(IntType) < 8, std::int64_t, double>::type; // squared cross product lengths
+	public:
+		static constexpr IntType MaxCoordinate = maxExactCoordinate<IntType>::value;
+	private:
+		VertexDataSource<FloatType> m_vertexData;
+		std::vector<ivec3> m_points; // m_vertexData in IntType
+		MeshBuilder<IntType> m_mesh; // m_sqrNLength of the face planes is not used and left 0
+		std::array<size_t,6> m_extremeValues;
+		DiagnosticsData m_diagnostics;
+		bool m_degenerate = false; // the last point cloud had no volume and its hull is the one of m_degenerateHull
+		QuickHull<FloatType> m_degenerateHull;
+
+		// Temporary variables used during iteration process, as in QuickHull
+		std::vector<size_t> m_newFaceIndices;
+		std::vector<size_t> m_newHalfEdgeIndices;
+		std::vector< std::unique_ptr<std::vector<size_t>> > m_disabledFacePointVectors;
+		std::vector<size_t> m_visibleFaces;
+		std::vector<size_t> m_horizonEdges;
+		struct FaceData {
+			size_t m_faceIndex;
+			size_t m_enteredFromHalfEdge; // If the face turns out not to be visible, this half edge will be marked as horizon edge
+			FaceData(size_t fi, size_t he) : m_faceIndex(fi),m_enteredFromHalfEdge(he) {}
+		};
+		std::vector<FaceData> m_possiblyVisibleFaces;
+		std::deque<size_t> m_faceList;
+		Pool<std::vector<size_t>> m_indexVectorPool;
+
+		inline std::unique_ptr<std::vector<size_t>> getIndexVectorFromPool();
+		inline void reclaimToIndexVectorPool(std::unique_ptr<std::vector<size_t>>& ptr);
+
+		// Plane through points a, b and c, the normal is (a-c)x(b-c) like mathutils::getTriangleNormal
+		Plane<IntType> getTrianglePlane(size_t a, size_t b, size_t c) const;
+
+		// Exact signed distance of a point to a plane, relative to the length of its normal
+		IntType getSignedDistance(const Plane<IntType>& P, size_t pointIndex) const {
+			return P.m_N.dotProduct(m_points[pointIndex])+P.m_D;
+		}
+
+		// Associates a point with a face if it is strictly on the positive side of its plane. Returns true if it was.
+		inline bool addPointToFace(typename MeshBuilder<IntType>::Face& f, size_t pointIndex);
+
+		// Creates the base tetrahedron from m_extremeValues and assigns the points to its faces. Returns false if the points do
+		// not span a volume.
+		bool setupInitialTetrahedron();
+
+		// Given a list of half edges, try to rearrange them so that they form a loop. Return true on success.
+		bool reorderHorizonEdges(std::vector<size_t>& horizonEdges);
+
+		void createConvexHalfEdgeMesh();
+	public:
+		// Computes the convex hull of a point cloud whose coordinates are integers in [-MaxCoordinate, MaxCoordinate], see
+		// hasIntegerCoordinates. The parameters are the ones of QuickHull::getConvexHull, there is no epsilon.
+		ConvexHull<FloatType> getConvexHull(const std::vector<Vector3<FloatType>>& pointCloud, bool CCW, bool useOriginalIndices);
+		ConvexHull<FloatType> getConvexHull(const VertexDataSource<FloatType>& pointCloud, bool CCW, bool useOriginalIndices);
+
+		// Whether every coordinate of the points is an integer in [-MaxCoordinate, MaxCoordinate]
+		static bool hasIntegerCoordinates(const VertexDataSource<FloatType>& pointCloud);
+
+		// Get diagnostics about last generated convex hull. m_failedHorizonEdges stays 0 unless the point cloud had no volume
+		// and was passed to QuickHull.
+		const DiagnosticsData& getDiagnostics() {
+			return m_degenerate ? m_degenerateHull.getDiagnostics() : m_diagnostics;
+		}
+
+		// Whether the last point cloud had no volume and its hull was computed by QuickHull
+		bool isDegenerate() const {
+			return m_degenerate;
+		}
+
+		// Get the planes of the faces of last generated convex hull, in face order like QuickHull::getFacePlanes. Normals point
+		// outwards and are not normalized; they are exact, the offsets are rounded to FloatType.
+		std::vector<Plane<FloatType>> getFacePlanes() const;
+	};
+
+	/*
+	 * Inline function definitions
+	 */
+
+	template<typename T, typename I>
+	std::unique_ptr<std::vector<size_t>> IntegerQuickHull<T,I>::getIndexVectorFromPool() {
+		auto r = std::move(m_indexVectorPool.get());
+		r->clear();
+		return r;
+	}
+
+	template<typename T, typename I>
+	void IntegerQuickHull<T,I>::reclaimToIndexVectorPool(std::unique_ptr<std::vector<size_t>>& ptr) {
+		const size_t oldSize = ptr->size();
+		if ((oldSize+1)*128 < ptr->capacity()) {
+			ptr.reset(nullptr);
+			return;
+		}
+		m_indexVectorPool.reclaim(ptr);
+	}
+
+	template<typename T, typename I>
+	bool IntegerQuickHull<T,I>::addPointToFace(typename MeshBuilder<I>::Face& f, size_t pointIndex) {
+		const I D = getSignedDistance(f.m_P, pointIndex);
+		if (D>0) {
+			if (!f.m_pointsOnPositiveSide) {
+				f.m_pointsOnPositiveSide = std::move(getIndexVectorFromPool());
+			}
+			f.m_pointsOnPositiveSide->push_back( pointIndex );
+			if (D > f.m_mostDistantPointDist) {
+				f.m_mostDistantPointDist = D;
+				f.m_mostDistantPoint = pointIndex;
+			}
+			return true;
+		}
+		return false;
+	}
+
+}
+
+
+#endif /* INTEGERQUICKHULL_HPP_ */
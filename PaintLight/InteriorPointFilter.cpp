@@ -0,0 +1,200 @@
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <cassert>
+#include "DXUT.h"
+#include "InteriorPointFilter.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace quickhull {
+
+	template<typename T>
+	void InteriorPointFilter<T>::setThreadCount(size_t threads) {
+#ifdef _OPENMP
+		m_threadCount = threads ? threads : static_cast<size_t>(omp_get_max_threads());
+#else
+		m_threadCount = 1;
+#endif
+	}
+
+	template<typename T>
+	size_t InteriorPointFilter<T>::filter(std::vector<Vector3<T>>& pointCloud, T eps) {
+		if (!setPolytope(pointCloud, eps)) {
+			return 0;
+		}
+		return removeInteriorPoints(pointCloud);
+	}
+
+	template<typename T>
+	bool InteriorPointFilter<T>::setPolytope(const VertexDataSource<T>& vertexData, T eps) {
+		m_planes.clear();
+		if (vertexData.size() <= DirectionCount) {
+			return false;
+		}
+
+		// Hull of the extreme points
+		const auto extremePoints = getExtremePoints(vertexData);
+		std::vector<vec3> polytopePoints;
+		T scale = 0;
+		for (const auto i : extremePoints) {
+			polytopePoints.push_back(vertexData[i]);
+			scale = std::max({scale, std::abs(vertexData[i].x), std::abs(vertexData[i].y), std::abs(vertexData[i].z)});
+		}
+		QuickHull<T> qh;
+		qh.getConvexHull(polytopePoints, true, false, eps);
+
+		// A point is kept if it is outside of one of the planes moved outwards by eps*scale. If all the extreme points are
+		// within that distance of a face plane, they are coplanar (QuickHull has added a point of its own off their plane)
+		// and nothing is inside.
+		const T margin = eps*scale;
+		for (const auto& P : qh.getFacePlanes()) {
+			const T offset = margin*std::sqrt(P.m_sqrNLength);
+			const bool flat = std::all_of(polytopePoints.begin(), polytopePoints.end(), [&](const vec3& v) {
+				return std::abs(P.m_N.dotProduct(v)+P.m_D) <= offset;
+			});
+			if (flat) {
+				m_planes.clear();
+				return false;
+			}
+			m_planes.push_back({P.m_N, P.m_D + offset, T(0)});
+		}
+		assert(m_planes.size() <= MaxPlaneCount);
+		return true;
+	}
+
+	template<typename T>
+	size_t InteriorPointFilter<T>::removeInteriorPoints(std::vector<Vector3<T>>& pointCloud) {
+		const size_t vCount = pointCloud.size();
+		if (m_planes.empty() || vCount == 0) {
+			return 0;
+		}
+		classify(pointCloud);
+
+		// Move the kept points to the front, in order
+		constexpr std::uint8_t Interior = std::numeric_limits<std::uint8_t>::max();
+		size_t kept = 0;
+		for (size_t i=0;i<vCount;i++) {
+			if (m_pointSlots[i] != Interior) {
+				pointCloud[kept++] = pointCloud[i];
+			}
+		}
+		pointCloud.resize(kept);
+		std::vector<std::uint8_t>().swap(m_pointSlots);
+		return vCount-kept;
+	}
+
+	template<typename T>
+	size_t InteriorPointFilter<T>::copyExteriorPoints(const VertexDataSource<T>& pointCloud, std::vector<Vector3<T>>& exteriorPoints) {
+		const size_t vCount = pointCloud.size();
+		if (m_planes.empty() || vCount == 0) {
+			exteriorPoints.insert(exteriorPoints.end(), pointCloud.begin(), pointCloud.end());
+			return 0;
+		}
+		classify(pointCloud);
+		constexpr std::uint8_t Interior = std::numeric_limits<std::uint8_t>::max();
+		const size_t kept = vCount - static_cast<size_t>(std::count(m_pointSlots.begin(), m_pointSlots.end(), Interior));
+		exteriorPoints.reserve(exteriorPoints.size()+kept);
+		for (size_t i=0;i<vCount;i++) {
+			if (m_pointSlots[i] != Interior) {
+				exteriorPoints.push_back(pointCloud[i]);
+			}
+		}
+		std::vector<std::uint8_t>().swap(m_pointSlots);
+		return vCount-kept;
+	}
+
+	template<typename T>
+	void InteriorPointFilter<T>::classify(const VertexDataSource<T>& vertexData) {
+		const size_t vCount = vertexData.size();
+		m_pointSlots.resize(vCount);
+		forEachBlock(vCount, [&](size_t, size_t begin, size_t end) {
+			std::array<ClassificationResult<T>,MaxPlaneCount> results;
+			classifyPoints(vertexData, [](size_t i) { return i; }, begin, end, std::numeric_limits<size_t>::max(), m_planes.data(), m_planes.size(),
+						   m_pointSlots.data(), results.data(), m_vectorizedClassification);
+		});
+	}
+
+	template<typename T>
+	size_t InteriorPointFilter<T>::getBlockCount(size_t count) const {
+		if (m_threadCount <= 1 || count < ParallelMinPoints) {
+			return 1;
+		}
+		return (count + ParallelBlockSize - 1) / ParallelBlockSize;
+	}
+
+	template<typename T>
+	template<typename F>
+	void InteriorPointFilter<T>::forEachBlock(size_t count, F f) {
+		const size_t blockCount = getBlockCount(count);
+		if (blockCount == 1) {
+			f(0, 0, count);
+			return;
+		}
+#pragma omp parallel for schedule(dynamic, 1) num_threads(static_cast<int>(m_threadCount))
+		for (std::ptrdiff_t b = 0; b < static_cast<std::ptrdiff_t>(blockCount); b++) {
+			const size_t begin = static_cast<size_t>(b)*ParallelBlockSize;
+			f(static_cast<size_t>(b), begin, std::min(begin+ParallelBlockSize, count));
+		}
+	}
+
+	template<typename T>
+	std::array<size_t,InteriorPointFilter<T>::DirectionCount> InteriorPointFilter<T>::getExtremePoints(const VertexDataSource<T>& vertexData) {
+		// Projections onto the axes and the diagonals, then the same negated for the minima
+		const auto project = [](const vec3& v, T* p) {
+			p[0] = v.x;
+			p[1] = v.y;
+			p[2] = v.z;
+			p[3] = v.x+v.y+v.z;
+			p[4] = v.x+v.y-v.z;
+			p[5] = v.x-v.y+v.z;
+			p[6] = -v.x+v.y+v.z;
+			for (size_t k=0;k<DirectionCount/2;k++) {
+				p[DirectionCount/2+k] = -p[k];
+			}
+		};
+		struct Extremes {
+			T vals[DirectionCount];
+			std::array<size_t,DirectionCount> indices;
+		};
+		Extremes first;
+		project(vertexData[0], first.vals);
+		first.indices.fill(0);
+
+		// Extremes of each block, merged in block order so that ties go to the lowest index like in a single scan
+		const size_t vCount = vertexData.size();
+		std::vector<Extremes> blocks(getBlockCount(vCount), first);
+		forEachBlock(vCount, [&](size_t block, size_t begin, size_t end) {
+			Extremes e = blocks[block];
+			for (size_t i=std::max<size_t>(begin,1);i<end;i++) {
+				T p[DirectionCount];
+				project(vertexData[i], p);
+				for (size_t k=0;k<DirectionCount;k++) {
+					if (p[k] > e.vals[k]) {
+						e.vals[k] = p[k];
+						e.indices[k] = i;
+					}
+				}
+			}
+			blocks[block] = e;
+		});
+		Extremes result = first;
+		for (const auto& e : blocks) {
+			for (size_t k=0;k<DirectionCount;k++) {
+				if (e.vals[k] > result.vals[k]) {
+					result.vals[k] = e.vals[k];
+					result.indices[k] = e.indices[k];
+				}
+			}
+		}
+		return result.indices;
+	}
+
+	/*
+	 * Explicit template specifications for float and double
+	 */
+
+	template class InteriorPointFilter<float>;
+	template class InteriorPointFilter<double>;
+}
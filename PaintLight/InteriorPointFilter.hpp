@@ -0,0 +1,89 @@
+#ifndef INTERIORPOINTFILTER_HPP_
+#define INTERIORPOINTFILTER_HPP_
+#include <vector>
+#include <array>
+#include <cstdint>
+#include "Structs/Vector3.hpp"
+#include "Structs/VertexDataSource.hpp"
+#include "QuickHull.hpp"
+#include "PlaneKernels.hpp"
+
+/*
+ * Akl-Toussaint interior point filter
+ *
+ * Points strictly inside the convex hull of some of the points of a cloud are not vertices of the convex hull of the
+ * cloud. The filter takes the extreme points of the cloud along 14 directions (the 3 axes and the 4 diagonals of the
+ * cube, both ways), builds their convex hull and removes every point that is inside all its face planes by more than eps
+ * times the scale of the cloud, the tolerance QuickHull uses, so points on or near its boundary stay.
+ *
+ * The remaining points have the same exact convex hull, and QuickHull still gives a hull that every point is within the
+ * tolerance of. It is not the same hull though: QuickHull visits other points on the way, so among the points within
+ * the tolerance of a face it can pick other vertices, and the triangulation changes with them (on 200k point clouds,
+ * up to about 10% of the faces differ).
+ * */
+
+namespace quickhull {
+
+	template<typename FloatType>
+	class InteriorPointFilter {
+		using vec3 = Vector3<FloatType>;
+		static constexpr size_t DirectionCount = 14;
+		static constexpr size_t MaxPlaneCount = 2*DirectionCount-4; // triangles of the hull of DirectionCount points
+		static constexpr size_t ParallelBlockSize = 4096; // points per task
+		static constexpr size_t ParallelMinPoints = 32768; // fewer points are filtered on the calling thread
+
+		size_t m_threadCount = 1;
+		bool m_vectorizedClassification = true;
+		std::vector<ClassificationPlane<FloatType>> m_planes;
+		std::vector<std::uint8_t> m_pointSlots; // first plane each point is outside of, 255 for the interior points
+
+		size_t getBlockCount(size_t count) const;
+		template<typename F>
+		void forEachBlock(size_t count, F f);
+
+		// Indices of the points with the largest projection onto each direction, the first of equals
+		std::array<size_t,DirectionCount> getExtremePoints(const VertexDataSource<FloatType>& vertexData);
+
+		// Fills m_pointSlots for the points against m_planes
+		void classify(const VertexDataSource<FloatType>& vertexData);
+	public:
+		// Removes the points strictly inside the hull of the extreme points from pointCloud, keeping the order of the
+		// others, and returns how many were removed. The capacity of pointCloud is left to the caller. Clouds whose extreme
+		// points do not span a volume are left as they are.
+		size_t filter(std::vector<Vector3<FloatType>>& pointCloud, FloatType eps = defaultEps<FloatType>::value);
+
+		// The two steps of filter, for removing points with the polytope of another cloud. setPolytope builds the polytope of
+		// the extreme points of pointCloud and returns false if they do not span a volume, removeInteriorPoints removes the
+		// points inside the last polytope like filter does (none if there is no polytope).
+		bool setPolytope(const VertexDataSource<FloatType>& pointCloud, FloatType eps = defaultEps<FloatType>::value);
+		size_t removeInteriorPoints(std::vector<Vector3<FloatType>>& pointCloud);
+
+		// Appends the points of pointCloud outside the last polytope to exteriorPoints, in order, and returns how many were
+		// left out. For clouds that are a view of other data (e.g. RGBA pixels) and would otherwise be copied whole.
+		size_t copyExteriorPoints(const VertexDataSource<FloatType>& pointCloud, std::vector<Vector3<FloatType>>& exteriorPoints);
+
+		// Same as QuickHull::setThreadCount
+		void setThreadCount(size_t threads);
+		size_t getThreadCount() const {
+			return m_threadCount;
+		}
+
+		// Same as QuickHull::setVectorizedClassification
+		void setVectorizedClassification(bool enabled) {
+			m_vectorizedClassification = enabled;
+		}
+		bool getVectorizedClassification() const {
+			return m_vectorizedClassification;
+		}
+
+		// Face planes of the filter polytope of the last filter or setPolytope call, moved outwards by the tolerance. Empty if
+		// the extreme points did not span a volume.
+		const std::vector<ClassificationPlane<FloatType>>& getPlanes() const {
+			return m_planes;
+		}
+	};
+
+}
+
+
+#endif /* INTERIORPOINTFILTER_HPP_ */
@@ -3,6 +3,7 @@
 #include "DXUT.h"
 #include "d3d11helper.h"
 #include "RGBAImage.h"
+#include "ScalarImage.h"
 #include "MulScalar.h"
 #include "ImageMinMax.h"
 
@@ -107,7 +108,7 @@ public:
 		ID3D11Device *device,
 		ID3D11DeviceContext *context,
 		RGBAImageGPU const &input,
-		RGBAImageGPU const &strokeDensity,
+		ScalarImageGPU const &strokeDensity,
 		float light_source_x,
 		float light_source_y,
 		float light_source_z,
@@ -181,7 +182,7 @@ public:
 		ID3D11Device *device,
 		ID3D11DeviceContext *context,
 		RGBAImageGPU const &input,
-		RGBAImageGPU const &strokeDensity,
+		ScalarImageGPU const &strokeDensity,
 		float light_source_x,
 		float light_source_y,
 		float light_source_z,
@@ -2,7 +2,7 @@
 #define THREAD_COUNT 32
 
 Texture2D<float4>   g_srcImage            : register(t0);
-Texture2D<float4>   g_srcStrokeDensity    : register(t1);
+Texture2D<float>    g_srcStrokeDensity    : register(t1);
 
 RWTexture2D<float4> g_dstSobelX           : register(u0);
 RWTexture2D<float4> g_dstSobelY           : register(u1);
@@ -120,7 +120,7 @@ void sobel(uint3 groupThreadID : SV_GroupThreadID, uint3 dispatchThreadId : SV_D
 [numthreads(THREAD_COUNT, THREAD_COUNT, 1)]
 void main(uint3 dispatchThreadId : SV_DispatchThreadID)
 {
-	float density_scaled = clamp(g_srcStrokeDensity.Load(dispatchThreadId).r, 0.0f, 1.0f);
+	float density_scaled = clamp(g_srcStrokeDensity.Load(dispatchThreadId), 0.0f, 1.0f);
 	float density = sqrt(1.0f - density_scaled * density_scaled + 1e-10);
 	float3 sobelX = g_srcSobelXnormalized.Load(dispatchThreadId).rgb;
 	float3 sobelY = g_srcSobelYnormalized.Load(dispatchThreadId).rgb;
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file, or a writable mapping of a new file of a given size
+class MappedFile
+{
+private:
+	void const *m_data;
+	std::size_t m_size;
+	bool m_writable;
+#ifdef _WIN32
+	HANDLE m_file;
+	HANDLE m_mapping;
+#else
+	int m_fd;
+#endif
+public:
+	MappedFile() :
+		m_data(nullptr),
+		m_size(0),
+		m_writable(false),
+#ifdef _WIN32
+		m_file(INVALID_HANDLE_VALUE),
+		m_mapping(nullptr)
+#else
+		m_fd(-1)
+#endif
+	{
+
+	}
+	// maps nothing if the file does not exist or is empty
+	explicit MappedFile(std::filesystem::path const &filename) : MappedFile()
+	{
+#ifdef _WIN32
+		m_file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+			return;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, std::addressof(size)) || size.QuadPart == 0)
+		{
+			Release();
+			return;
+		}
+		m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping)
+		{
+			Release();
+			return;
+		}
+		m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!m_data)
+		{
+			Release();
+			return;
+		}
+		m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+		m_fd = open(filename.c_str(), O_RDONLY);
+		if (m_fd < 0)
+			return;
+		struct stat st;
+		if (fstat(m_fd, std::addressof(st)) != 0 || st.st_size == 0)
+		{
+			Release();
+			return;
+		}
+		void *data(mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, m_fd, 0));
+		if (data == MAP_FAILED)
+		{
+			Release();
+			return;
+		}
+		m_data = data;
+		m_size = static_cast<std::size_t>(st.st_size);
+#endif
+	}
+	// creates (or truncates) the file with size bytes and maps it for writing, maps nothing on failure
+	MappedFile(std::filesystem::path const &filename, std::size_t size) : MappedFile()
+	{
+		if (size == 0)
+			return;
+#ifdef _WIN32
+		m_file = CreateFileW(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+			return;
+		m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(std::uint64_t(size) >> 32), static_cast<DWORD>(size), nullptr);
+		if (!m_mapping)
+		{
+			Release();
+			return;
+		}
+		m_data = MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, size);
+		if (!m_data)
+		{
+			Release();
+			return;
+		}
+#else
+		m_fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (m_fd < 0)
+			return;
+		if (ftruncate(m_fd, static_cast<off_t>(size)) != 0)
+		{
+			Release();
+			return;
+		}
+		void *data(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0));
+		if (data == MAP_FAILED)
+		{
+			Release();
+			return;
+		}
+		m_data = data;
+#endif
+		m_size = size;
+		m_writable = true;
+	}
+	~MappedFile()
+	{
+		Release();
+	}
+	MappedFile(MappedFile const &other) = delete;
+	MappedFile &operator=(MappedFile const &other) = delete;
+	MappedFile(MappedFile &&other) noexcept : MappedFile()
+	{
+		Swap(other);
+	}
+	MappedFile &operator=(MappedFile &&other) noexcept
+	{
+		if (std::addressof(other) != this)
+		{
+			Release();
+			Swap(other);
+		}
+		return *this;
+	}
+	void Release() noexcept
+	{
+#ifdef _WIN32
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+		m_mapping = nullptr;
+#else
+		if (m_data)
+			munmap(const_cast<void *>(m_data), m_size);
+		if (m_fd >= 0)
+			close(m_fd);
+		m_fd = -1;
+#endif
+		m_data = nullptr;
+		m_size = 0;
+		m_writable = false;
+	}
+public:
+	void const *data() const { return m_data; }
+	// null unless mapped for writing
+	void *writable_data() const { return m_writable ? const_cast<void *>(m_data) : nullptr; }
+	std::size_t size() const { return m_size; }
+	operator bool() const
+	{
+		return m_data != nullptr;
+	}
+private:
+	void Swap(MappedFile &other) noexcept
+	{
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_writable, other.m_writable);
+#ifdef _WIN32
+		std::swap(m_file, other.m_file);
+		std::swap(m_mapping, other.m_mapping);
+#else
+		std::swap(m_fd, other.m_fd);
+#endif
+	}
+};
@@ -3,15 +3,17 @@
 #include "DXUT.h"
 #include "d3d11helper.h"
 #include "RGBAImage.h"
+#include "ScalarImage.h"
 
 class MulImage
 {
 private:
 	std::size_t const GroupThreads = 32;
 	ID3D11ComputeShader *m_cs;
+	ID3D11ComputeShader *m_csBroadcast; // second input is a ScalarImageGPU
 
 public:
-	MulImage() : m_cs(nullptr)
+	MulImage() : m_cs(nullptr), m_csBroadcast(nullptr)
 	{
 		;
 	}
@@ -20,12 +22,18 @@ public:
 		ID3DBlob *csByteCodes{ nullptr };
 		THROW(CompileShader(L"MulImage.hlsl", nullptr, "main", "cs_5_0", std::addressof(csByteCodes)));
 		THROW(device->CreateComputeShader(csByteCodes->GetBufferPointer(), csByteCodes->GetBufferSize(), nullptr, std::addressof(m_cs)));
+
+		D3D_SHADER_MACRO const broadcastDefines[] = { { "BROADCAST", "1" }, { nullptr, nullptr } };
+		ID3DBlob *csByteCodesBroadcast{ nullptr };
+		THROW(CompileShader(L"MulImage.hlsl", broadcastDefines, "main", "cs_5_0", std::addressof(csByteCodesBroadcast)));
+		THROW(device->CreateComputeShader(csByteCodesBroadcast->GetBufferPointer(), csByteCodesBroadcast->GetBufferSize(), nullptr, std::addressof(m_csBroadcast)));
 	}
 
 	void Release() noexcept
 	{
 		try {
 			SAFE_RELEASE(m_cs);
+			SAFE_RELEASE(m_csBroadcast);
 		}
 		catch (...) {
 
@@ -40,9 +48,10 @@ public:
 	MulImage(MulImage const &other) = delete;
 	MulImage &operator=(MulImage const &other) = delete;
 
-	MulImage(MulImage &&other) noexcept : m_cs(other.m_cs)
+	MulImage(MulImage &&other) noexcept : m_cs(other.m_cs), m_csBroadcast(other.m_csBroadcast)
 	{
 		other.m_cs = nullptr;
+		other.m_csBroadcast = nullptr;
 	}
 	MulImage &operator=(MulImage &&other) noexcept
 	{
@@ -50,7 +59,9 @@ public:
 		{
 			Release();
 			m_cs = other.m_cs;
+			m_csBroadcast = other.m_csBroadcast;
 			other.m_cs = nullptr;
+			other.m_csBroadcast = nullptr;
 		}
 		return *this;
 	}
@@ -60,14 +71,37 @@ public:
 		if (input != input2)
 			throw std::runtime_error("two inputs shape mismatch");
 
+		Dispatch(context, m_cs, input, input2.srv, ans);
+	}
+	// every channel of input times the one of input2
+	void operator()(ID3D11Device *device, ID3D11DeviceContext *context, RGBAImageGPU const &input, ScalarImageGPU const &input2, RGBAImageGPU &ans)
+	{
+		if (input.width != input2.width || input.height != input2.height)
+			throw std::runtime_error("two inputs shape mismatch");
+
+		Dispatch(context, m_csBroadcast, input, input2.srv, ans);
+	}
+	RGBAImageGPU operator()(ID3D11Device *device, ID3D11DeviceContext *context, RGBAImageGPU const &input, RGBAImageGPU const &input2)
+	{
+		RGBAImageGPU ans(device, input); // empty_like
+		this->operator()(device, context, input, input2, ans);
+		return ans;
+	}
+	RGBAImageGPU operator()(ID3D11Device *device, ID3D11DeviceContext *context, RGBAImageGPU const &input, ScalarImageGPU const &input2)
+	{
+		RGBAImageGPU ans(device, input); // empty_like
+		this->operator()(device, context, input, input2, ans);
+		return ans;
+	}
+private:
+	void Dispatch(ID3D11DeviceContext *context, ID3D11ComputeShader *cs, RGBAImageGPU const &input, ID3D11ShaderResourceView *input2, RGBAImageGPU &ans)
+	{
 		if (input != ans)
 			throw std::runtime_error("input and output shape mismatch");
 
-		D3D11_MAPPED_SUBRESOURCE mappedResource;
-
-		context->CSSetShader(m_cs, nullptr, 0);
+		context->CSSetShader(cs, nullptr, 0);
 		context->CSSetShaderResources(0, 1, std::addressof(input.srv));
-		context->CSSetShaderResources(1, 1, std::addressof(input2.srv));
+		context->CSSetShaderResources(1, 1, std::addressof(input2));
 		context->CSSetUnorderedAccessViews(0, 1, std::addressof(ans.uav), nullptr);
 
 		std::size_t groupX(((input.width - 1) / GroupThreads) + 1);
@@ -79,10 +113,4 @@ public:
 		context->CSSetShaderResources(0, 1, std::addressof(g_nullSRV));
 		context->CSSetShaderResources(1, 1, std::addressof(g_nullSRV));
 	}
-	RGBAImageGPU operator()(ID3D11Device *device, ID3D11DeviceContext *context, RGBAImageGPU const &input, RGBAImageGPU const &input2)
-	{
-		RGBAImageGPU ans(device, input); // empty_like
-		this->operator()(device, context, input, input2, ans);
-		return ans;
-	}
 };
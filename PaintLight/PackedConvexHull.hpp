@@ -0,0 +1,191 @@
+#ifndef PACKEDCONVEXHULL_HPP_
+#define PACKEDCONVEXHULL_HPP_
+
+#include "Structs/Vector3.hpp"
+#include "Structs/Plane.hpp"
+#include "Structs/Mesh.hpp"
+#include "Structs/VertexDataSource.hpp"
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <cstdint>
+#include <limits>
+
+namespace quickhull {
+
+	// Convex hull laid out for queries: a flat vertex array, 32 bit indices and, per face, what a ray or point query
+	// needs without going back to the vertices. Face f is the triangle m_indices[3f], m_indices[3f+1], m_indices[3f+2]
+	// in the order of the ConvexHull index buffer, its edge k goes from corner k to corner (k+1)%3 and m_adjacency[3f+k]
+	// is the face on the other side of that edge.
+	template<typename T>
+	class PackedConvexHull {
+	public:
+		static constexpr std::uint32_t NoFace = std::numeric_limits<std::uint32_t>::max();
+
+		// First corner and the edges from it to the other two, as used by the Moller-Trumbore ray test
+		struct Triangle {
+			Vector3<T> m_v0;
+			Vector3<T> m_e1;
+			Vector3<T> m_e2;
+		};
+	private:
+		std::vector<Vector3<T>> m_vertices;
+		std::vector<std::uint32_t> m_indices;
+		std::vector<Triangle> m_triangles;
+		std::vector<Plane<T>> m_planes;
+		std::vector<std::uint32_t> m_adjacency;
+
+		std::uint32_t addVertex(size_t v, const VertexDataSource<T>& pointCloud, std::unordered_map<size_t,std::uint32_t>& vertexIndexMapping) {
+			auto it = vertexIndexMapping.find(v);
+			if (it == vertexIndexMapping.end()) {
+				m_vertices.push_back(pointCloud[v]);
+				it = vertexIndexMapping.emplace(v, static_cast<std::uint32_t>(m_vertices.size()-1)).first;
+			}
+			return it->second;
+		}
+
+		void addTriangle(size_t f) {
+			const Vector3<T>& v0 = m_vertices[m_indices[f*3+0]];
+			const Vector3<T>& v1 = m_vertices[m_indices[f*3+1]];
+			const Vector3<T>& v2 = m_vertices[m_indices[f*3+2]];
+			m_triangles.push_back({v0, v1 - v0, v2 - v0});
+		}
+	public:
+		PackedConvexHull() {}
+
+		// From the half edge mesh of QuickHull: faces and vertices in the same order as ConvexHull(mesh, pointCloud, CCW, false),
+		// planes from the mesh faces (normalized) and adjacency from the opposite half edges
+		PackedConvexHull(const MeshBuilder<T>& mesh, const VertexDataSource<T>& pointCloud, bool CCW) {
+			std::vector<std::uint32_t> faceIndex(mesh.m_faces.size(), NoFace);
+			std::vector<size_t> faceOrder;
+			std::vector<size_t> faceStack;
+			std::unordered_map<size_t,std::uint32_t> vertexIndexMapping;
+			for (size_t i = 0;i<mesh.m_faces.size();i++) {
+				if (!mesh.m_faces[i].isDisabled()) {
+					faceStack.push_back(i);
+					break;
+				}
+			}
+			const size_t iCCW = CCW ? 1 : 0;
+			const size_t finalMeshFaceCount = mesh.m_faces.size() - mesh.m_disabledFaces.size();
+			faceOrder.reserve(finalMeshFaceCount);
+			m_indices.reserve(finalMeshFaceCount*3);
+			m_triangles.reserve(finalMeshFaceCount);
+			m_planes.reserve(finalMeshFaceCount);
+
+			// same depth first traversal as ConvexHull
+			while (faceStack.size()) {
+				size_t top = faceStack.back();
+				faceStack.pop_back();
+				if (faceIndex[top] != NoFace) {
+					continue;
+				}
+				faceIndex[top] = static_cast<std::uint32_t>(faceOrder.size());
+				faceOrder.push_back(top);
+				const auto& face = mesh.m_faces[top];
+				auto halfEdges = mesh.getHalfEdgeIndicesOfFace(face);
+				for (auto he : halfEdges) {
+					size_t a = mesh.m_halfEdges[mesh.m_halfEdges[he].m_opp].m_face;
+					if (faceIndex[a] == NoFace && !mesh.m_faces[a].isDisabled()) {
+						faceStack.push_back(a);
+					}
+				}
+				auto vertices = mesh.getVertexIndicesOfFace(face);
+				std::array<std::uint32_t,3> packed;
+				for (size_t k = 0;k<3;k++) {
+					packed[k] = addVertex(vertices[k], pointCloud, vertexIndexMapping);
+				}
+				m_indices.push_back(packed[0]);
+				m_indices.push_back(packed[1 + iCCW]);
+				m_indices.push_back(packed[2 - iCCW]);
+				addTriangle(faceOrder.size()-1);
+				m_planes.emplace_back(face.m_P.m_N.getNormalized(), pointCloud[vertices[0]]);
+			}
+
+			// half edge k of a face ends at vertex k, so it runs from vertex 2, 0, 1 to vertex 0, 1, 2. The edges of the
+			// triangle are (0,1) (1,2) (2,0), or (0,2) (2,1) (1,0) with the CCW swap.
+			m_adjacency.reserve(faceOrder.size()*3);
+			for (size_t top : faceOrder) {
+				auto halfEdges = mesh.getHalfEdgeIndicesOfFace(mesh.m_faces[top]);
+				const std::array<size_t,3> edge = CCW ? std::array<size_t,3>{halfEdges[0], halfEdges[2], halfEdges[1]}
+													  : std::array<size_t,3>{halfEdges[1], halfEdges[2], halfEdges[0]};
+				for (auto he : edge) {
+					m_adjacency.push_back(faceIndex[mesh.m_halfEdges[mesh.m_halfEdges[he].m_opp].m_face]);
+				}
+			}
+		}
+
+		// From any triangle buffers, e.g. a ConvexHull or a simplified hull, wound like ConvexHull with the same CCW. Vertices
+		// are copied as they are, planes are computed from the triangles (e1 x e2 points inwards for CCW triangles of
+		// QuickHull, outwards otherwise), adjacency by matching each edge with its reverse, NoFace where the mesh is not closed.
+		template<typename IndexBuffer, typename VertexBuffer>
+		PackedConvexHull(const IndexBuffer& indexBuffer, const VertexBuffer& vertexBuffer, bool CCW) {
+			const size_t faceCount = indexBuffer.size()/3;
+			m_vertices.reserve(vertexBuffer.size());
+			for (size_t i = 0;i<vertexBuffer.size();i++) {
+				m_vertices.push_back(vertexBuffer[i]);
+			}
+			m_indices.reserve(faceCount*3);
+			for (size_t i = 0;i<faceCount*3;i++) {
+				m_indices.push_back(static_cast<std::uint32_t>(indexBuffer[i]));
+			}
+			m_triangles.reserve(faceCount);
+			m_planes.reserve(faceCount);
+			std::unordered_map<std::uint64_t,std::uint32_t> edgeFace;
+			edgeFace.reserve(faceCount*3);
+			for (size_t f = 0;f<faceCount;f++) {
+				addTriangle(f);
+				const Triangle& t = m_triangles.back();
+				Vector3<T> N = t.m_e1.crossProduct(t.m_e2).getNormalized();
+				m_planes.emplace_back(CCW ? -N : N, t.m_v0);
+				for (size_t k = 0;k<3;k++) {
+					edgeFace[edgeKey(m_indices[f*3+k], m_indices[f*3+(k+1)%3])] = static_cast<std::uint32_t>(f);
+				}
+			}
+			m_adjacency.reserve(faceCount*3);
+			for (size_t f = 0;f<faceCount;f++) {
+				for (size_t k = 0;k<3;k++) {
+					auto it = edgeFace.find(edgeKey(m_indices[f*3+(k+1)%3], m_indices[f*3+k]));
+					m_adjacency.push_back(it == edgeFace.end() ? NoFace : it->second);
+				}
+			}
+		}
+
+		size_t getFaceCount() const {
+			return m_triangles.size();
+		}
+
+		const std::vector<Vector3<T>>& getVertexBuffer() const {
+			return m_vertices;
+		}
+
+		const std::vector<std::uint32_t>& getIndexBuffer() const {
+			return m_indices;
+		}
+
+		const std::vector<Triangle>& getTriangles() const {
+			return m_triangles;
+		}
+
+		// Normals point outwards and have length 1, so m_N.dotProduct(p)+m_D is the signed distance of p
+		const std::vector<Plane<T>>& getPlanes() const {
+			return m_planes;
+		}
+
+		const std::vector<std::uint32_t>& getAdjacency() const {
+			return m_adjacency;
+		}
+
+		size_t getMemoryUsage() const {
+			return m_vertices.capacity()*sizeof(Vector3<T>) + m_indices.capacity()*sizeof(std::uint32_t) + m_triangles.capacity()*sizeof(Triangle) +
+				   m_planes.capacity()*sizeof(Plane<T>) + m_adjacency.capacity()*sizeof(std::uint32_t);
+		}
+	private:
+		static std::uint64_t edgeKey(std::uint32_t from, std::uint32_t to) {
+			return (static_cast<std::uint64_t>(from) << 32) | to;
+		}
+	};
+
+}
+
+#endif /* PACKEDCONVEXHULL_HPP_ */
@@ -66,6 +66,8 @@ void CALLBACK OnGUIEvent(UINT nEvent, int nControlID, CDXUTControl *pControl, vo
 #define IDC_GAMMACOR_TEXT 16
 #define IDC_GAMMACOR 17
 
+#define IDC_SAVE_INTERMEDIATES 18
+
 //------------------------
 //   PaintLight stuffs
 //------------------------
@@ -176,7 +178,7 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
             g_screenQuad.Draw(pd3dImmediateContext, g_paintLight.palette_GPU.srv, 0.0f, 255.0f, g_paintLight.gamma_correction);
             break;
         case 3:
-            g_screenQuad.Draw(pd3dImmediateContext, g_paintLight.stroke_density_GPU.srv, 0.0f, 1.0f, g_paintLight.gamma_correction);
+            g_screenQuad.Draw(pd3dImmediateContext, g_paintLight.stroke_density_GPU.srv, 0.0f, 1.0f, g_paintLight.gamma_correction, true);
             break;
         case 4:
             g_screenQuad.Draw(pd3dImmediateContext, g_paintLight.blurred_image_GPU.srv, 0.0f, 255.0f, g_paintLight.gamma_correction);
@@ -337,6 +339,7 @@ void InitApp()
     g_DisplayImageSelectionCombo->AddItem(L"Blurred Image", ULongToPtr(4));
     g_DisplayImageSelectionCombo->AddItem(L"Refined Lighting", ULongToPtr(7));
     g_DisplayImageSelectionCombo->AddItem(L"Final Lighting", ULongToPtr(8));
+    g_HUD.AddButton(IDC_SAVE_INTERMEDIATES, L"Save intermediates", 0, iY += 26, 170, 23);
 
     WCHAR desc[256] = { 0 };
 
@@ -391,7 +394,7 @@ void CALLBACK OnGUIEvent(UINT nEvent, int nControlID, CDXUTControl *pControl, vo
             if (ret.empty())
                 break;
             g_paintLight.ResetWithNewImage(DXUTGetD3D11Device(), DXUTGetD3D11DeviceContext(), ret);
-            MessageBox(DXUTGetHWND(), L"Please wait while the program is calculating ray intersection.", L"OpenMP disabled", MB_ICONINFORMATION | MB_OK);
+            MessageBox(DXUTGetHWND(), L"Please wait while the program is calculating ray intersection.", L"Stroke density", MB_ICONINFORMATION | MB_OK);
             RECT rect;
             GetWindowRect(DXUTGetHWND(), std::addressof(rect));
             g_paintLight.ComputeStrokeDensityCPU(DXUTGetD3D11Device(), DXUTGetD3D11DeviceContext());
@@ -484,6 +487,15 @@ void CALLBACK OnGUIEvent(UINT nEvent, int nControlID, CDXUTControl *pControl, vo
             g_paintLight.light_scale = val;
     }
     break;
+    case IDC_SAVE_INTERMEDIATES:
+        if (g_paintLight)
+        {
+            std::size_t const bytes(g_paintLight.SaveIntermediates(DXUTGetD3D11Device(), DXUTGetD3D11DeviceContext(), L"Intermediates"));
+            WCHAR buf[256] = { 0 };
+            swprintf_s(buf, 255, L"saved intermediates: %zu bytes\n", bytes);
+            OutputDebugString(buf);
+        }
+        break;
     case IDC_GAMMACOR:
     {
         INT value = g_HUD.GetSlider(IDC_GAMMACOR)->GetValue();
@@ -517,5 +529,58 @@ void RenderText()
     g_pTxtHelper->DrawTextLine(buf);
     swprintf_s(buf, 255, L"LightX: %.4f, LightY: %.4f\0", g_paintLight.light_x, g_paintLight.light_y);
     g_pTxtHelper->DrawTextLine(buf);
+    if (g_paintLight)
+    {
+        auto const &stats(g_paintLight.stroke_density_stats);
+        swprintf_s(buf, 255, L"Hull faces: %zu, threads: %d, hull: %.3fs, palette: %.3fs, density: %.3fs\0", stats.hull_faces, stats.threads, stats.hull_seconds, stats.palette_seconds, stats.density_seconds);
+        g_pTxtHelper->DrawTextLine(buf);
+        if (!g_paintLight.stroke_density_cache_directory.empty())
+        {
+            swprintf_s(buf, 255, L"Cache %ls, load: %.3fs, store: %.3fs, hits: %zu, misses: %zu\0", stats.cache_hit ? L"hit" : L"miss", stats.cache_load_seconds, stats.cache_store_seconds, stats.cache_hits, stats.cache_misses);
+            g_pTxtHelper->DrawTextLine(buf);
+        }
+        swprintf_s(buf, 255, L"Hull input: %zu points, %.1f KiB%ls, %d hull threads\0", stats.hull_input_points, stats.hull_input_bytes / 1024.0, stats.hull_input_occupancy ? L", occupancy grid" : L"", stats.hull_threads);
+        g_pTxtHelper->DrawTextLine(buf);
+        if (g_paintLight.hull_prefilter && !stats.cache_hit)
+        {
+            swprintf_s(buf, 255, L"Hull prefilter: %zu points left, %.3fs\0", stats.hull_filtered_points, stats.prefilter_seconds);
+            g_pTxtHelper->DrawTextLine(buf);
+        }
+        if (g_paintLight.compact_hull && !stats.hull_exact && !stats.cache_hit)
+        {
+            swprintf_s(buf, 255, L"Compact hull peak memory: %.1f KiB\0", stats.hull_peak_bytes / 1024.0);
+            g_pTxtHelper->DrawTextLine(buf);
+        }
+        if (g_paintLight.hull_timing_comparison && !stats.cache_hit)
+        {
+            swprintf_s(buf, 255, L"%ls hull: %.3fs, %zu failed horizon edges, QuickHull<float>: %.3fs, %zu faces, %zu failed horizon edges\0", stats.hull_exact ? L"Exact" : L"Float", stats.hull_build_seconds, stats.hull_failed_horizon_edges, stats.float_hull_seconds, stats.float_hull_faces, stats.float_hull_failed_horizon_edges);
+            g_pTxtHelper->DrawTextLine(buf);
+        }
+        if ((g_paintLight.hull_face_budget || g_paintLight.hull_vertex_budget) && !stats.cache_hit)
+        {
+            swprintf_s(buf, 255, L"Simplified hull: %zu faces, %zu vertices, volume error: %.2f%%, %.3fs\0", stats.simplified_faces, stats.simplified_vertices, stats.hull_volume_error * 100.0, stats.simplify_seconds);
+            g_pTxtHelper->DrawTextLine(buf);
+        }
+        for (auto const &run : stats.thread_scaling)
+        {
+            swprintf_s(buf, 255, L"%d threads: palette %.3fs, density %.3fs, identical: %d\0", run.threads, run.palette_seconds, run.density_seconds, run.identical ? 1 : 0);
+            g_pTxtHelper->DrawTextLine(buf);
+        }
+        if (g_paintLight.unique_color_memoization)
+        {
+            swprintf_s(buf, 255, L"Unique colors: %zu, table: %.3fs, scatter: %.3fs, estimated saved palette: %.3fs, estimated saved density: %.3fs\0", stats.unique_colors, stats.unique_table_seconds, stats.scatter_seconds, stats.palette_seconds_saved, stats.density_seconds_saved);
+            g_pTxtHelper->DrawTextLine(buf);
+        }
+        if (g_paintLight.palette_intersection == PaletteIntersection::CubeMap)
+        {
+            swprintf_s(buf, 255, L"Cube map: %ls, build: %.3fs, %.1f KiB, candidates: %.2f avg, %u max\0", stats.cube_map_reused ? L"reused" : L"built", stats.accel_build_seconds, stats.cube_map_bytes / 1024.0, stats.cube_map_average_candidates, stats.cube_map_max_candidates);
+            g_pTxtHelper->DrawTextLine(buf);
+        }
+        if (g_paintLight.palette_timing_comparison)
+        {
+            swprintf_s(buf, 255, L"Linear palette: %.3fs, identical: %d, max diff: %g\0", stats.linear_palette_seconds, stats.palette_matches_linear ? 1 : 0, stats.palette_max_difference);
+            g_pTxtHelper->DrawTextLine(buf);
+        }
+    }
     g_pTxtHelper->End();
 }
@@ -2,11 +2,33 @@
 
 #include <tuple>
 #include <stdexcept>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "DXUT.h"
 #include "d3d11helper.h"
 #include "QuickHull.hpp"
+#include "CompactQuickHull.hpp"
+#include "InteriorPointFilter.hpp"
+#include "IntegerQuickHull.hpp"
 #include "RGBAImage.h"
+#include "FormatImage.h"
+#include "ScalarImage.h"
+#include "RayIntersect.h"
+#include "HullBVH.h"
+#include "HullPlanes.h"
+#include "HullCubeMap.h"
+#include "ColorTable.h"
+#include "ColorOccupancy.h"
+#include "StrokeDensityCache.h"
+#include "RawImage.h"
+#include "HullSimplifier.h"
+#include "Vector3x8.h"
 
 //#include "CoarseLighting.h"
 #include "Lighting.h"
@@ -16,42 +38,81 @@
 #include "MulScalar.h"
 #include "MulImage.h"
 
-using vec3f = quickhull::Vector3<float>;
-#define CULLING
+enum class PaletteIntersection
+{
+	Linear, // test every hull triangle per pixel
+	BVH, // HullBVH over the hull triangles, same result as Linear
+	HalfSpace, // HullPlanes from the QuickHull face planes, 8 or 16 rays per step
+	CubeMap, // HullCubeMap of candidate faces per direction, same result as Linear, kept while the hull does not change
+};
+
+struct ThreadScaling
+{
+	int threads;
+	double palette_seconds;
+	double density_seconds;
+	bool identical; // same palette and stroke density as the run with all threads
+};
 
-template<typename T = float>
-std::tuple<bool, vec3f> rayTriangleIntersect(
-	const vec3f &orig, const vec3f &dir,
-	const vec3f &v0, const vec3f &v1, const vec3f &v2
-	)
+struct FormatReport
 {
-	T t, u, v;
-	auto v0v1 = v1 - v0;
-	auto v0v2 = v2 - v0;
-	auto pvec = dir.crossProduct(v0v2);
-	float det = v0v1.dotProduct(pvec);
-#ifdef CULLING 
-	// if the determinant is negative the triangle is backfacing
-	// if the determinant is close to 0, the ray misses the triangle
-	if (det < 1e-8f) return { false,vec3f(0,0,0) };
-#else 
-	// ray and triangle are parallel if det is close to 0
-	if (fabs(det) < 1e-8f) return { false,vec3f(0,0,0) };
-#endif 
-	T invDet = 1.0 / det;
-
-	auto tvec = orig - v0;
-	u = tvec.dotProduct(pvec) * invDet;
-	if (u < 0 || u > 1) return { false,vec3f(0,0,0) };
-
-	auto qvec = tvec.crossProduct(v0v1);
-	v = dir.dotProduct(qvec) * invDet;
-	if (v < 0 || u + v > 1) return { false,vec3f(0,0,0) };
-
-	t = v0v2.dotProduct(qvec) * invDet;
-
-	return { true,orig + dir * t };
-}
+	PixelFormat format;
+	FormatError palette_error; // palette encoded in format against the FP32 palette, in 0 .. 255
+	FormatError density_error; // stroke density computed from that palette into a one channel image of format against the FP32 one, in 0 .. 1
+	std::size_t palette_bytes;
+	std::size_t density_bytes;
+	double density_seconds;
+};
+
+struct StrokeDensityStats
+{
+	std::size_t hull_faces;
+	std::size_t simplified_faces; // the rest is only filled with hull_face_budget or hull_vertex_budget
+	std::size_t simplified_triangles;
+	std::size_t simplified_vertices;
+	double hull_volume_error; // volume added relative to the exact hull
+	double simplify_seconds;
+	std::size_t hull_input_points;
+	std::size_t hull_input_bytes; // point cloud plus occupancy grid
+	bool hull_input_occupancy; // false if occupancy_hull_input was off or the image is not 8-bit
+	std::size_t hull_filtered_points; // points left for the hull after hull_prefilter
+	double prefilter_seconds;
+	std::size_t occupied_colors;
+	double hull_seconds;
+	int hull_threads;
+	std::size_t hull_peak_bytes; // CompactQuickHull mesh, point arena and buffers, 0 with QuickHull
+	bool hull_exact; // built by IntegerQuickHull
+	double hull_build_seconds; // the hull alone, hull_seconds includes its input and the prefilter
+	std::size_t hull_failed_horizon_edges;
+	double float_hull_seconds; // the rest is only measured when hull_timing_comparison is set
+	std::size_t float_hull_faces;
+	std::size_t float_hull_failed_horizon_edges;
+	double accel_build_seconds; // building the intersection acceleration structure
+	double palette_seconds; // palette and density together with fused_palette_density
+	double linear_palette_seconds; // only measured when palette_timing_comparison is set
+	bool palette_matches_linear;
+	float palette_max_difference; // largest channel difference to the linear scan
+	double density_seconds;
+	bool palette_kept;
+	std::size_t unique_colors; // the rest is only filled with unique_color_memoization
+	double unique_table_seconds;
+	double scatter_seconds;
+	double palette_seconds_saved; // estimated from the per color cost against solving every pixel
+	double density_seconds_saved;
+	bool cube_map_reused; // only filled with PaletteIntersection::CubeMap
+	std::size_t cube_map_bytes;
+	float cube_map_average_candidates;
+	std::uint32_t cube_map_max_candidates;
+	int threads;
+	bool cache_hit; // the palette stage was skipped
+	double cache_hash_seconds;
+	double cache_load_seconds;
+	double cache_store_seconds;
+	std::size_t cache_bytes; // size of the cache entry read or written
+	std::size_t cache_hits, cache_misses; // since the cache directory was set
+	std::vector<ThreadScaling> thread_scaling; // only filled with thread_scaling_report
+	std::vector<FormatReport> format_report; // only filled with format_report
+};
 
 class PaintLight
 {
@@ -63,10 +124,35 @@ public:
 	float blur_sigma;
 	float pixel_scale, light_scale;
 	float gamma_correction;
+	PaletteIntersection palette_intersection;
+	bool palette_timing_comparison; // also run the linear scan and report both timings
+	bool unique_color_memoization; // solve palette and density once per distinct color
+	bool occupancy_hull_input; // build the hull from the column boundaries of a ColorOccupancy grid instead of every pixel, off by default: an approximation, QuickHull keeps other near coplanar vertices and a few palette pixels change
+	bool parallel_hull; // QuickHull assigns points to faces on cpu_threads threads, the hull is the same as with one
+	bool compact_hull; // CompactQuickHull (32-bit indices, point arena) instead of QuickHull, the hull is the same
+	bool simd_hull; // classify hull points against face planes eight at a time in AVX2 builds, the hull is the same
+	bool hull_prefilter; // drop the points inside the hull of the 14 extreme points first, off by default: still a hull within eps but with other vertices and triangles, so the palette changes
+	bool exact_hull; // IntegerQuickHull when the colors are integers in [0, 255]: no epsilon and no failed horizon edges, off by default since it changes the hull
+	bool hull_timing_comparison; // also build the hull with QuickHull<float> and report both
+	bool fused_palette_density; // palette and stroke density in one pass per row tile
+	bool keep_palette; // with fused_palette_density, false leaves palette empty; timing comparisons and unique_color_memoization always keep it
+	std::uint32_t cube_map_resolution; // cells along each side of the PaletteIntersection::CubeMap cube faces
+	std::uint32_t hull_face_budget; // HullSimplifier face planes for the palette hull, 0 keeps the exact hull
+	std::uint32_t hull_vertex_budget; // HullSimplifier vertices for the palette hull, 0 for no limit
+	int cpu_threads; // threads for the palette and density passes, 0 uses every core
+	bool thread_scaling_report; // rerun the per pixel palette and density passes at 1, 2, 4 ... threads
+	bool format_report; // rerun the stroke density pass on FP16, UNORM16 and UNORM8 images and report their error and size, to pick palette_format and stroke_density_format
+	PixelFormat palette_format; // samples the palette pass writes, other than Float32 the palette is in narrow_palette; the FP32 comparisons above keep Float32
+	PixelFormat stroke_density_format; // samples the density pass writes and stroke_density_GPU reads, other than Float32 it is in narrow_stroke_density
+	bool half_float_textures; // blurred image, lighting and result textures as R16G16B16A16_FLOAT from the next ResetWithNewImage, the shaders write 0 .. 255 colors so no UNORM
+	std::wstring stroke_density_cache_directory; // StrokeDensityCache location, empty (the default) disables the cache
+	StrokeDensityStats stroke_density_stats;
 public:
 	RGBAImage original;
 	RGBAImage palette;
-	RGBAImage stroke_density; // same value for all three channels
+	ScalarImage stroke_density; // range 0 to 1
+	AnyFormatImage<4> narrow_palette; // palette in palette_format when that is not Float32, palette is empty then
+	AnyFormatImage<1> narrow_stroke_density; // stroke density in stroke_density_format when that is not Float32, stroke_density is empty then
 	RGBAImage blurred_image;
 	RGBAImage normalized_image;
 	RGBAImage coarse_lighting;
@@ -76,7 +162,7 @@ public:
 
 	RGBAImageGPU original_GPU;
 	RGBAImageGPU palette_GPU;
-	RGBAImageGPU stroke_density_GPU; // same value for all three channels
+	ScalarImageGPU stroke_density_GPU; // range 0 to 1
 	RGBAImageGPU blurred_image_GPU;
 	RGBAImageGPU normalized_image_GPU;
 	RGBAImageGPU coarse_lighting_GPU;
@@ -90,12 +176,18 @@ private:
 	AddScalar m_AddScalar;
 	MulScalar m_MulScalar;
 	MulImage m_MulImage;
+
+	HullCubeMap m_PaletteCubeMap; // kept across images, rebuilt only when the hull changes
+	quickhull::QuickHull<float> m_HullBuilder; // kept across images with its buffers allocated (setKeepBuffers)
+	StrokeDensityCache m_StrokeDensityCache;
 public:
 	void ReleaseImages() noexcept
 	{
 		original.Release();
 		palette.Release();
 		stroke_density.Release();
+		narrow_palette.Release();
+		narrow_stroke_density.Release();
 		blurred_image.Release();
 		normalized_image.Release();
 		coarse_lighting.Release();
@@ -125,7 +217,7 @@ public:
 		m_MulImage.Release();
 	}
 
-	PaintLight() :gamma(1.0f), ambient(0.55), light_x(0.0f), light_y(0.0f), light_z(1.0f), blur_width(64), blur_sigma(16.0f), pixel_scale(1.0f), light_scale(10.0f), gamma_correction(1.0f)
+	PaintLight() :gamma(1.0f), ambient(0.55), light_x(0.0f), light_y(0.0f), light_z(1.0f), blur_width(64), blur_sigma(16.0f), pixel_scale(1.0f), light_scale(10.0f), gamma_correction(1.0f), palette_intersection(PaletteIntersection::BVH), palette_timing_comparison(false), unique_color_memoization(false), occupancy_hull_input(false), parallel_hull(true), compact_hull(true), simd_hull(true), hull_prefilter(false), exact_hull(false), hull_timing_comparison(false), fused_palette_density(true), keep_palette(true), cube_map_resolution(HullCubeMap::DefaultResolution), hull_face_budget(0), hull_vertex_budget(0), cpu_threads(0), thread_scaling_report(false), format_report(false), palette_format(PixelFormat::Float32), stroke_density_format(PixelFormat::Float32), half_float_textures(false), stroke_density_stats{}
 	{
 
 	}
@@ -139,7 +231,29 @@ public:
 		blur_sigma(16.0f),
 		pixel_scale(1.0f),
 		light_scale(10.0f),
-		gamma_correction(1.0f)
+		gamma_correction(1.0f),
+		palette_intersection(PaletteIntersection::BVH),
+		palette_timing_comparison(false),
+		unique_color_memoization(false),
+		occupancy_hull_input(false),
+		parallel_hull(true),
+		compact_hull(true),
+		simd_hull(true),
+		hull_prefilter(false),
+		exact_hull(false),
+		hull_timing_comparison(false),
+		fused_palette_density(true),
+		keep_palette(true),
+		cube_map_resolution(HullCubeMap::DefaultResolution),
+		hull_face_budget(0),
+		hull_vertex_budget(0),
+		cpu_threads(0),
+		thread_scaling_report(false),
+		format_report(false),
+		palette_format(PixelFormat::Float32),
+		stroke_density_format(PixelFormat::Float32),
+		half_float_textures(false),
+		stroke_density_stats{}
 	{
 		m_Lighting = Lighting(device, context);
 		m_NormalizeImage = NormalizeImage(device, context);
@@ -166,10 +280,35 @@ public:
 		pixel_scale(other.pixel_scale),
 		light_scale(other.light_scale),
 		gamma_correction(other.gamma_correction),
+		palette_intersection(other.palette_intersection),
+		palette_timing_comparison(other.palette_timing_comparison),
+		unique_color_memoization(other.unique_color_memoization),
+		occupancy_hull_input(other.occupancy_hull_input),
+		parallel_hull(other.parallel_hull),
+		compact_hull(other.compact_hull),
+		simd_hull(other.simd_hull),
+		hull_prefilter(other.hull_prefilter),
+		exact_hull(other.exact_hull),
+		hull_timing_comparison(other.hull_timing_comparison),
+		fused_palette_density(other.fused_palette_density),
+		keep_palette(other.keep_palette),
+		cube_map_resolution(other.cube_map_resolution),
+		hull_face_budget(other.hull_face_budget),
+		hull_vertex_budget(other.hull_vertex_budget),
+		cpu_threads(other.cpu_threads),
+		thread_scaling_report(other.thread_scaling_report),
+		format_report(other.format_report),
+		palette_format(other.palette_format),
+		stroke_density_format(other.stroke_density_format),
+		half_float_textures(other.half_float_textures),
+		stroke_density_cache_directory(std::move(other.stroke_density_cache_directory)),
+		stroke_density_stats(other.stroke_density_stats),
 
 		original(std::move(other.original)),
 		palette(std::move(other.palette)),
 		stroke_density(std::move(other.stroke_density)),
+		narrow_palette(std::move(other.narrow_palette)),
+		narrow_stroke_density(std::move(other.narrow_stroke_density)),
 		blurred_image(std::move(other.blurred_image)),
 		normalized_image(std::move(other.normalized_image)),
 		coarse_lighting(std::move(other.coarse_lighting)),
@@ -192,7 +331,11 @@ public:
 		m_GaussianBlur(std::move(other.m_GaussianBlur)),
 		m_AddScalar(std::move(other.m_AddScalar)),
 		m_MulScalar(std::move(other.m_MulScalar)),
-		m_MulImage(std::move(other.m_MulImage))
+		m_MulImage(std::move(other.m_MulImage)),
+
+		m_PaletteCubeMap(std::move(other.m_PaletteCubeMap)),
+		m_HullBuilder(std::move(other.m_HullBuilder)),
+		m_StrokeDensityCache(std::move(other.m_StrokeDensityCache))
 	{
 
 	}
@@ -210,10 +353,35 @@ public:
 			pixel_scale = other.pixel_scale;
 			light_scale = other.light_scale;
 			gamma_correction = other.gamma_correction;
+			palette_intersection = other.palette_intersection;
+			palette_timing_comparison = other.palette_timing_comparison;
+			unique_color_memoization = other.unique_color_memoization;
+			occupancy_hull_input = other.occupancy_hull_input;
+			parallel_hull = other.parallel_hull;
+			compact_hull = other.compact_hull;
+			simd_hull = other.simd_hull;
+			hull_prefilter = other.hull_prefilter;
+			exact_hull = other.exact_hull;
+			hull_timing_comparison = other.hull_timing_comparison;
+			fused_palette_density = other.fused_palette_density;
+			keep_palette = other.keep_palette;
+			cube_map_resolution = other.cube_map_resolution;
+			hull_face_budget = other.hull_face_budget;
+			hull_vertex_budget = other.hull_vertex_budget;
+			cpu_threads = other.cpu_threads;
+			thread_scaling_report = other.thread_scaling_report;
+			format_report = other.format_report;
+			palette_format = other.palette_format;
+			stroke_density_format = other.stroke_density_format;
+			half_float_textures = other.half_float_textures;
+			stroke_density_cache_directory = std::move(other.stroke_density_cache_directory);
+			stroke_density_stats = other.stroke_density_stats;
 
 			original = std::move(other.original);
 			palette = std::move(other.palette);
 			stroke_density = std::move(other.stroke_density);
+			narrow_palette = std::move(other.narrow_palette);
+			narrow_stroke_density = std::move(other.narrow_stroke_density);
 			blurred_image = std::move(other.blurred_image);
 			normalized_image = std::move(other.normalized_image);
 			coarse_lighting = std::move(other.coarse_lighting);
@@ -237,6 +405,10 @@ public:
 			m_AddScalar = std::move(other.m_AddScalar);
 			m_MulScalar = std::move(other.m_MulScalar);
 			m_MulImage = std::move(other.m_MulImage);
+
+			m_PaletteCubeMap = std::move(other.m_PaletteCubeMap);
+			m_HullBuilder = std::move(other.m_HullBuilder);
+			m_StrokeDensityCache = std::move(other.m_StrokeDensityCache);
 		}
 		return *this;
 	}
@@ -245,26 +417,573 @@ public:
 	{
 		return original;
 	}
-public:
-	void ComputeStrokeDensityCPU(ID3D11Device *device, ID3D11DeviceContext *context)
+private:
+	// solves the palette for count RGBA colors: writes xyz of the exit point to dst, hit[i] = 0 for rays that miss the hull
+	using PaletteSolver = std::function<void(float const *src, float *dst, std::uint8_t *hit, std::size_t count)>;
+
+	static constexpr std::size_t UniqueColorChunk = 1024;
+	static constexpr std::size_t RowTileHeight = 8; // rows per task of the palette and density passes
+
+	static int ThreadCount(int requested)
+	{
+#ifdef _OPENMP
+		return requested > 0 ? requested : omp_get_max_threads();
+#else
+		return 1;
+#endif
+	}
+
+	static double SecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// cast a ray from the hull centroid through each color and let intersect find where it leaves the hull
+	template<typename Intersect>
+	static PaletteSolver MakePaletteSolver(vec3f const &centroid, Intersect intersect)
+	{
+		return [centroid, intersect](float const *src, float *dst, std::uint8_t *hit, std::size_t count) {
+			// directions are normalized a packet at a time, the intersection itself stays per ray
+			Vector3x8 const origin(centroid);
+			alignas(32) float dx[Vector3x8::Width], dy[Vector3x8::Width], dz[Vector3x8::Width];
+			for (std::size_t i(0); i < count; i += Vector3x8::Width)
+			{
+				std::size_t const lanes(std::min(Vector3x8::Width, count - i));
+				(Vector3x8::LoadRGBA(src + i * 4, lanes) - origin).getNormalized().Store(dx, dy, dz);
+				for (std::size_t k(0); k < lanes; ++k)
+				{
+					auto const [h, hit_point] = intersect(centroid, vec3f(dx[k], dy[k], dz[k]));
+					hit[i + k] = h ? 1 : 0;
+					if (h)
+					{
+						dst[(i + k) * 4 + 0] = hit_point.x;
+						dst[(i + k) * 4 + 1] = hit_point.y;
+						dst[(i + k) * 4 + 2] = hit_point.z;
+					}
+				}
+			}
+		};
+	}
+
+	static float StrokeDensity(vec3f const &p, vec3f const &h, vec3f const &centroid)
+	{
+		auto const pixel_distance((p - centroid).getLength());
+		auto const intersect_distance((h - centroid).getLength());
+		float k(1.0f - std::fabs(1.0f - pixel_distance / intersect_distance));
+		//k = std::sqrt(1.0f - k * k);
+		return k;
+	}
+
+	static Float8 StrokeDensity(Vector3x8 const &p, Vector3x8 const &h, Vector3x8 const &centroid)
+	{
+		Float8 const one(1.0f);
+		Float8 const pixel_distance((p - centroid).getLength());
+		Float8 const intersect_distance((h - centroid).getLength());
+		return one - Abs(one - pixel_distance / intersect_distance);
+	}
+
+	// stroke density of count RGBA pixels src with palette pal, one float per pixel in dst
+	static void StrokeDensityRow(float const *src, float const *pal, float *dst, std::size_t count, Vector3x8 const &centroid)
+	{
+		for (std::size_t x(0); x < count; x += Vector3x8::Width)
+		{
+			std::size_t const lanes(std::min(Vector3x8::Width, count - x));
+			Float8 const k(StrokeDensity(Vector3x8::LoadRGBA(src + x * 4, lanes), Vector3x8::LoadRGBA(pal + x * 4, lanes), centroid));
+			if (lanes == Vector3x8::Width)
+			{
+				k.Store(dst + x);
+				continue;
+			}
+			alignas(32) float buffer[Vector3x8::Width];
+			k.Store(buffer);
+			std::memcpy(dst + x, buffer, lanes * sizeof(float));
+		}
+	}
+
+	// rows are solved in parallel tiles, the misses are filled afterwards in pixel order so the result does not depend on the thread count
+	// out is an RGBAImage or a FormatImage, whose rows are solved into a row buffer and encoded
+	template<typename PaletteImage>
+	void ComputePalette(PaletteImage &out, PaletteSolver const &solve, int threads)
 	{
-		if (!original)
-			throw std::runtime_error("empty image");
 		auto const [width, height] = original.GetSize();
-		quickhull::QuickHull<float> qh; // Could be double as well
-		std::vector<vec3f> pointCloud;
-		pointCloud.reserve(width * height);
+		std::vector<std::uint8_t> hit(width * height);
 
-		float *src = original.GetRawData();
-		for (std::size_t i(0); i < width * height; ++i, src += 4)
-			pointCloud.emplace_back(src[0], src[1], src[2]);
+		out.Setup(width, height);
+		std::ptrdiff_t const tiles((height + RowTileHeight - 1) / RowTileHeight);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+		for (std::ptrdiff_t t = 0; t < tiles; ++t)
+		{
+			std::size_t const y0(static_cast<std::size_t>(t) * RowTileHeight);
+			std::size_t const y1(std::min<std::size_t>(y0 + RowTileHeight, height));
+			std::vector<float> out_row;
+			for (std::size_t y(y0); y < y1; ++y)
+			{
+				solve(original.Row(y), WriteRow(out, y, out_row), hit.data() + y * width, width);
+				CommitRow(out, y, out_row);
+			}
+		}
+		FillMissedPixels(out, hit);
+	}
+
+	// rows of an RGBAImage or a ScalarImage are used in place, the rows of a FormatImage go through a float row buffer
+	static float const *ReadRow(RGBAImage const &image, std::size_t y, std::vector<float> &)
+	{
+		return image.Row(static_cast<std::uint32_t>(y));
+	}
+	template<PixelFormat Format, std::uint32_t Channels>
+	static float const *ReadRow(FormatImage<Format, Channels> const &image, std::size_t y, std::vector<float> &buffer)
+	{
+		buffer.resize(std::size_t(image.width) * Channels);
+		image.DecodeRow(static_cast<std::uint32_t>(y), buffer.data());
+		return buffer.data();
+	}
+	static float *WriteRow(RGBAImage &image, std::size_t y, std::vector<float> &)
+	{
+		return image.Row(static_cast<std::uint32_t>(y));
+	}
+	static float *WriteRow(ScalarImage &image, std::size_t y, std::vector<float> &)
+	{
+		return image.Row(static_cast<std::uint32_t>(y));
+	}
+	template<PixelFormat Format, std::uint32_t Channels>
+	static float *WriteRow(FormatImage<Format, Channels> &image, std::size_t, std::vector<float> &buffer)
+	{
+		buffer.resize(std::size_t(image.width) * Channels);
+		return buffer.data();
+	}
+	static void CommitRow(RGBAImage &, std::size_t, std::vector<float> const &)
+	{
+
+	}
+	static void CommitRow(ScalarImage &, std::size_t, std::vector<float> const &)
+	{
+
+	}
+	template<PixelFormat Format, std::uint32_t Channels>
+	static void CommitRow(FormatImage<Format, Channels> &image, std::size_t y, std::vector<float> const &buffer)
+	{
+		image.EncodeRow(static_cast<std::uint32_t>(y), buffer.data());
+	}
 
-		auto hull = qh.getConvexHull(pointCloud, true, false);
+	// out is a ScalarImage or a one channel FormatImage, pal an RGBAImage or a FormatImage, so the pass can run on narrow images directly
+	template<typename DensityImage, typename PaletteImage>
+	void ComputeStrokeDensity(DensityImage &out, PaletteImage const &pal, vec3f const &centroid, int threads)
+	{
+		auto const [width, height] = original.GetSize();
+		Vector3x8 const origin(centroid);
+
+		out.Setup(width, height);
+		std::ptrdiff_t const tiles((height + RowTileHeight - 1) / RowTileHeight);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+		for (std::ptrdiff_t t = 0; t < tiles; ++t)
+		{
+			std::size_t const y0(static_cast<std::size_t>(t) * RowTileHeight);
+			std::size_t const y1(std::min<std::size_t>(y0 + RowTileHeight, height));
+			std::vector<float> pal_row, out_row;
+			for (std::size_t y(y0); y < y1; ++y)
+			{
+				StrokeDensityRow(original.Row(y), ReadRow(pal, y, pal_row), WriteRow(out, y, out_row), width, origin);
+				CommitRow(out, y, out_row);
+			}
+		}
+	}
+
+	// palette and stroke density of every row tile in one pass, the palette goes to a per tile row buffer if pal is null
+	// misses copy their left neighbour inside the row, only the misses at the start of a row depend on the row above
+	// and are filled after the parallel pass in row order, which gives the same images as ComputePalette + ComputeStrokeDensity
+	// pal and density may be FormatImages, then the density comes from the FP32 palette row before it is encoded
+	template<typename PaletteImage, typename DensityImage>
+	void ComputePaletteAndStrokeDensity(PaletteImage *pal, DensityImage &density, PaletteSolver const &solve, vec3f const &centroid, int threads)
+	{
+		auto const [width, height] = original.GetSize();
+		Vector3x8 const origin(centroid);
+		std::vector<std::uint32_t> leading_misses(height);
+		std::vector<float> first_pixel(height * 3, 0.0f); // palette of the first pixel of every row
+
+		if (pal)
+			pal->Setup(width, height);
+		density.Setup(width, height);
+		std::ptrdiff_t const tiles((height + RowTileHeight - 1) / RowTileHeight);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+		for (std::ptrdiff_t t = 0; t < tiles; ++t)
+		{
+			std::vector<float> row(pal ? 0 : width * 4, 0.0f), pal_row, density_row;
+			std::vector<std::uint8_t> hit(width);
+			std::size_t const y0(static_cast<std::size_t>(t) * RowTileHeight);
+			std::size_t const y1(std::min<std::size_t>(y0 + RowTileHeight, height));
+			for (std::size_t y(y0); y < y1; ++y)
+			{
+				float const *src(original.Row(y));
+				float *dst(pal ? WriteRow(*pal, y, pal_row) : row.data());
+				float *k(WriteRow(density, y, density_row));
+				solve(src, dst, hit.data(), width);
+
+				std::size_t x(0);
+				while (x < width && !hit[x])
+					++x;
+				leading_misses[y] = static_cast<std::uint32_t>(x);
+				for (std::size_t m(x); m < width; ++m)
+					if (!hit[m])
+						std::memcpy(dst + m * 4, dst + (m - 1) * 4, 3 * sizeof(float));
+				StrokeDensityRow(src + x * 4, dst + x * 4, k + x, width - x, origin);
+				std::memcpy(first_pixel.data() + y * 3, dst, 3 * sizeof(float));
+				if (pal)
+					CommitRow(*pal, y, pal_row);
+				CommitRow(density, y, density_row);
+			}
+		}
+
+		for (std::size_t y(0); y < height; ++y)
+		{
+			if (!leading_misses[y])
+				continue;
+			if (y > 0)
+				std::memcpy(first_pixel.data() + y * 3, first_pixel.data() + (y - 1) * 3, 3 * sizeof(float));
+			else
+				OutputDebugString(L"warn\n");
+			vec3f const h(first_pixel[y * 3 + 0], first_pixel[y * 3 + 1], first_pixel[y * 3 + 2]);
+			for (std::size_t x(0); x < leading_misses[y]; ++x)
+			{
+				if (pal)
+					pal->Set(y, x, h.x, h.y, h.z);
+				auto const [r, g, b] = original.At(y, x);
+				float const k(StrokeDensity(vec3f(r, g, b), h, centroid));
+				density.Set(y, x, k);
+			}
+		}
+	}
+
+	// rays that miss every face take the palette value of the previous pixel
+	template<typename PaletteImage>
+	static void FillMissedPixel(PaletteImage &out, std::size_t y, std::size_t x)
+	{
+		if (x > 0)
+		{
+			auto const [r, g, b] = out.At(y, x - 1);
+			out.Set(y, x, r, g, b);
+		}
+		else if (y > 0)
+		{
+			auto const [r, g, b] = out.At(y - 1, x);
+			out.Set(y, x, r, g, b);
+		}
+		else
+		{
+			OutputDebugString(L"warn\n");
+		}
+	}
+
+	// misses copy from pixels that may be misses themselves, so they are filled serially in pixel order
+	template<typename PaletteImage>
+	static void FillMissedPixels(PaletteImage &out, std::vector<std::uint8_t> const &hit)
+	{
+		auto const [width, height] = out.GetSize();
+		for (std::size_t y(0), i(0); y < height; ++y)
+			for (std::size_t x(0); x < width; ++x, ++i)
+				if (!hit[i])
+					FillMissedPixel(out, y, x);
+	}
+
+	// palette and stroke density solved once per distinct color and scattered back to the pixels,
+	// gives the same images as solving every pixel
+	void ComputeStrokeDensityUnique(PaletteSolver const &solve, vec3f const &centroid, int threads)
+	{
+		auto const [width, height] = original.GetSize();
+		std::size_t const total(width * height);
+
+		// step 1 number the distinct colors
+		auto start(std::chrono::steady_clock::now());
+		ColorTable table(std::min<std::size_t>(total, 1 << 16));
+		std::vector<std::uint32_t> color_index(total);
+		float const *src(original.data);
+		for (std::size_t i(0); i < total; ++i, src += 4)
+			color_index[i] = table.Insert(src[0], src[1], src[2]);
+		std::size_t const unique(table.size());
+		float const *colors(table.GetColors());
+		stroke_density_stats.unique_colors = unique;
+		stroke_density_stats.unique_table_seconds = SecondsSince(start);
+
+		// step 2 palette and density once per distinct color
+		start = std::chrono::steady_clock::now();
+		std::vector<float> unique_palette(unique * 4, 0.0f);
+		std::vector<std::uint8_t> unique_hit(unique);
+		std::vector<float> unique_density(unique);
+		std::ptrdiff_t const chunks((unique + UniqueColorChunk - 1) / UniqueColorChunk);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+		for (std::ptrdiff_t c = 0; c < chunks; ++c)
+		{
+			std::size_t const first(static_cast<std::size_t>(c) * UniqueColorChunk);
+			std::size_t const count(std::min(UniqueColorChunk, unique - first));
+			solve(colors + first * 4, unique_palette.data() + first * 4, unique_hit.data() + first, count);
+		}
+		stroke_density_stats.palette_seconds = SecondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		// the density of misses is computed as well but never scattered
+		Vector3x8 const origin(centroid);
+		std::ptrdiff_t const packets((unique + Vector3x8::Width - 1) / Vector3x8::Width);
+#pragma omp parallel for schedule(static) num_threads(threads)
+		for (std::ptrdiff_t q = 0; q < packets; ++q)
+		{
+			std::size_t const u(static_cast<std::size_t>(q) * Vector3x8::Width);
+			std::size_t const lanes(std::min(Vector3x8::Width, unique - u));
+			alignas(32) float k[Vector3x8::Width];
+			StrokeDensity(Vector3x8::LoadRGBA(colors + u * 4, lanes), Vector3x8::LoadRGBA(unique_palette.data() + u * 4, lanes), origin).Store(k);
+			std::memcpy(unique_density.data() + u, k, lanes * sizeof(float));
+		}
+		stroke_density_stats.density_seconds = SecondsSince(start);
+
+		// step 3 scatter back to the pixels in row tiles, misses depend on their neighbours and are filled in pixel order afterwards
+		start = std::chrono::steady_clock::now();
+		palette.Setup(width, height);
+		stroke_density.Setup(width, height);
+		std::ptrdiff_t const tiles((height + RowTileHeight - 1) / RowTileHeight);
+#pragma omp parallel for schedule(static) num_threads(threads)
+		for (std::ptrdiff_t t = 0; t < tiles; ++t)
+		{
+			std::size_t const y0(static_cast<std::size_t>(t) * RowTileHeight);
+			std::size_t const y1(std::min<std::size_t>(y0 + RowTileHeight, height));
+			for (std::size_t y(y0); y < y1; ++y)
+			{
+				for (std::size_t x(0), i(y * width); x < width; ++x, ++i)
+				{
+					std::uint32_t const u(color_index[i]);
+					if (!unique_hit[u])
+						continue;
+					palette.Set(y, x, unique_palette[u * 4 + 0], unique_palette[u * 4 + 1], unique_palette[u * 4 + 2]);
+					float const k(unique_density[u]);
+					stroke_density.Set(y, x, k);
+				}
+			}
+		}
+		for (std::size_t y(0), i(0); y < height; ++y)
+		{
+			for (std::size_t x(0); x < width; ++x, ++i)
+			{
+				if (unique_hit[color_index[i]])
+					continue;
+				FillMissedPixel(palette, y, x);
+				auto const [r1, g1, b1] = original.At(y, x);
+				auto const [r2, g2, b2] = palette.At(y, x);
+				float const k(StrokeDensity(vec3f(r1, g1, b1), vec3f(r2, g2, b2), centroid));
+				stroke_density.Set(y, x, k);
+			}
+		}
+		stroke_density_stats.scatter_seconds = SecondsSince(start);
+
+		// estimates, not measured: per pixel the stages would have taken about total / unique times as long
+		double const extra(static_cast<double>(total) / static_cast<double>(std::max<std::size_t>(unique, 1)) - 1.0);
+		stroke_density_stats.palette_seconds_saved = stroke_density_stats.palette_seconds * extra;
+		stroke_density_stats.density_seconds_saved = stroke_density_stats.density_seconds * extra;
+	}
+	std::uint64_t StrokeDensityCacheKey()
+	{
+		auto const [width, height] = original.GetSize();
+		std::uint64_t key(StrokeDensityCache::Hash(original.data, std::size_t(width) * height * 4));
+		key = StrokeDensityCache::Combine(key, width);
+		key = StrokeDensityCache::Combine(key, height);
+		// Linear, BVH and CubeMap give the same palette
+		key = StrokeDensityCache::Combine(key, palette_intersection == PaletteIntersection::HalfSpace ? 1 : 0);
+		key = StrokeDensityCache::Combine(key, occupancy_hull_input ? 1 : 0);
+		key = StrokeDensityCache::Combine(key, exact_hull ? 1 : 0);
+		key = StrokeDensityCache::Combine(key, hull_prefilter ? 1 : 0);
+		key = StrokeDensityCache::Combine(key, hull_face_budget);
+		key = StrokeDensityCache::Combine(key, hull_vertex_budget);
+		return key;
+	}
+
+	void LoadCachedStrokeDensity()
+	{
+		auto const [width, height] = original.GetSize();
+		std::size_t const total(width * height);
+		float const *density(m_StrokeDensityCache.GetDensity());
+		stroke_density.Setup(width, height);
+		std::memcpy(stroke_density.data, density, total * sizeof(float));
+
+		float const *cached_palette(keep_palette ? m_StrokeDensityCache.GetPalette() : nullptr);
+		if (cached_palette)
+		{
+			palette.Setup(width, height);
+			for (std::size_t i(0); i < total; ++i)
+				std::memcpy(palette.data + i * 4, cached_palette + i * 3, 3 * sizeof(float));
+		}
+		else
+		{
+			palette.Release();
+		}
+		stroke_density_stats.hull_faces = m_StrokeDensityCache.GetHeader().hull_faces;
+		stroke_density_stats.palette_kept = cached_palette != nullptr;
+		stroke_density_stats.cache_bytes = m_StrokeDensityCache.GetMappedSize();
+	}
+
+	// f gets the image the palette pass writes in format: palette for Float32, the FormatImage in narrow_palette otherwise
+	template<typename F>
+	void VisitPalette(PixelFormat format, F &&f)
+	{
+		if (format == PixelFormat::Float32)
+		{
+			narrow_palette.Release();
+			f(palette);
+			return;
+		}
+		palette.Release();
+		narrow_palette.Reset(format, 255.0f);
+		narrow_palette.Visit(f);
+	}
+	template<typename F>
+	void VisitStrokeDensity(PixelFormat format, F &&f)
+	{
+		if (format == PixelFormat::Float32)
+		{
+			narrow_stroke_density.Release();
+			f(stroke_density);
+			return;
+		}
+		stroke_density.Release();
+		narrow_stroke_density.Reset(format, 1.0f);
+		narrow_stroke_density.Visit(f);
+	}
+
+	// the unique color path and the cache give FP32 images, they are encoded afterwards
+	void EncodeNarrowImages(PixelFormat pal_format, PixelFormat density_format)
+	{
+		if (palette && pal_format != PixelFormat::Float32)
+		{
+			narrow_palette.Reset(pal_format, 255.0f);
+			narrow_palette.Visit([this](auto &image) { image.Encode(palette.GetView()); });
+			palette.Release();
+		}
+		if (stroke_density && density_format != PixelFormat::Float32)
+		{
+			narrow_stroke_density.Reset(density_format, 1.0f);
+			narrow_stroke_density.Visit([this](auto &image) {
+				image.Setup(stroke_density.width, stroke_density.height);
+				for (std::uint32_t y(0); y < image.height; ++y)
+					image.EncodeRow(y, stroke_density.Row(y));
+			});
+			stroke_density.Release();
+		}
+	}
+
+	// the stroke density pass on the palette encoded in Format, compared with the FP32 palette and stroke density
+	template<PixelFormat Format>
+	void ReportFormat(vec3f const &centroid, int threads)
+	{
+		FormatReport report{ Format };
+		FormatImage<Format> pal(255.0f);
+		FormatImage<Format, 1> density(1.0f);
+		pal.Encode(palette.GetView());
+		auto const start(std::chrono::steady_clock::now());
+		ComputeStrokeDensity(density, pal, centroid, threads);
+		report.density_seconds = SecondsSince(start);
+		report.palette_error = MeasureFormatError(palette.GetView(), pal);
+		report.density_error = MeasureFormatError(stroke_density, density);
+		report.palette_bytes = pal.GetMemoryUsage();
+		report.density_bytes = density.GetMemoryUsage();
+		stroke_density_stats.format_report.push_back(report);
+	}
+
+	// hull, palette and stroke density
+	void SolveStrokeDensity()
+	{
+		auto const [width, height] = original.GetSize();
+		vec3f centroid(0.0f, 0.0f, 0.0f);
+		auto start(std::chrono::steady_clock::now());
+
+		// the hull reads the pixels in place (stride 4 over RGBA) unless the occupancy grid or the prefilter gives fewer points
+		std::vector<vec3f> pointCloud;
+		quickhull::VertexDataSource<float> points;
+		if (occupancy_hull_input)
+		{
+			ColorOccupancy occupancy;
+			stroke_density_stats.hull_input_occupancy = occupancy.Mark(original.data, width * height);
+			if (stroke_density_stats.hull_input_occupancy)
+			{
+				pointCloud = occupancy.GetBoundaryColors<float>();
+				points = quickhull::VertexDataSource<float>(pointCloud);
+				stroke_density_stats.occupied_colors = occupancy.GetOccupiedCount();
+				stroke_density_stats.hull_input_bytes = occupancy.GetMemoryUsage();
+			}
+		}
+		if (!stroke_density_stats.hull_input_occupancy)
+			points = quickhull::VertexDataSource<float>(original.GetRawData(), width * height, 4);
+		stroke_density_stats.hull_input_points = points.size();
+		stroke_density_stats.hull_input_bytes += pointCloud.capacity() * sizeof(vec3f);
+
+		stroke_density_stats.hull_threads = parallel_hull ? ThreadCount(cpu_threads) : 1;
+		if (hull_prefilter)
+		{
+			auto const prefilter_start(std::chrono::steady_clock::now());
+			quickhull::InteriorPointFilter<float> filter;
+			filter.setThreadCount(static_cast<std::size_t>(stroke_density_stats.hull_threads));
+			filter.setVectorizedClassification(simd_hull);
+			if (stroke_density_stats.hull_input_occupancy)
+			{
+				filter.filter(pointCloud);
+				pointCloud.shrink_to_fit();
+				points = quickhull::VertexDataSource<float>(pointCloud);
+			}
+			else if (filter.setPolytope(points))
+			{
+				filter.copyExteriorPoints(points, pointCloud);
+				points = quickhull::VertexDataSource<float>(pointCloud);
+			}
+			stroke_density_stats.prefilter_seconds = SecondsSince(prefilter_start);
+		}
+		stroke_density_stats.hull_filtered_points = points.size();
+		quickhull::ConvexHull<float> hull;
+		std::vector<quickhull::Plane<float>> face_planes;
+		// 8-bit colors are integers, the occupancy grid only holds those
+		stroke_density_stats.hull_exact = exact_hull && (stroke_density_stats.hull_input_occupancy || quickhull::IntegerQuickHull<float>::hasIntegerCoordinates(points));
+		stroke_density_stats.hull_peak_bytes = 0;
+		auto const build_start(std::chrono::steady_clock::now());
+		if (stroke_density_stats.hull_exact)
+		{
+			quickhull::IntegerQuickHull<float> qh;
+			hull = qh.getConvexHull(points, true, false);
+			face_planes = qh.getFacePlanes();
+			stroke_density_stats.hull_failed_horizon_edges = qh.getDiagnostics().m_failedHorizonEdges;
+		}
+		else if (compact_hull)
+		{
+			quickhull::CompactQuickHull<float> qh;
+			qh.setThreadCount(static_cast<std::size_t>(stroke_density_stats.hull_threads));
+			qh.setVectorizedClassification(simd_hull);
+			hull = qh.getConvexHull(points, true, false);
+			face_planes = qh.getFacePlanes();
+			stroke_density_stats.hull_peak_bytes = qh.getPeakMemoryUsage();
+			stroke_density_stats.hull_failed_horizon_edges = qh.getDiagnostics().m_failedHorizonEdges;
+		}
+		else
+		{
+			auto &qh(m_HullBuilder);
+			qh.setKeepBuffers(true);
+			qh.setThreadCount(static_cast<std::size_t>(stroke_density_stats.hull_threads));
+			qh.setVectorizedClassification(simd_hull);
+			hull = qh.getConvexHull(points, true, false);
+			face_planes = qh.getFacePlanes();
+			stroke_density_stats.hull_failed_horizon_edges = qh.getDiagnostics().m_failedHorizonEdges;
+		}
 		auto indexBuffer = hull.getIndexBuffer();
 		auto vertexBuffer = hull.getVertexBuffer();
+		stroke_density_stats.hull_faces = indexBuffer.size() / 3;
+		stroke_density_stats.hull_build_seconds = SecondsSince(build_start);
+		stroke_density_stats.hull_seconds = SecondsSince(start);
+
+		if (hull_timing_comparison)
+		{
+			auto const float_start(std::chrono::steady_clock::now());
+			quickhull::QuickHull<float> qh;
+			qh.setThreadCount(static_cast<std::size_t>(stroke_density_stats.hull_threads));
+			qh.setVectorizedClassification(simd_hull);
+			auto const float_hull(qh.getConvexHull(points, true, false));
+			stroke_density_stats.float_hull_seconds = SecondsSince(float_start);
+			stroke_density_stats.float_hull_faces = float_hull.getIndexBuffer().size() / 3;
+			stroke_density_stats.float_hull_failed_horizon_edges = qh.getDiagnostics().m_failedHorizonEdges;
+		}
 
 		float total_area(0.0f);
-		vec3f centroid(0.0f, 0.0f, 0.0f);
+		centroid = vec3f(0.0f, 0.0f, 0.0f);
 		for (std::size_t i(0); i < indexBuffer.size(); i += 3)
 		{
 			auto const vertex1(vertexBuffer[indexBuffer[i + 0]]);
@@ -277,85 +996,367 @@ public:
 		}
 		centroid /= total_area;
 
+		// the centroid stays the one of the exact hull, the simplified hull encloses it as well
+		HullSimplifier simplifier;
+		if (hull_face_budget || hull_vertex_budget)
+		{
+			start = std::chrono::steady_clock::now();
+			simplifier = HullSimplifier(face_planes, indexBuffer, vertexBuffer, hull_face_budget, hull_vertex_budget);
+			stroke_density_stats.simplify_seconds = SecondsSince(start);
+			if (simplifier)
+			{
+				indexBuffer = simplifier.GetIndexBuffer();
+				vertexBuffer = quickhull::VertexDataSource<float>(simplifier.GetVertexBuffer());
+				face_planes = simplifier.GetPlanes();
+				stroke_density_stats.simplified_faces = simplifier.GetFaceCount();
+				stroke_density_stats.simplified_triangles = simplifier.GetTriangleCount();
+				stroke_density_stats.simplified_vertices = simplifier.GetVertexCount();
+				stroke_density_stats.hull_volume_error = simplifier.GetVolumeError();
+			}
+		}
 
-		std::size_t i(0);
 		std::size_t const total(width * height);
-		//wchar_t buf[256];
-		//swprintf_s(buf, 255, L"faces: %d\n", indexBuffer.size() / 3);
-		//OutputDebugString(buf);
 
-		// calculate palette values
-		palette.Setup(width, height);
-		i = 0;
-#pragma omp for schedule(dynamic, 1)
-		for (; i < total; ++i)
-		{
-			std::size_t const x(i % width);
-			std::size_t const y(i / width);
-
-			auto const [r, g, b] = original.At(y, x);
-			vec3f const val(r, g, b);
-			vec3f dir(val - centroid);
-			dir.normalize();
-			bool hit_found(false);
-			for (std::size_t f(0); f < indexBuffer.size(); f += 3)
-			{
-				auto const vertex1(vertexBuffer[indexBuffer[f + 0]]);
-				auto const vertex2(vertexBuffer[indexBuffer[f + 1]]);
-				auto const vertex3(vertexBuffer[indexBuffer[f + 2]]);
+		// set up the ray caster, every ray starts at the centroid so the per face constants are computed once here
+		quickhull::PackedConvexHull<float> const packed_hull(indexBuffer, vertexBuffer, true);
+		std::vector<RayTriangle> const hull_triangles(MakeRayTriangles(centroid, packed_hull));
+		auto const linear(MakePaletteSolver(centroid, [&hull_triangles](vec3f const &orig, vec3f const &dir) {
+			return rayHullIntersectLinear(orig, dir, hull_triangles);
+		}));
+		HullBVH bvh;
+		HullPlanes planes;
+		PaletteSolver solve;
+		start = std::chrono::steady_clock::now();
+		switch (palette_intersection)
+		{
+		case PaletteIntersection::BVH:
+			bvh = HullBVH(packed_hull, centroid);
+			solve = MakePaletteSolver(centroid, [&bvh](vec3f const &, vec3f const &dir) {
+				return bvh.Intersect(dir);
+			});
+			break;
+		case PaletteIntersection::HalfSpace:
+			planes = HullPlanes(face_planes, centroid);
+			solve = [&planes](float const *src, float *dst, std::uint8_t *hit, std::size_t count) {
+				planes.Intersect(src, dst, hit, count);
+			};
+			break;
+		case PaletteIntersection::CubeMap:
+			stroke_density_stats.cube_map_reused = m_PaletteCubeMap.Matches(packed_hull, centroid, cube_map_resolution);
+			if (!stroke_density_stats.cube_map_reused)
+				m_PaletteCubeMap = HullCubeMap(packed_hull, centroid, cube_map_resolution);
+			stroke_density_stats.cube_map_bytes = m_PaletteCubeMap.GetMemoryUsage();
+			stroke_density_stats.cube_map_average_candidates = m_PaletteCubeMap.GetAverageCandidates();
+			stroke_density_stats.cube_map_max_candidates = m_PaletteCubeMap.GetMaxCandidates();
+			solve = MakePaletteSolver(centroid, [this](vec3f const &, vec3f const &dir) {
+				return m_PaletteCubeMap.Intersect(dir);
+			});
+			break;
+		case PaletteIntersection::Linear:
+		default:
+			solve = linear;
+			break;
+		}
+		stroke_density_stats.accel_build_seconds = SecondsSince(start);
 
-				auto const [hit, hit_point] = rayTriangleIntersect(centroid, dir, vertex1, vertex2, vertex3);
-				if (hit)
-				{
-					palette.Set(y, x, hit_point.x, hit_point.y, hit_point.z);
-					hit_found = true;
+		int const threads(ThreadCount(cpu_threads));
+		stroke_density_stats.threads = threads;
+		stroke_density_stats.palette_kept = keep_palette || unique_color_memoization || !fused_palette_density || palette_timing_comparison || thread_scaling_report || format_report;
+		// the passes write palette_format and stroke_density_format directly, the FP32 comparisons need FP32 images
+		bool const compare_fp32(palette_timing_comparison || thread_scaling_report || format_report);
+		PixelFormat const pal_format(compare_fp32 ? PixelFormat::Float32 : palette_format);
+		PixelFormat const density_format(compare_fp32 ? PixelFormat::Float32 : stroke_density_format);
+		if (unique_color_memoization)
+		{
+			ComputeStrokeDensityUnique(solve, centroid, threads);
+			EncodeNarrowImages(pal_format, density_format);
+		}
+		else if (fused_palette_density)
+		{
+			start = std::chrono::steady_clock::now();
+			if (!stroke_density_stats.palette_kept)
+				palette.Release();
+			VisitPalette(pal_format, [&](auto &pal) {
+				VisitStrokeDensity(density_format, [&](auto &density) {
+					ComputePaletteAndStrokeDensity(stroke_density_stats.palette_kept ? std::addressof(pal) : nullptr, density, solve, centroid, threads);
+				});
+			});
+			stroke_density_stats.palette_seconds = SecondsSince(start);
+		}
+		else
+		{
+			VisitPalette(pal_format, [&](auto &pal) {
+				// calculate palette values
+				start = std::chrono::steady_clock::now();
+				ComputePalette(pal, solve, threads);
+				stroke_density_stats.palette_seconds = SecondsSince(start);
+
+				// calculate stroke density
+				VisitStrokeDensity(density_format, [&](auto &density) {
+					start = std::chrono::steady_clock::now();
+					ComputeStrokeDensity(density, pal, centroid, threads);
+					stroke_density_stats.density_seconds = SecondsSince(start);
+				});
+			});
+		}
+
+		if (thread_scaling_report)
+		{
+			RGBAImage scaling_palette;
+			ScalarImage scaling_density;
+			for (int n(1); ; n = std::min(n * 2, threads))
+			{
+				ThreadScaling run{ n };
+				start = std::chrono::steady_clock::now();
+				ComputePalette(scaling_palette, solve, n);
+				run.palette_seconds = SecondsSince(start);
+				start = std::chrono::steady_clock::now();
+				ComputeStrokeDensity(scaling_density, scaling_palette, centroid, n);
+				run.density_seconds = SecondsSince(start);
+				run.identical = std::memcmp(palette.data, scaling_palette.data, total * 4 * sizeof(float)) == 0 &&
+					std::memcmp(stroke_density.data, scaling_density.data, total * sizeof(float)) == 0;
+				stroke_density_stats.thread_scaling.push_back(run);
+				if (n == threads)
 					break;
-				}
 			}
-			if (!hit_found)
+		}
+
+		if (format_report)
+		{
+			ReportFormat<PixelFormat::Float16>(centroid, threads);
+			ReportFormat<PixelFormat::UNorm16>(centroid, threads);
+			ReportFormat<PixelFormat::UNorm8>(centroid, threads);
+		}
+
+		if (palette_timing_comparison)
+		{
+			if (palette_intersection == PaletteIntersection::Linear && !unique_color_memoization && !fused_palette_density)
 			{
-				if (x > 0)
-				{
-					auto const [r, g, b] = palette.At(y, x - 1);
-					palette.Set(y, x, r, g, b);
-				}
-				else if (y > 0)
-				{
-					auto const [r, g, b] = palette.At(y - 1, x);
-					palette.Set(y, x, r, g, b);
-				}
-				else
-				{
-					OutputDebugString(L"warn\n");
-				}
+				stroke_density_stats.linear_palette_seconds = stroke_density_stats.palette_seconds;
+				stroke_density_stats.palette_matches_linear = true;
+			}
+			else
+			{
+				RGBAImage linear_palette;
+				start = std::chrono::steady_clock::now();
+				ComputePalette(linear_palette, linear, threads);
+				stroke_density_stats.linear_palette_seconds = SecondsSince(start);
+				stroke_density_stats.palette_matches_linear = std::memcmp(palette.data, linear_palette.data, total * 4 * sizeof(float)) == 0;
+				for (std::size_t i(0); i < total * 4; ++i)
+					stroke_density_stats.palette_max_difference = std::max(stroke_density_stats.palette_max_difference, std::fabs(palette.data[i] - linear_palette.data[i]));
 			}
 		}
+	}
+public:
+	void ComputeStrokeDensityCPU(ID3D11Device *device, ID3D11DeviceContext *context)
+	{
+		if (!original)
+			throw std::runtime_error("empty image");
+		// the cache key, the occupancy grid, the hull input and the unique color table read the pixels as one array of
+		// width * height RGBA pixels (GetRawData), so padded rows and planar images are repacked first
+		if (!original.IsPacked())
+			original = original.Convert(PixelLayout::Interleaved);
+		auto const [width, height] = original.GetSize();
+		std::size_t const total(width * height);
+		stroke_density_stats = StrokeDensityStats{};
+		narrow_palette.Release();
+		narrow_stroke_density.Release();
 
-		// calculate stroke density
-		stroke_density.Setup(width, height);
-		i = 0;
-#pragma omp for schedule(dynamic, 1)
-		for (; i < total; ++i)
+		if (m_StrokeDensityCache.GetDirectory() != std::filesystem::path(stroke_density_cache_directory))
+			m_StrokeDensityCache = StrokeDensityCache(stroke_density_cache_directory);
+		std::uint64_t cache_key(0);
+		if (m_StrokeDensityCache)
 		{
-			std::size_t const x(i % width);
-			std::size_t const y(i / width);
-
-			auto const [r1, g1, b1] = original.At(y, x);
-			vec3f const p(r1, g1, b1);
+			auto start(std::chrono::steady_clock::now());
+			cache_key = StrokeDensityCacheKey();
+			stroke_density_stats.cache_hash_seconds = SecondsSince(start);
 
-			auto const [r2, g2, b2] = palette.At(y, x);
-			vec3f const h(r2, g2, b2);
+			start = std::chrono::steady_clock::now();
+			stroke_density_stats.cache_hit = m_StrokeDensityCache.Load(cache_key, width, height, keep_palette);
+			if (stroke_density_stats.cache_hit)
+			{
+				LoadCachedStrokeDensity();
+				EncodeNarrowImages(palette_format, stroke_density_format);
+			}
+			stroke_density_stats.cache_load_seconds = SecondsSince(start);
+		}
+		if (!stroke_density_stats.cache_hit)
+		{
+			SolveStrokeDensity();
+			// Store reads width * height densities and RGBA pixels from the data pointers, only FP32 images are cached
+			if (m_StrokeDensityCache && stroke_density && !narrow_palette && stroke_density.IsPacked() && (!palette || palette.IsPacked()))
+			{
+				auto const start(std::chrono::steady_clock::now());
+				stroke_density_stats.cache_bytes = m_StrokeDensityCache.Store(cache_key, width, height, static_cast<std::uint32_t>(stroke_density_stats.hull_faces), stroke_density.data, palette ? palette.data : nullptr);
+				stroke_density_stats.cache_store_seconds = SecondsSince(start);
+			}
+		}
+		stroke_density_stats.cache_hits = m_StrokeDensityCache.GetHits();
+		stroke_density_stats.cache_misses = m_StrokeDensityCache.GetMisses();
 
-			auto const pixel_distance((p - centroid).getLength());
-			auto const intersect_distance((h - centroid).getLength());
-			float k(1.0f - std::fabs(1.0f - pixel_distance / intersect_distance));
-			//k = std::sqrt(1.0f - k * k);
-			stroke_density.Set(y, x, k, k, k);
+		wchar_t buf[256];
+		if (stroke_density_stats.cache_hit)
+		{
+			swprintf_s(buf, 255, L"faces: %zu, stroke density%ls from cache\n",
+				stroke_density_stats.hull_faces,
+				stroke_density_stats.palette_kept ? L" and palette" : L"");
+		}
+		else if (fused_palette_density && !unique_color_memoization)
+		{
+			swprintf_s(buf, 255, L"faces: %zu, threads: %d, hull: %.3fs, accel build: %.3fs, fused palette and density: %.3fs, palette %ls\n",
+				stroke_density_stats.hull_faces,
+				stroke_density_stats.threads,
+				stroke_density_stats.hull_seconds,
+				stroke_density_stats.accel_build_seconds,
+				stroke_density_stats.palette_seconds,
+				stroke_density_stats.palette_kept ? L"kept" : L"dropped");
+		}
+		else
+		{
+			swprintf_s(buf, 255, L"faces: %zu, threads: %d, hull: %.3fs, accel build: %.3fs, palette: %.3fs, density: %.3fs\n",
+				stroke_density_stats.hull_faces,
+				stroke_density_stats.threads,
+				stroke_density_stats.hull_seconds,
+				stroke_density_stats.accel_build_seconds,
+				stroke_density_stats.palette_seconds,
+				stroke_density_stats.density_seconds);
+		}
+		OutputDebugString(buf);
+		if (unique_color_memoization)
+		{
+			swprintf_s(buf, 255, L"unique colors: %zu, dedup ratio: %.1fx, table: %.3fs, scatter: %.3fs, estimated saved palette: %.3fs, estimated saved density: %.3fs\n",
+				stroke_density_stats.unique_colors,
+				static_cast<double>(total) / static_cast<double>(std::max<std::size_t>(stroke_density_stats.unique_colors, 1)),
+				stroke_density_stats.unique_table_seconds,
+				stroke_density_stats.scatter_seconds,
+				stroke_density_stats.palette_seconds_saved,
+				stroke_density_stats.density_seconds_saved);
+			OutputDebugString(buf);
+		}
+		if (m_StrokeDensityCache)
+		{
+			swprintf_s(buf, 255, L"cache %ls: hash: %.3fs, load: %.3fs, store: %.3fs, %.1f KiB, hits: %zu, misses: %zu\n",
+				stroke_density_stats.cache_hit ? L"hit" : L"miss",
+				stroke_density_stats.cache_hash_seconds,
+				stroke_density_stats.cache_load_seconds,
+				stroke_density_stats.cache_store_seconds,
+				stroke_density_stats.cache_bytes / 1024.0,
+				stroke_density_stats.cache_hits,
+				stroke_density_stats.cache_misses);
+			OutputDebugString(buf);
+		}
+		if (!stroke_density_stats.cache_hit)
+		{
+			swprintf_s(buf, 255, L"hull input: %zu points, %.1f KiB, %ls, hull threads: %d\n",
+				stroke_density_stats.hull_input_points,
+				stroke_density_stats.hull_input_bytes / 1024.0,
+				stroke_density_stats.hull_input_occupancy ? L"occupancy grid" : L"every pixel",
+				stroke_density_stats.hull_threads);
+			OutputDebugString(buf);
+			if (hull_prefilter)
+			{
+				swprintf_s(buf, 255, L"hull prefilter: %zu of %zu points left, %.3fs\n",
+					stroke_density_stats.hull_filtered_points,
+					stroke_density_stats.hull_input_points,
+					stroke_density_stats.prefilter_seconds);
+				OutputDebugString(buf);
+			}
+			if (compact_hull && !stroke_density_stats.hull_exact)
+			{
+				swprintf_s(buf, 255, L"compact hull peak memory: %.1f KiB\n", stroke_density_stats.hull_peak_bytes / 1024.0);
+				OutputDebugString(buf);
+			}
+			swprintf_s(buf, 255, L"%ls hull: %zu faces, %zu failed horizon edges, %.3fs\n",
+				stroke_density_stats.hull_exact ? L"exact" : L"float",
+				stroke_density_stats.hull_faces,
+				stroke_density_stats.hull_failed_horizon_edges,
+				stroke_density_stats.hull_build_seconds);
+			OutputDebugString(buf);
+			if (hull_timing_comparison)
+			{
+				swprintf_s(buf, 255, L"QuickHull<float>: %zu faces, %zu failed horizon edges, %.3fs (%.2fx)\n",
+					stroke_density_stats.float_hull_faces,
+					stroke_density_stats.float_hull_failed_horizon_edges,
+					stroke_density_stats.float_hull_seconds,
+					stroke_density_stats.float_hull_seconds / stroke_density_stats.hull_build_seconds);
+				OutputDebugString(buf);
+			}
+		}
+		if ((hull_face_budget || hull_vertex_budget) && !stroke_density_stats.cache_hit)
+		{
+			swprintf_s(buf, 255, L"simplified hull: %zu faces, %zu triangles, %zu vertices, volume error: %.2f%%, %.3fs\n",
+				stroke_density_stats.simplified_faces,
+				stroke_density_stats.simplified_triangles,
+				stroke_density_stats.simplified_vertices,
+				stroke_density_stats.hull_volume_error * 100.0,
+				stroke_density_stats.simplify_seconds);
+			OutputDebugString(buf);
+		}
+		if (palette_intersection == PaletteIntersection::CubeMap && !stroke_density_stats.cache_hit)
+		{
+			swprintf_s(buf, 255, L"cube map: %ux%ux6, %ls, %.1f KiB, candidates per cell: %.2f avg, %u max\n",
+				m_PaletteCubeMap.GetResolution(),
+				m_PaletteCubeMap.GetResolution(),
+				stroke_density_stats.cube_map_reused ? L"reused" : L"built",
+				stroke_density_stats.cube_map_bytes / 1024.0,
+				stroke_density_stats.cube_map_average_candidates,
+				stroke_density_stats.cube_map_max_candidates);
+			OutputDebugString(buf);
+		}
+		for (auto const &run : stroke_density_stats.thread_scaling)
+		{
+			auto const &first(stroke_density_stats.thread_scaling.front());
+			swprintf_s(buf, 255, L"threads: %d, palette: %.3fs (%.2fx), density: %.3fs (%.2fx), identical: %d\n",
+				run.threads,
+				run.palette_seconds,
+				first.palette_seconds / run.palette_seconds,
+				run.density_seconds,
+				first.density_seconds / run.density_seconds,
+				run.identical ? 1 : 0);
+			OutputDebugString(buf);
+		}
+		for (auto const &report : stroke_density_stats.format_report)
+		{
+			swprintf_s(buf, 255, L"%ls: palette error: %g max, %g rms, density error: %g max, %g rms, %.1f KiB, density: %.3fs\n",
+				PixelFormatName(report.format),
+				report.palette_error.max_error,
+				report.palette_error.rms_error,
+				report.density_error.max_error,
+				report.density_error.rms_error,
+				(report.palette_bytes + report.density_bytes) / 1024.0,
+				report.density_seconds);
+			OutputDebugString(buf);
+		}
+		if (narrow_palette || narrow_stroke_density)
+		{
+			swprintf_s(buf, 255, L"palette: %ls, stroke density: %ls, %.1f KiB\n",
+				narrow_palette ? PixelFormatName(narrow_palette.GetFormat()) : L"FP32",
+				narrow_stroke_density ? PixelFormatName(narrow_stroke_density.GetFormat()) : L"FP32",
+				(narrow_palette.GetMemoryUsage() + narrow_stroke_density.GetMemoryUsage() + std::size_t(palette.width) * palette.height * 4 * sizeof(float) + stroke_density.GetMemoryUsage()) / 1024.0);
+			OutputDebugString(buf);
+		}
+		if (palette_timing_comparison)
+		{
+			swprintf_s(buf, 255, L"linear palette: %.3fs, speedup: %.2fx, identical: %d, max difference: %g\n",
+				stroke_density_stats.linear_palette_seconds,
+				stroke_density_stats.linear_palette_seconds / stroke_density_stats.palette_seconds,
+				stroke_density_stats.palette_matches_linear ? 1 : 0,
+				stroke_density_stats.palette_max_difference);
+			OutputDebugString(buf);
 		}
 
-		// upload images to GPU
-		palette_GPU.Upload(palette, device, context); // range 0 to 255
-		stroke_density_GPU.Upload(stroke_density, device, context); // range 0 to 1
+		// upload images to GPU, the stroke density texture takes the samples of stroke_density_format as they are
+		if (palette)
+			palette_GPU.Upload(palette, device, context); // range 0 to 255
+		else if (narrow_palette)
+			narrow_palette.Visit([&](auto const &image) { palette_GPU.Upload(image, device, context); });
+		DXGI_FORMAT const density_texture_format(ScalarImageGPU::TextureFormat(narrow_stroke_density ? narrow_stroke_density.GetFormat() : PixelFormat::Float32));
+		if (stroke_density_GPU.GetFormat() != density_texture_format)
+			stroke_density_GPU = ScalarImageGPU(width, height, device, density_texture_format);
+		if (narrow_stroke_density)
+			narrow_stroke_density.Visit([&](auto const &image) { stroke_density_GPU.Upload(image, device, context); }); // range 0 to 1
+		else
+			stroke_density_GPU.Upload(stroke_density, device, context); // range 0 to 1
 
 		//auto tmp(m_GaussianBlur(device, context, stroke_density_GPU, 3, 1.0f));
 		//stroke_density_GPU = std::move(tmp);
@@ -367,6 +1368,28 @@ public:
 			throw std::runtime_error("empty image");
 	}
 
+	// palette, stroke density, blurred image and result as raw image files in directory, readable zero-copy with RawImageReader
+	// the GPU images are downloaded once for it; returns the bytes written
+	std::size_t SaveIntermediates(ID3D11Device *device, ID3D11DeviceContext *context, std::filesystem::path const &directory)
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(directory, ec);
+		std::size_t bytes(0);
+		if (palette)
+			bytes += WriteRawImage(directory / L"palette.plraw", palette.GetView());
+		else if (narrow_palette)
+			bytes += narrow_palette.Visit([&](auto const &image) { return WriteRawImage(directory / L"palette.plraw", image); });
+		if (stroke_density)
+			bytes += WriteRawScalarImage(directory / L"stroke_density.plraw", stroke_density);
+		else if (narrow_stroke_density)
+			bytes += narrow_stroke_density.Visit([&](auto const &image) { return WriteRawImage(directory / L"stroke_density.plraw", image); });
+		if (blurred_image_GPU)
+			bytes += WriteRawImage(directory / L"blurred_image.plraw", blurred_image_GPU.Download(device, context).GetView());
+		if (result_GPU)
+			bytes += WriteRawImage(directory / L"result.plraw", result_GPU.Download(device, context).GetView());
+		return bytes;
+	}
+
 	void ResetWithNewImage(ID3D11Device *device, ID3D11DeviceContext *context, std::wstring_view filename)
 	{
 		ReleaseImages();
@@ -375,15 +1398,16 @@ public:
 		// phase 2 resources
 		original_GPU = RGBAImageGPU(original, device);
 		palette_GPU = RGBAImageGPU(original, device);
-		stroke_density_GPU = RGBAImageGPU(original, device);
-
-		// phase 1 resources
-		blurred_image_GPU = RGBAImageGPU(original, device);
-		normalized_image_GPU = RGBAImageGPU(original, device);
-		coarse_lighting_GPU = RGBAImageGPU(original, device);
-		refined_lighting_GPU = RGBAImageGPU(original, device);
-		final_lighting_GPU = RGBAImageGPU(original, device);
-		result_GPU = RGBAImageGPU(original, device);
+		stroke_density_GPU = ScalarImageGPU(original.width, original.height, device);
+
+		// phase 1 resources, only written by the shaders so FP16 needs no typed UAV loads
+		DXGI_FORMAT const texture_format(half_float_textures ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R32G32B32A32_FLOAT);
+		blurred_image_GPU = RGBAImageGPU(original, device, texture_format);
+		normalized_image_GPU = RGBAImageGPU(original, device, texture_format);
+		coarse_lighting_GPU = RGBAImageGPU(original, device, texture_format);
+		refined_lighting_GPU = RGBAImageGPU(original, device, texture_format);
+		final_lighting_GPU = RGBAImageGPU(original, device, texture_format);
+		result_GPU = RGBAImageGPU(original, device, texture_format);
 
 		original_GPU.Upload(original, device, context);
 	}
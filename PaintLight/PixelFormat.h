@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+// F16C comes with every AVX2 CPU, MSVC enables it with /arch:AVX2, GCC and Clang with -mf16c
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define PIXELFORMAT_F16C
+#endif
+
+// sample formats of the CPU images
+enum class PixelFormat
+{
+	Float32,
+	Float16, // IEEE half, 11 significant bits
+	UNorm16, // 0 .. 65535 for 0 .. scale
+	UNorm8, // 0 .. 255 for 0 .. scale, exact for 8-bit colors with scale 255
+};
+
+template<PixelFormat Format>
+struct PixelFormatTraits;
+
+template<>
+struct PixelFormatTraits<PixelFormat::Float32>
+{
+	using Sample = float;
+	static constexpr wchar_t const *Name = L"FP32";
+};
+
+template<>
+struct PixelFormatTraits<PixelFormat::Float16>
+{
+	using Sample = std::uint16_t;
+	static constexpr wchar_t const *Name = L"FP16";
+};
+
+template<>
+struct PixelFormatTraits<PixelFormat::UNorm16>
+{
+	using Sample = std::uint16_t;
+	static constexpr float Max = 65535.0f;
+	static constexpr wchar_t const *Name = L"UNORM16";
+};
+
+template<>
+struct PixelFormatTraits<PixelFormat::UNorm8>
+{
+	using Sample = std::uint8_t;
+	static constexpr float Max = 255.0f;
+	static constexpr wchar_t const *Name = L"UNORM8";
+};
+
+inline wchar_t const *PixelFormatName(PixelFormat format)
+{
+	switch (format)
+	{
+	case PixelFormat::Float16: return PixelFormatTraits<PixelFormat::Float16>::Name;
+	case PixelFormat::UNorm16: return PixelFormatTraits<PixelFormat::UNorm16>::Name;
+	case PixelFormat::UNorm8: return PixelFormatTraits<PixelFormat::UNorm8>::Name;
+	case PixelFormat::Float32:
+	default: return PixelFormatTraits<PixelFormat::Float32>::Name;
+	}
+}
+
+// round to nearest even, overflow to infinity, like _mm256_cvtps_ph
+inline std::uint16_t FloatToHalf(float value)
+{
+	std::uint32_t x;
+	std::memcpy(&x, &value, sizeof(x));
+	std::uint32_t const sign(x & 0x80000000u);
+	x ^= sign;
+	std::uint32_t half;
+	if (x >= (127u + 16u) << 23) // 65536 and above, infinity or NaN
+	{
+		half = x > 0x7f800000u ? 0x7e00u : 0x7c00u;
+	}
+	else if (x < 113u << 23) // subnormal half, the float addition does the rounding
+	{
+		std::uint32_t const magic_bits(((127u - 15u) + (23u - 10u) + 1u) << 23);
+		float magic, f;
+		std::memcpy(&magic, &magic_bits, sizeof(magic));
+		std::memcpy(&f, &x, sizeof(f));
+		f += magic;
+		std::memcpy(&x, &f, sizeof(x));
+		half = x - magic_bits;
+	}
+	else
+	{
+		std::uint32_t const mantissa_odd((x >> 13) & 1u);
+		x += ((15u - 127u) << 23) + 0xfffu + mantissa_odd;
+		half = x >> 13;
+	}
+	return static_cast<std::uint16_t>(half | (sign >> 16));
+}
+
+inline float HalfToFloat(std::uint16_t half)
+{
+	std::uint32_t const shifted_exponent(0x7c00u << 13);
+	std::uint32_t x((half & 0x7fffu) << 13);
+	std::uint32_t const exponent(x & shifted_exponent);
+	x += (127u - 15u) << 23;
+	float f;
+	if (exponent == shifted_exponent) // infinity or NaN
+	{
+		x += (128u - 16u) << 23;
+		std::memcpy(&f, &x, sizeof(f));
+	}
+	else if (exponent == 0) // subnormal
+	{
+		x += 1u << 23;
+		std::uint32_t const magic_bits(113u << 23);
+		float magic;
+		std::memcpy(&magic, &magic_bits, sizeof(magic));
+		std::memcpy(&f, &x, sizeof(f));
+		f -= magic;
+	}
+	else
+	{
+		std::memcpy(&f, &x, sizeof(f));
+	}
+	std::uint32_t bits;
+	std::memcpy(&bits, &f, sizeof(bits));
+	bits |= std::uint32_t(half & 0x8000u) << 16;
+	std::memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+// count floats to samples, scale is the value of the largest UNORM sample (ignored by the float formats)
+// the vectorized loops and the scalar tails give the same samples
+template<PixelFormat Format>
+void EncodeSamples(float const *src, typename PixelFormatTraits<Format>::Sample *dst, std::size_t count, float scale)
+{
+	std::size_t i(0);
+	if constexpr (Format == PixelFormat::Float32)
+	{
+		std::memcpy(dst, src, count * sizeof(float));
+		return;
+	}
+	else if constexpr (Format == PixelFormat::Float16)
+	{
+#if defined(PIXELFORMAT_F16C)
+		for (; i + 8 <= count; i += 8)
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+		for (; i < count; ++i)
+			dst[i] = FloatToHalf(src[i]);
+	}
+	else
+	{
+		float const max(PixelFormatTraits<Format>::Max);
+		float const factor(max / scale);
+#if defined(__AVX2__)
+		__m256 const factor8(_mm256_set1_ps(factor)), zero8(_mm256_setzero_ps()), max8(_mm256_set1_ps(max));
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 const v(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), factor8), zero8), max8));
+			__m256i const q(_mm256_cvtps_epi32(v));
+			__m256i const words(_mm256_permute4x64_epi64(_mm256_packus_epi32(q, q), _MM_SHUFFLE(3, 1, 2, 0)));
+			if constexpr (Format == PixelFormat::UNorm16)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm256_castsi256_si128(words));
+			}
+			else
+			{
+				__m128i const w(_mm256_castsi256_si128(words));
+				_mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(w, w));
+			}
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			float v(src[i] * factor);
+			v = v > 0.0f ? v : 0.0f;
+			v = v < max ? v : max;
+			dst[i] = static_cast<typename PixelFormatTraits<Format>::Sample>(std::nearbyint(v));
+		}
+	}
+}
+
+// count samples to floats
+template<PixelFormat Format>
+void DecodeSamples(typename PixelFormatTraits<Format>::Sample const *src, float *dst, std::size_t count, float scale)
+{
+	std::size_t i(0);
+	if constexpr (Format == PixelFormat::Float32)
+	{
+		std::memcpy(dst, src, count * sizeof(float));
+		return;
+	}
+	else if constexpr (Format == PixelFormat::Float16)
+	{
+#if defined(PIXELFORMAT_F16C)
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i))));
+#endif
+		for (; i < count; ++i)
+			dst[i] = HalfToFloat(src[i]);
+	}
+	else
+	{
+		float const step(scale / PixelFormatTraits<Format>::Max);
+#if defined(__AVX2__)
+		__m256 const step8(_mm256_set1_ps(step));
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i q;
+			if constexpr (Format == PixelFormat::UNorm16)
+				q = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i)));
+			else
+				q = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(src + i)));
+			_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(q), step8));
+		}
+#endif
+		for (; i < count; ++i)
+			dst[i] = static_cast<float>(src[i]) * step;
+	}
+}
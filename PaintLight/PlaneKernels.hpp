@@ -0,0 +1,292 @@
+#ifndef PLANEKERNELS_HPP_
+#define PLANEKERNELS_HPP_
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <cmath>
+#include <cstdint>
+#include "Structs/Vector3.hpp"
+#include "Structs/Plane.hpp"
+#include "Structs/VertexDataSource.hpp"
+#include "Vector3x8.h"
+
+/*
+ * Point to plane distance kernels for the QuickHull point partitioning
+ *
+ * Each kernel has a scalar loop, which is the reference, and for floats an AVX2 loop that evaluates eight points at a
+ * time with Float8, compiled when AVX2 is enabled (VectorizedClassificationAvailable). The simd argument selects between
+ * them at run time. Distances are computed as m_N.dotProduct(p) + m_D in both, without fused multiply-adds, so they give
+ * the same results bit for bit. Most distant points are found with a maximum per lane that keeps the first of equals,
+ * reduced to the first of equals in point order. The AVX2 loops gather the points by index, so the points of a face do
+ * not need to be contiguous.
+ * */
+
+namespace quickhull {
+
+	// Plane of a point classification. A point is on its positive side if D = m_N.dotProduct(p) + m_D is positive and
+	// D*D > m_threshold, which QuickHull sets to epsilon squared times the squared length of the normal.
+	template<typename T>
+	struct ClassificationPlane {
+		Vector3<T> m_N;
+		T m_D;
+		T m_threshold;
+	};
+
+	// Points of one plane found by classifyPoints
+	template<typename T>
+	struct ClassificationResult {
+		size_t m_count = 0;
+		T m_mostDistantDist = 0;
+		size_t m_mostDistantPosition = 0; // i of the most distant point, valid if m_count > 0
+	};
+
+#if defined(__AVX2__)
+	constexpr bool VectorizedClassificationAvailable = true;
+#else
+	constexpr bool VectorizedClassificationAvailable = false;
+#endif
+
+#if defined(__AVX2__)
+	namespace planekernels {
+
+		// Runs of at most this many points keep the positions of the lane maxima exact in floats
+		constexpr size_t RunLength = 1 << 16;
+
+		// Point clouds of at most this many floats (points times stride) have gather offsets that fit in 32 bits
+		constexpr size_t MaxGatherFloats = std::numeric_limits<std::int32_t>::max();
+
+		// Maximum and its position in each lane, the first of equals
+		struct LaneArgMax {
+			Float8 m_value;
+			Float8 m_position;
+
+			explicit LaneArgMax(float value) : m_value(value), m_position(0.0f) {}
+
+			void Update(Float8 const &mask, Float8 const &value, Float8 const &position) {
+				const Float8 greater = Select(mask, value > m_value, Float8(0.0f));
+				m_value = Select(greater, value, m_value);
+				m_position = Select(greater, position, m_position);
+			}
+
+			// Largest value of the lanes with the lowest position of equals
+			void Reduce(float& value, size_t& position) const {
+				float values[Float8::Width], positions[Float8::Width];
+				m_value.Store(values);
+				m_position.Store(positions);
+				value = values[0];
+				position = static_cast<size_t>(positions[0]);
+				for (size_t k=1;k<Float8::Width;k++) {
+					const size_t p = static_cast<size_t>(positions[k]);
+					if (values[k] > value || (values[k] == value && p < position)) {
+						value = values[k];
+						position = p;
+					}
+				}
+			}
+		};
+
+		inline __m256i LaneIndices() {
+			return _mm256_setr_epi32(0,1,2,3,4,5,6,7);
+		}
+
+		// Indices pointAt(i+k) for k < count, zero past count
+		template<typename PointAt>
+		inline __m256i LoadIndices(PointAt pointAt, size_t i, size_t count) {
+			if (count == Float8::Width) {
+				return _mm256_setr_epi32(static_cast<int>(pointAt(i)),static_cast<int>(pointAt(i+1)),static_cast<int>(pointAt(i+2)),static_cast<int>(pointAt(i+3)),
+										 static_cast<int>(pointAt(i+4)),static_cast<int>(pointAt(i+5)),static_cast<int>(pointAt(i+6)),static_cast<int>(pointAt(i+7)));
+			}
+			alignas(32) int indices[Float8::Width] = {};
+			for (size_t k=0;k<count;k++) {
+				indices[k] = static_cast<int>(pointAt(i+k));
+			}
+			return _mm256_load_si256(reinterpret_cast<const __m256i*>(indices));
+		}
+
+		// Lanes below count that are not skipPoint
+		inline Float8 ActiveLanes(__m256i indices, size_t count, size_t skipPoint) {
+			const __m256i inRange = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(count)),LaneIndices());
+			const __m256i skipped = _mm256_cmpeq_epi32(indices,_mm256_set1_epi32(static_cast<int>(skipPoint)));
+			return Float8(_mm256_castsi256_ps(_mm256_andnot_si256(skipped,inRange)));
+		}
+
+		inline Vector3x8 GatherPoints(const VertexDataSource<float>& vertices, __m256i indices) {
+			const float* xyz = vertices.data();
+			const __m256i offsets = vertices.stride() == 3 ? _mm256_add_epi32(indices,_mm256_add_epi32(indices,indices))
+														   : _mm256_mullo_epi32(indices,_mm256_set1_epi32(static_cast<int>(vertices.stride())));
+			return Vector3x8(Float8(_mm256_i32gather_ps(xyz,offsets,4)),Float8(_mm256_i32gather_ps(xyz+1,offsets,4)),Float8(_mm256_i32gather_ps(xyz+2,offsets,4)));
+		}
+
+		inline Float8 SignedDistance(const Vector3x8& p, const Vector3<float>& N, float D) {
+			return Vector3x8(N).dotProduct(p) + Float8(D);
+		}
+
+		inline int LaneCount(int lanes) {
+			int count = 0;
+			for (;lanes;lanes &= lanes-1) {
+				count++;
+			}
+			return count;
+		}
+
+		template<typename Slot, typename PointAt>
+		void classifyPoints8(const VertexDataSource<float>& vertices, PointAt pointAt, size_t begin, size_t end, size_t skipPoint,
+							 const ClassificationPlane<float>* planes, size_t planeCount, Slot* slots, ClassificationResult<float>* results) {
+			static thread_local std::vector<LaneArgMax> lanes;
+			static thread_local std::vector<size_t> runCounts;
+			lanes.resize(planeCount, LaneArgMax(0.0f));
+			runCounts.resize(planeCount);
+			const VertexDataSource<float> points = vertices;
+			for (size_t runBegin=begin;runBegin<end;runBegin+=RunLength) {
+				const size_t runEnd = std::min(runBegin+RunLength,end);
+				std::fill(lanes.begin(),lanes.begin()+planeCount,LaneArgMax(0.0f));
+				std::fill(runCounts.begin(),runCounts.begin()+planeCount,0);
+				Float8 positions(_mm256_cvtepi32_ps(LaneIndices()));
+				for (size_t i=runBegin;i<runEnd;i+=Float8::Width, positions = positions + Float8(static_cast<float>(Float8::Width))) {
+					const size_t count = std::min(Float8::Width,runEnd-i);
+					const __m256i indices = LoadIndices(pointAt,i,count);
+					const Vector3x8 p = GatherPoints(points,indices);
+					Float8 activeMask = ActiveLanes(indices,count,skipPoint);
+					int active = activeMask.MoveMask();
+					__m256i pointSlots = _mm256_set1_epi32(-1); // the maximum of Slot once narrowed
+					for (size_t j=0;j<planeCount && active;j++) {
+						const Float8 D = SignedDistance(p,planes[j].m_N,planes[j].m_D);
+						const Float8 positive = Select(D > Float8(0.0f), D*D > Float8(planes[j].m_threshold), Float8(0.0f));
+						const Float8 assignedMask = Select(activeMask, positive, Float8(0.0f));
+						const int assigned = assignedMask.MoveMask();
+						if (assigned) {
+							pointSlots = _mm256_blendv_epi8(pointSlots,_mm256_set1_epi32(static_cast<int>(j)),_mm256_castps_si256(assignedMask.v));
+							runCounts[j] += LaneCount(assigned);
+							lanes[j].Update(assignedMask,D,positions);
+							activeMask = Select(assignedMask, Float8(0.0f), activeMask);
+							active &= ~assigned;
+						}
+					}
+					if (sizeof(Slot) == sizeof(std::int32_t) && count == Float8::Width) {
+						_mm256_storeu_si256(reinterpret_cast<__m256i*>(slots+i),pointSlots);
+					}
+					else {
+						alignas(32) std::int32_t s[Float8::Width];
+						_mm256_store_si256(reinterpret_cast<__m256i*>(s),pointSlots);
+						for (size_t k=0;k<count;k++) {
+							slots[i+k] = static_cast<Slot>(s[k]);
+						}
+					}
+				}
+				for (size_t j=0;j<planeCount;j++) {
+					if (runCounts[j]) {
+						float value;
+						size_t position;
+						lanes[j].Reduce(value,position);
+						results[j].m_count += runCounts[j];
+						if (value > results[j].m_mostDistantDist) {
+							results[j].m_mostDistantDist = value;
+							results[j].m_mostDistantPosition = runBegin+position;
+						}
+					}
+				}
+			}
+		}
+
+		inline bool findMostDistantPoint8(const VertexDataSource<float>& vertices, size_t begin, size_t end, const Plane<float>& P, std::pair<float,size_t>& best) {
+			bool found = false;
+			for (size_t runBegin=begin;runBegin<end;runBegin+=RunLength) {
+				const size_t runEnd = std::min(runBegin+RunLength,end);
+				LaneArgMax lanes(best.first);
+				bool runFound = false;
+				Float8 positions(_mm256_cvtepi32_ps(LaneIndices()));
+				for (size_t i=runBegin;i<runEnd;i+=Float8::Width, positions = positions + Float8(static_cast<float>(Float8::Width))) {
+					const size_t count = std::min(Float8::Width,runEnd-i);
+					const __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)),LaneIndices());
+					const Float8 mask = ActiveLanes(indices,count,std::numeric_limits<size_t>::max());
+					const __m256i loaded = _mm256_and_si256(indices,_mm256_castps_si256(mask.v)); // point 0 past the end
+					const Float8 d = Abs(SignedDistance(GatherPoints(vertices,loaded),P.m_N,P.m_D));
+					if ((Select(mask, d > lanes.m_value, Float8(0.0f))).MoveMask()) {
+						lanes.Update(mask,d,positions);
+						runFound = true;
+					}
+				}
+				if (runFound) {
+					float value;
+					size_t position;
+					lanes.Reduce(value,position);
+					if (value > best.first) {
+						best = {value,runBegin+position};
+						found = true;
+					}
+				}
+			}
+			return found;
+		}
+
+	}
+#endif
+
+	// Gives each point pointAt(i), i in [begin, end), the slot of the first of the planes it is on the positive side of in
+	// slots[i], or the maximum of Slot if none (also for skipPoint). Adds the number of points and the most distant point,
+	// the first of equals, of each plane to results, which must start at m_mostDistantDist 0 or continue a previous range.
+	template<typename T, typename Slot, typename PointAt>
+	void classifyPoints(const VertexDataSource<T>& vertices, PointAt pointAt, size_t begin, size_t end, size_t skipPoint,
+						const ClassificationPlane<T>* planes, size_t planeCount, Slot* slots, ClassificationResult<T>* results, bool simd) {
+#if defined(__AVX2__)
+		if constexpr (std::is_same<T,float>::value) {
+			if (simd && vertices.size()*vertices.stride() <= planekernels::MaxGatherFloats) {
+				return planekernels::classifyPoints8(vertices,pointAt,begin,end,skipPoint,planes,planeCount,slots,results);
+			}
+		}
+#else
+		(void)simd;
+#endif
+		constexpr Slot NoSlot = std::numeric_limits<Slot>::max();
+		const VertexDataSource<T> points = vertices; // a local copy, slots may alias everything
+		for (size_t i=begin;i<end;i++) {
+			const size_t point = pointAt(i);
+			Slot slot = NoSlot;
+			if (point != skipPoint) {
+				const Vector3<T> v = points[point];
+				for (size_t j=0;j<planeCount;j++) {
+					const T D = planes[j].m_N.dotProduct(v)+planes[j].m_D;
+					if (D>0 && D*D > planes[j].m_threshold) {
+						slot = static_cast<Slot>(j);
+						results[j].m_count++;
+						if (D > results[j].m_mostDistantDist) {
+							results[j].m_mostDistantDist = D;
+							results[j].m_mostDistantPosition = i;
+						}
+						break;
+					}
+				}
+			}
+			slots[i] = slot;
+		}
+	}
+
+	// Finds the point in [begin, end) farthest from the plane on either side, the first of equals, if it is farther than
+	// best.first, and stores its distance and index in best. Returns whether best changed.
+	template<typename T>
+	bool findMostDistantPoint(const VertexDataSource<T>& vertices, size_t begin, size_t end, const Plane<T>& P, std::pair<T,size_t>& best, bool simd) {
+#if defined(__AVX2__)
+		if constexpr (std::is_same<T,float>::value) {
+			if (simd && vertices.size()*vertices.stride() <= planekernels::MaxGatherFloats) {
+				return planekernels::findMostDistantPoint8(vertices,begin,end,P,best);
+			}
+		}
+#else
+		(void)simd;
+#endif
+		bool found = false;
+		for (size_t i=begin;i<end;i++) {
+			const T d = std::abs(P.m_N.dotProduct(vertices[i])+P.m_D);
+			if (d > best.first) {
+				best = {d,i};
+				found = true;
+			}
+		}
+		return found;
+	}
+
+}
+
+#endif /* PLANEKERNELS_HPP_ */
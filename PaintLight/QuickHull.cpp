@@ -7,6 +7,10 @@
 #include "Structs/Mesh.hpp"
 #include "DXUT.h"
 #include "QuickHull.hpp"
+#include "InteriorPointFilter.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace quickhull {
 	
@@ -16,6 +20,15 @@ namespace quickhull {
 	 * Implementation of the algorithm
 	 */
 
+	template<typename T>
+	void QuickHull<T>::setThreadCount(size_t threads) {
+#ifdef _OPENMP
+		m_threadCount = threads ? threads : static_cast<size_t>(omp_get_max_threads());
+#else
+		m_threadCount = 1;
+#endif
+	}
+
 	template<typename T>
 	ConvexHull<T> QuickHull<T>::getConvexHull(const std::vector<Vector3<T>>& pointCloud, bool CCW, bool useOriginalIndices, T epsilon) {
 		VertexDataSource<T> vertexDataSource(pointCloud);
@@ -37,12 +50,14 @@ namespace quickhull {
 	template<typename FloatType>
 	HalfEdgeMesh<FloatType, size_t> QuickHull<FloatType>::getConvexHullAsMesh(const FloatType* vertexData, size_t vertexCount, bool CCW, FloatType epsilon) {
 		VertexDataSource<FloatType> vertexDataSource((const vec3*)vertexData,vertexCount);
+		m_incremental = false;
 		buildMesh(vertexDataSource, CCW, false, epsilon);
 		return HalfEdgeMesh<FloatType, size_t>(m_mesh, m_vertexData);
 	}
 	
 	template<typename T>
 	void QuickHull<T>::buildMesh(const VertexDataSource<T>& pointCloud, bool CCW, bool useOriginalIndices, T epsilon) {
+		m_hasVolume = false;
 		if (pointCloud.size()==0) {
 			m_mesh = MeshBuilder<T>();
 			return;
@@ -63,23 +78,203 @@ namespace quickhull {
 		m_planar = false; // The planar case happens when all the points appear to lie on a two dimensional subspace of R^3.
 		createConvexHalfEdgeMesh();
 		if (m_planar) {
-			const size_t extraPointIndex = m_planarPointCloudTemp.size()-1;
+			// The faces around the extra point fold down onto the plane of the points, facing the side the extra point was on
+			const size_t extraPointIndex = m_vertexData.size();
+			const Plane<T> extraPointSidePlane(m_planarExtraPoint - m_vertexData[0], m_vertexData[0]);
 			for (auto& he : m_mesh.m_halfEdges) {
 				if (he.m_endVertex == extraPointIndex) {
 					he.m_endVertex = 0;
+					m_mesh.m_faces[he.m_face].m_P = extraPointSidePlane;
 				}
 			}
-			m_vertexData = pointCloud;
-			m_planarPointCloudTemp.clear();
 		}
 	}
 
 	template<typename T>
 	ConvexHull<T> QuickHull<T>::getConvexHull(const VertexDataSource<T>& pointCloud, bool CCW, bool useOriginalIndices, T epsilon) {
+		m_incremental = false;
 		buildMesh(pointCloud,CCW,useOriginalIndices,epsilon);
 		return ConvexHull<T>(m_mesh,m_vertexData, CCW, useOriginalIndices);
 	}
 
+	template<typename T>
+	PackedConvexHull<T> QuickHull<T>::getPackedConvexHull(const VertexDataSource<T>& pointCloud, bool CCW, T epsilon) {
+		m_incremental = false;
+		buildMesh(pointCloud,CCW,false,epsilon);
+		return PackedConvexHull<T>(m_mesh,m_vertexData,CCW);
+	}
+
+	template<typename T>
+	void QuickHull<T>::beginIncremental(T epsilon) {
+		m_incremental = true;
+		m_hasVolume = false;
+		m_incrementalEpsilon = epsilon;
+		m_incrementalPoints.clear();
+		m_incrementalPointCount = 0;
+		m_vertexData = VertexDataSource<T>();
+		m_mesh = MeshBuilder<T>();
+		m_diagnostics = DiagnosticsData();
+	}
+
+	template<typename T>
+	void QuickHull<T>::continueIncremental(T epsilon) {
+		const bool hasVolume = m_hasVolume;
+		m_incremental = true;
+		m_incrementalEpsilon = epsilon;
+		m_incrementalPoints.clear();
+		m_incrementalPointCount = m_vertexData.size();
+		if (m_mesh.m_faces.empty()) {
+			m_hasVolume = false;
+			m_vertexData = VertexDataSource<T>();
+			return;
+		}
+		if (!hasVolume) {
+			// Flat hull: its vertices are the points kept so far
+			const ConvexHull<T> hull(m_mesh, m_vertexData, true, false);
+			const auto& vertices = hull.getVertexBuffer();
+			m_incrementalPoints.assign(vertices.begin(), vertices.end());
+			buildMesh(VertexDataSource<T>(m_incrementalPoints), true, false, m_incrementalEpsilon);
+			return;
+		}
+
+		// Copy the vertices of the mesh out of the point cloud of the last hull and renumber the half edges
+		constexpr size_t Unused = std::numeric_limits<size_t>::max();
+		std::vector<size_t> newIndex(m_vertexData.size(), Unused);
+		for (auto& he : m_mesh.m_halfEdges) {
+			if (!he.isDisabled() && newIndex[he.m_endVertex] == Unused) {
+				newIndex[he.m_endVertex] = m_incrementalPoints.size();
+				m_incrementalPoints.push_back(m_vertexData[he.m_endVertex]);
+			}
+		}
+		for (auto& he : m_mesh.m_halfEdges) {
+			if (!he.isDisabled()) {
+				he.m_endVertex = newIndex[he.m_endVertex];
+			}
+		}
+		m_vertexData = VertexDataSource<T>(m_incrementalPoints);
+	}
+
+	template<typename T>
+	void QuickHull<T>::addPoints(const Vector3<T>* points, size_t count) {
+		assert(m_incremental);
+		if (count == 0) {
+			return;
+		}
+		m_incrementalPointCount += count;
+		if (!m_hasVolume) {
+			// Rebuild from every point kept so far. Flat clouds keep only the vertices of their hull once there are many.
+			m_incrementalPoints.insert(m_incrementalPoints.end(), points, points+count);
+			buildMesh(VertexDataSource<T>(m_incrementalPoints), true, false, m_incrementalEpsilon);
+			if (m_hasVolume) {
+				compactIncrementalPoints();
+			}
+			else if (m_incrementalPoints.size() > IncrementalFlatPointLimit) {
+				const ConvexHull<T> hull(m_mesh, m_vertexData, true, false);
+				const auto& vertices = hull.getVertexBuffer();
+				m_incrementalPoints.assign(vertices.begin(), vertices.end());
+				buildMesh(VertexDataSource<T>(m_incrementalPoints), true, false, m_incrementalEpsilon);
+			}
+			return;
+		}
+
+		// Drop the points inside the polytope of the extreme vertices of the hull, they are inside the hull as well
+		std::vector<vec3> batch(points, points+count);
+		InteriorPointFilter<T> filter;
+		filter.setThreadCount(m_threadCount);
+		filter.setVectorizedClassification(m_vectorizedClassification);
+		if (filter.setPolytope(m_vertexData, m_incrementalEpsilon)) {
+			filter.removeInteriorPoints(batch);
+		}
+		if (batch.empty()) {
+			return;
+		}
+
+		// Keep the others after the hull vertices
+		const size_t first = m_incrementalPoints.size();
+		m_incrementalPoints.insert(m_incrementalPoints.end(), batch.begin(), batch.end());
+		std::vector<vec3>().swap(batch);
+		std::vector<size_t> faceIndices;
+		for (size_t i=0;i<m_mesh.m_faces.size();i++) {
+			if (!m_mesh.m_faces[i].isDisabled()) {
+				faceIndices.push_back(i);
+			}
+		}
+
+		// Assign them to the faces of the current hull they are in front of. The mesh is always extended, never rebuilt:
+		// a rebuild from the hull vertices would drop those within the tolerance of its faces, and the hull would shrink
+		// by up to the tolerance with every batch. A point inside the hull is tested against every face though.
+		const size_t newPointCount = m_incrementalPoints.size()-first;
+		m_vertexData = VertexDataSource<T>(m_incrementalPoints);
+		for (size_t i=first;i<m_incrementalPoints.size();i++) {
+			const vec3& v = m_incrementalPoints[i];
+			m_scale = std::max({m_scale, std::abs(v.x), std::abs(v.y), std::abs(v.z)});
+		}
+		m_epsilon = m_incrementalEpsilon*m_scale;
+		m_epsilonSquared = m_epsilon*m_epsilon;
+		for (const auto i : faceIndices) {
+			auto& f = m_mesh.m_faces[i];
+			if (f.m_pointsOnPositiveSide) {
+				// Left over from a point whose horizon edge could not be solved
+				reclaimToIndexVectorPool(f.m_pointsOnPositiveSide);
+			}
+			f.m_mostDistantPointDist = 0;
+		}
+		assignPointsToFaces(newPointCount, [first](size_t i) { return first+i; }, faceIndices.data(), faceIndices.size(),
+							std::numeric_limits<size_t>::max());
+
+		// Extrude like getConvexHull does after the initial tetrahedron
+		m_visibleFaces.clear();
+		m_horizonEdges.clear();
+		m_possiblyVisibleFaces.clear();
+		m_faceList.clear();
+		for (const auto i : faceIndices) {
+			auto& f = m_mesh.m_faces[i];
+			if (f.m_pointsOnPositiveSide) {
+				m_faceList.push_back(i);
+				f.m_inFaceStack = 1;
+			}
+		}
+		processFaceList();
+		compactIncrementalPoints();
+	}
+
+	template<typename T>
+	ConvexHull<T> QuickHull<T>::getIncrementalHull(bool CCW) const {
+		assert(m_incremental);
+		if (m_incrementalPoints.empty()) {
+			return ConvexHull<T>();
+		}
+		return ConvexHull<T>(m_mesh, m_vertexData, CCW, false);
+	}
+
+	template<typename T>
+	void QuickHull<T>::compactIncrementalPoints() {
+		constexpr size_t Unused = std::numeric_limits<size_t>::max();
+		std::vector<size_t> newIndex(m_incrementalPoints.size(), Unused);
+		for (const auto& he : m_mesh.m_halfEdges) {
+			if (!he.isDisabled()) {
+				newIndex[he.m_endVertex] = 0;
+			}
+		}
+		size_t kept = 0;
+		for (size_t i=0;i<m_incrementalPoints.size();i++) {
+			if (newIndex[i] != Unused) {
+				newIndex[i] = kept;
+				m_incrementalPoints[kept++] = m_incrementalPoints[i];
+			}
+		}
+		m_incrementalPoints.resize(kept);
+		if (m_incrementalPoints.capacity() > 2*kept) {
+			m_incrementalPoints.shrink_to_fit();
+		}
+		for (auto& he : m_mesh.m_halfEdges) {
+			if (!he.isDisabled()) {
+				he.m_endVertex = newIndex[he.m_endVertex];
+			}
+		}
+		m_vertexData = VertexDataSource<T>(m_incrementalPoints);
+	}
+
 	template<typename T>
 	void QuickHull<T>::createConvexHalfEdgeMesh() {
 		m_visibleFaces.clear();
@@ -100,8 +295,14 @@ namespace quickhull {
 			}
 		}
 
+		m_iteration = 0;
+		processFaceList();
+	}
+
+	template<typename T>
+	void QuickHull<T>::processFaceList() {
 		// Process faces until the face list is empty.
-		size_t iter = 0;
+		size_t iter = m_iteration;
 		while (!m_faceList.empty()) {
 			iter++;
 			if (iter == std::numeric_limits<size_t>::max()) {
@@ -248,7 +449,7 @@ namespace quickhull {
 
 				auto& newFace = m_mesh.m_faces[newFaceIndex];
 
-				const Vector3<T> planeNormal = mathutils::getTriangleNormal(m_vertexData[A],m_vertexData[B],activePoint);
+				const Vector3<T> planeNormal = mathutils::getTriangleNormal(getMeshVertex(A),getMeshVertex(B),activePoint);
 				newFace.m_P = Plane<T>(planeNormal,activePoint);
 				newFace.m_he = AB;
 
@@ -256,22 +457,23 @@ namespace quickhull {
 				m_mesh.m_halfEdges[BC].m_opp = m_newHalfEdgeIndices[((i+1)*2) % (horizonEdgeCount*2)];
 			}
 
-			// Assign points that were on the positive side of the disabled faces to the new faces.
+			// Assign points that were on the positive side of the disabled faces to the new faces. They are gathered so that
+			// the candidate planes are set up once and large sets can be classified on several threads.
+			size_t reassignedPointCount = 0;
+			for (const auto& disabledPoints : m_disabledFacePointVectors) {
+				reassignedPointCount += disabledPoints->size();
+			}
+			m_reassignedPoints.clear();
+			m_reassignedPoints.reserve(reassignedPointCount);
 			for (auto& disabledPoints : m_disabledFacePointVectors) {
 				assert(disabledPoints);
-				for (const auto& point : *(disabledPoints)) {
-					if (point == activePointIndex) {
-						continue;
-					}
-					for (size_t j=0;j<horizonEdgeCount;j++) {
-						if (addPointToFace(m_mesh.m_faces[m_newFaceIndices[j]], point)) {
-							break;
-						}
-					}
-				}
+				m_reassignedPoints.insert(m_reassignedPoints.end(), disabledPoints->begin(), disabledPoints->end());
 				// The points are no longer needed: we can move them to the vector pool for reuse.
 				reclaimToIndexVectorPool(disabledPoints);
 			}
+			m_disabledFacePointVectors.clear();
+			const size_t* reassignedPoints = m_reassignedPoints.data();
+			assignPointsToFaces(m_reassignedPoints.size(), [reassignedPoints](size_t i) { return reassignedPoints[i]; }, m_newFaceIndices.data(), horizonEdgeCount, activePointIndex);
 
 			// Increase face stack size if needed
 			for (const auto newFaceIndex : m_newFaceIndices) {
@@ -286,47 +488,155 @@ namespace quickhull {
 			}
 		}
 		
+		m_iteration = iter;
+		
 		// Cleanup
-		m_indexVectorPool.clear();
+		if (!m_keepBuffers) {
+			m_indexVectorPool.clear();
+			std::vector<std::uint32_t>().swap(m_pointFaceSlot);
+			std::vector<ClassificationResult<T>>().swap(m_classificationResults);
+			std::vector<size_t>().swap(m_reassignedPoints);
+		}
 	}
 	
 	/*
 	 * Private helper functions
 	 */
 
-	template <typename T>
-	std::array<size_t,6> QuickHull<T>::getExtremeValues() {
-		std::array<size_t,6> outIndices{0,0,0,0,0,0};
-		T extremeVals[6] = {m_vertexData[0].x,m_vertexData[0].x,m_vertexData[0].y,m_vertexData[0].y,m_vertexData[0].z,m_vertexData[0].z};
-		const size_t vCount = m_vertexData.size();
-		for (size_t i=1;i<vCount;i++) {
-			const Vector3<T>& pos = m_vertexData[i];
-			if (pos.x>extremeVals[0]) {
-				extremeVals[0]=pos.x;
-				outIndices[0]=i;
-			}
-			else if (pos.x<extremeVals[1]) {
-				extremeVals[1]=pos.x;
-				outIndices[1]=i;
+	template<typename T>
+	size_t QuickHull<T>::getBlockCount(size_t count) const {
+		if (m_threadCount <= 1 || count < ParallelMinPoints) {
+			return 1;
+		}
+		return (count + ParallelBlockSize - 1) / ParallelBlockSize;
+	}
+
+	template<typename T>
+	template<typename F>
+	void QuickHull<T>::forEachBlock(size_t count, F f) {
+		const size_t blockCount = getBlockCount(count);
+		if (blockCount == 1) {
+			f(0, 0, count);
+			return;
+		}
+#pragma omp parallel for schedule(dynamic, 1) num_threads(static_cast<int>(m_threadCount))
+		for (std::ptrdiff_t b = 0; b < static_cast<std::ptrdiff_t>(blockCount); b++) {
+			const size_t begin = static_cast<size_t>(b)*ParallelBlockSize;
+			f(static_cast<size_t>(b), begin, std::min(begin+ParallelBlockSize, count));
+		}
+	}
+
+	template<typename T>
+	template<typename PointAt>
+	void QuickHull<T>::assignPointsToFaces(size_t pointCount, PointAt pointAt, const size_t* faceIndices, size_t faceCount, size_t skipPoint) {
+		if (getBlockCount(pointCount) == 1 && !(VectorizedClassificationAvailable && m_vectorizedClassification && std::is_same<T,float>::value)) {
+			// Without the packet kernel, a single pass over the points is the fastest on one thread
+			for (size_t i=0;i<pointCount;i++) {
+				const size_t point = pointAt(i);
+				if (point == skipPoint) {
+					continue;
+				}
+				for (size_t j=0;j<faceCount;j++) {
+					if (addPointToFace(m_mesh.m_faces[faceIndices[j]], point)) {
+						break;
+					}
+				}
 			}
-			if (pos.y>extremeVals[2]) {
-				extremeVals[2]=pos.y;
-				outIndices[2]=i;
+			return;
+		}
+		m_classificationPlanes.resize(faceCount);
+		for (size_t j=0;j<faceCount;j++) {
+			const Plane<T>& P = m_mesh.m_faces[faceIndices[j]].m_P;
+			m_classificationPlanes[j] = {P.m_N, P.m_D, m_epsilonSquared*P.m_sqrNLength};
+		}
+		// Points assigned on the calling thread go through m_pointFaceSlot in blocks, which keeps the buffer small
+		const size_t chunkSize = getBlockCount(pointCount) == 1 ? ParallelBlockSize : pointCount;
+		for (size_t chunkBegin=0;chunkBegin<pointCount;chunkBegin+=chunkSize) {
+			const size_t count = std::min(chunkSize, pointCount-chunkBegin);
+			const auto chunkPointAt = [&pointAt, chunkBegin](size_t i) { return pointAt(chunkBegin+i); };
+			const size_t blockCount = getBlockCount(count);
+			m_pointFaceSlot.resize(count);
+			m_classificationResults.assign(blockCount*faceCount, ClassificationResult<T>());
+			forEachBlock(count, [&](size_t block, size_t begin, size_t end) {
+				classifyPoints(m_vertexData, chunkPointAt, begin, end, skipPoint, m_classificationPlanes.data(), faceCount,
+							   m_pointFaceSlot.data(), &m_classificationResults[block*faceCount], m_vectorizedClassification);
+			});
+			// Adding in point order keeps the point lists of the serial assignment, and merging the blocks in order keeps its
+			// most distant points (first of equals)
+			for (size_t i=0;i<count;i++) {
+				if (m_pointFaceSlot[i] != NoFace) {
+					auto& f = m_mesh.m_faces[faceIndices[m_pointFaceSlot[i]]];
+					if (!f.m_pointsOnPositiveSide) {
+						f.m_pointsOnPositiveSide = std::move(getIndexVectorFromPool());
+					}
+					f.m_pointsOnPositiveSide->push_back(chunkPointAt(i));
+				}
 			}
-			else if (pos.y<extremeVals[3]) {
-				extremeVals[3]=pos.y;
-				outIndices[3]=i;
+			for (size_t block=0;block<blockCount;block++) {
+				for (size_t j=0;j<faceCount;j++) {
+					const auto& result = m_classificationResults[block*faceCount+j];
+					auto& f = m_mesh.m_faces[faceIndices[j]];
+					if (result.m_count && result.m_mostDistantDist > f.m_mostDistantPointDist) {
+						f.m_mostDistantPointDist = result.m_mostDistantDist;
+						f.m_mostDistantPoint = chunkPointAt(result.m_mostDistantPosition);
+					}
+				}
 			}
-			if (pos.z>extremeVals[4]) {
-				extremeVals[4]=pos.z;
-				outIndices[4]=i;
+		}
+	}
+
+	template <typename T>
+	std::array<size_t,6> QuickHull<T>::getExtremeValues() {
+		// Extremes of each block, merged in block order so that ties go to the lowest index like in a single scan
+		struct Extremes {
+			T vals[6];
+			std::array<size_t,6> indices;
+		};
+		const Vector3<T>& first = m_vertexData[0];
+		const size_t vCount = m_vertexData.size();
+		std::vector<Extremes> blocks(getBlockCount(vCount), Extremes{{first.x,first.x,first.y,first.y,first.z,first.z},{0,0,0,0,0,0}});
+		forEachBlock(vCount, [&](size_t block, size_t begin, size_t end) {
+			T* extremeVals = blocks[block].vals;
+			std::array<size_t,6>& outIndices = blocks[block].indices;
+			for (size_t i=std::max<size_t>(begin,1);i<end;i++) {
+				const Vector3<T>& pos = m_vertexData[i];
+				if (pos.x>extremeVals[0]) {
+					extremeVals[0]=pos.x;
+					outIndices[0]=i;
+				}
+				else if (pos.x<extremeVals[1]) {
+					extremeVals[1]=pos.x;
+					outIndices[1]=i;
+				}
+				if (pos.y>extremeVals[2]) {
+					extremeVals[2]=pos.y;
+					outIndices[2]=i;
+				}
+				else if (pos.y<extremeVals[3]) {
+					extremeVals[3]=pos.y;
+					outIndices[3]=i;
+				}
+				if (pos.z>extremeVals[4]) {
+					extremeVals[4]=pos.z;
+					outIndices[4]=i;
+				}
+				else if (pos.z<extremeVals[5]) {
+					extremeVals[5]=pos.z;
+					outIndices[5]=i;
+				}
 			}
-			else if (pos.z<extremeVals[5]) {
-				extremeVals[5]=pos.z;
-				outIndices[5]=i;
+		});
+		Extremes result = blocks[0];
+		for (size_t b=1;b<blocks.size();b++) {
+			for (size_t i=0;i<6;i++) {
+				const T v = blocks[b].vals[i];
+				if ((i%2==0) ? v>result.vals[i] : v<result.vals[i]) {
+					result.vals[i] = v;
+					result.indices[i] = blocks[b].indices[i];
+				}
 			}
 		}
-		return outIndices;
+		return result.indices;
 	}
 
 	template<typename T>
@@ -400,14 +710,23 @@ namespace quickhull {
 		
 		// Find the most distant point to the line between the two chosen extreme points.
 		const Ray<T> r(m_vertexData[selectedPoints.first], (m_vertexData[selectedPoints.second] - m_vertexData[selectedPoints.first]));
+		const size_t vCount = m_vertexData.size();
+		std::vector<std::pair<T,size_t>> blockMax(getBlockCount(vCount), {m_epsilonSquared,std::numeric_limits<size_t>::max()});
+		forEachBlock(vCount, [&](size_t block, size_t begin, size_t end) {
+			auto& bm = blockMax[block];
+			for (size_t i=begin;i<end;i++) {
+				const T distToRay = mathutils::getSquaredDistanceBetweenPointAndRay(m_vertexData[i],r);
+				if (distToRay > bm.first) {
+					bm = {distToRay,i};
+				}
+			}
+		});
 		maxD = m_epsilonSquared;
 		size_t maxI=std::numeric_limits<size_t>::max();
-		const size_t vCount = m_vertexData.size();
-		for (size_t i=0;i<vCount;i++) {
-			const T distToRay = mathutils::getSquaredDistanceBetweenPointAndRay(m_vertexData[i],r);
-			if (distToRay > maxD) {
-				maxD=distToRay;
-				maxI=i;
+		for (const auto& bm : blockMax) {
+			if (bm.first > maxD) {
+				maxD=bm.first;
+				maxI=bm.second;
 			}
 		}
 		if (maxD == m_epsilonSquared) {
@@ -434,28 +753,27 @@ namespace quickhull {
 		maxI=0;
 		const Vector3<T> N = mathutils::getTriangleNormal(baseTriangleVertices[0],baseTriangleVertices[1],baseTriangleVertices[2]);
 		Plane<T> trianglePlane(N,baseTriangleVertices[0]);
-		for (size_t i=0;i<vCount;i++) {
-			const T d = std::abs(mathutils::getSignedDistanceToPlane(m_vertexData[i],trianglePlane));
-			if (d>maxD) {
-				maxD=d;
-				maxI=i;
+		blockMax.assign(getBlockCount(vCount), {m_epsilon,0});
+		forEachBlock(vCount, [&](size_t block, size_t begin, size_t end) {
+			findMostDistantPoint(m_vertexData, begin, end, trianglePlane, blockMax[block], m_vectorizedClassification);
+		});
+		for (const auto& bm : blockMax) {
+			if (bm.first > maxD) {
+				maxD=bm.first;
+				maxI=bm.second;
 			}
 		}
 		if (maxD == m_epsilon) {
 			// All the points seem to lie on a 2D subspace of R^3. How to handle this? Well, let's add one extra point to the point cloud so that the convex hull will have volume.
 			m_planar = true;
 			const vec3 N = mathutils::getTriangleNormal(baseTriangleVertices[1],baseTriangleVertices[2],baseTriangleVertices[0]);
-			m_planarPointCloudTemp.clear();
-			m_planarPointCloudTemp.insert(m_planarPointCloudTemp.begin(),m_vertexData.begin(),m_vertexData.end());
-			const vec3 extraPoint = N + m_vertexData[0];
-			m_planarPointCloudTemp.push_back(extraPoint);
-			maxI = m_planarPointCloudTemp.size()-1;
-			m_vertexData = VertexDataSource<T>(m_planarPointCloudTemp);
+			m_planarExtraPoint = N + m_vertexData[0];
+			maxI = vCount;
 		}
 
 		// Enforce CCW orientation (if user prefers clockwise orientation, swap two vertices in each triangle when final mesh is created)
 		const Plane<T> triPlane(N,baseTriangleVertices[0]);
-		if (triPlane.isPointOnPositiveSide(m_vertexData[maxI])) {
+		if (triPlane.isPointOnPositiveSide(getMeshVertex(maxI))) {
 			std::swap(baseTriangle[0],baseTriangle[1]);
 		}
 
@@ -463,22 +781,18 @@ namespace quickhull {
 		m_mesh.setup(baseTriangle[0],baseTriangle[1],baseTriangle[2],maxI);
 		for (auto& f : m_mesh.m_faces) {
 			auto v = m_mesh.getVertexIndicesOfFace(f);
-			const Vector3<T>& va = m_vertexData[v[0]];
-			const Vector3<T>& vb = m_vertexData[v[1]];
-			const Vector3<T>& vc = m_vertexData[v[2]];
+			const Vector3<T>& va = getMeshVertex(v[0]);
+			const Vector3<T>& vb = getMeshVertex(v[1]);
+			const Vector3<T>& vc = getMeshVertex(v[2]);
 			const Vector3<T> N = mathutils::getTriangleNormal(va, vb, vc);
 			const Plane<T> trianglePlane(N,va);
 			f.m_P = trianglePlane;
 		}
 
 		// Finally we assign a face for each vertex outside the tetrahedron (vertices inside the tetrahedron have no role anymore)
-		for (size_t i=0;i<vCount;i++) {
-			for (auto& face : m_mesh.m_faces) {
-				if (addPointToFace(face, i)) {
-					break;
-				}
-			}
-		}
+		const size_t faceIndices[4] = {0,1,2,3};
+		assignPointsToFaces(vCount, [](size_t i) { return i; }, faceIndices, 4, std::numeric_limits<size_t>::max());
+		m_hasVolume = !m_planar;
 	}
 	
 	/*
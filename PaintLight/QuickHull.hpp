@@ -4,13 +4,16 @@
 #include <vector>
 #include <array>
 #include <limits>
+#include <cstdint>
 #include "Structs/Vector3.hpp"
 #include "Structs/Plane.hpp"
 #include "Structs/Pool.hpp"
 #include "Structs/Mesh.hpp"
 #include "ConvexHull.hpp"
+#include "PackedConvexHull.hpp"
 #include "HalfEdgeMesh.hpp"
 #include "MathUtils.hpp"
+#include "PlaneKernels.hpp"
 
 /*
  * Implementation of the 3D QuickHull algorithm by Antti Kuukka
@@ -27,6 +30,10 @@
  *
  * The implementation is thread-safe if each thread is using its own QuickHull object.
  *
+ * With setThreadCount, the scans for the initial tetrahedron and the assignment of points to new faces run on several threads
+ * (OpenMP). Each thread classifies a block of points and the blocks are merged back in point order, so the hull, including the
+ * order of its faces and vertices, is the same as with one thread.
+ *
  *
  * SUMMARY OF THE ALGORITHM:
  *         - Create initial simplex (tetrahedron) using extreme points. We have four faces now and they form a convex mesh M.
@@ -79,7 +86,7 @@ namespace quickhull {
 
 		FloatType m_epsilon, m_epsilonSquared, m_scale;
 		bool m_planar;
-		std::vector<vec3> m_planarPointCloudTemp;
+		vec3 m_planarExtraPoint; // apex added to a planar point cloud so that the hull has volume, vertex index m_vertexData.size()
 		VertexDataSource<FloatType> m_vertexData;
 		MeshBuilder<FloatType> m_mesh;
 		std::array<size_t,6> m_extremeValues;
@@ -99,6 +106,42 @@ namespace quickhull {
 		std::vector<FaceData> m_possiblyVisibleFaces;
 		std::deque<size_t> m_faceList;
 
+		// Point assignment. Points are classified into m_pointFaceSlot (index into the candidate faces, NoFace if none) by the
+		// PlaneKernels.hpp kernels, on m_threadCount threads when there are enough of them, then added to the faces in point order.
+		// Without the packet kernel, points assigned on the calling thread go through addPointToFace one by one instead.
+		static constexpr std::uint32_t NoFace = std::numeric_limits<std::uint32_t>::max();
+		static constexpr size_t ParallelBlockSize = 4096; // points per task
+		static constexpr size_t ParallelMinPoints = 32768; // fewer points are assigned on the calling thread
+		size_t m_threadCount = 1;
+		bool m_vectorizedClassification = true;
+		bool m_keepBuffers = false; // see setKeepBuffers
+		std::vector<std::uint32_t> m_pointFaceSlot;
+		std::vector<ClassificationPlane<FloatType>> m_classificationPlanes;
+		std::vector<ClassificationResult<FloatType>> m_classificationResults; // per block and candidate face
+		std::vector<size_t> m_reassignedPoints;
+
+		// Incremental construction (beginIncremental). m_vertexData refers to m_incrementalPoints, which holds the vertices of
+		// the hull once the points span a volume, and every point added until then.
+		static constexpr size_t IncrementalFlatPointLimit = 4096; // kept points without volume that are reduced to their hull
+		bool m_incremental = false;
+		bool m_hasVolume = false; // setupInitialTetrahedron found four points spanning a volume and set up the face planes
+		FloatType m_incrementalEpsilon;
+		std::vector<vec3> m_incrementalPoints;
+		size_t m_incrementalPointCount; // points added since beginIncremental
+		size_t m_iteration; // visible face traversals, counted on across addPoints calls
+		
+		// Number of blocks forEachBlock splits count points into, 1 if they are processed on the calling thread.
+		size_t getBlockCount(size_t count) const;
+		
+		// Calls f(block, begin, end) for consecutive blocks of [0, count), on several threads if the count is large enough.
+		template<typename F>
+		void forEachBlock(size_t count, F f);
+		
+		// Assigns point pointAt(i) for i in [0, pointCount) to the first of the given faces that has it on its positive side,
+		// skipping skipPoint. Gives the same face point lists, in the same order, as calling addPointToFace point by point.
+		template<typename PointAt>
+		void assignPointsToFaces(size_t pointCount, PointAt pointAt, const size_t* faceIndices, size_t faceCount, size_t skipPoint);
+
 		// Create a half edge mesh representing the base tetrahedron from which the QuickHull iteration proceeds. m_extremeValues must be properly set up when this is called.
 		void setupInitialTetrahedron();
 
@@ -125,12 +168,39 @@ namespace quickhull {
 		// This will update m_mesh from which we create the ConvexHull object that getConvexHull function returns
 		void createConvexHalfEdgeMesh();
 		
+		// Extrudes the faces of m_faceList to their most distant points until no face has points on its positive side
+		void processFaceList();
+		
+		// Removes the points that are not vertices of the mesh from m_incrementalPoints
+		void compactIncrementalPoints();
+		
 		// Constructs the convex hull into a MeshBuilder object which can be converted to a ConvexHull or Mesh object
 		void buildMesh(const VertexDataSource<FloatType>& pointCloud, bool CCW, bool useOriginalIndices, FloatType eps);
 		
-		// The public getConvexHull functions will setup a VertexDataSource object and call this
-		ConvexHull<FloatType> getConvexHull(const VertexDataSource<FloatType>& pointCloud, bool CCW, bool useOriginalIndices, FloatType eps);
+		// Vertex of the mesh: a point of m_vertexData or the apex added to a planar point cloud
+		const vec3& getMeshVertex(size_t index) const {
+			return index == m_vertexData.size() ? m_planarExtraPoint : m_vertexData[index];
+		}
 	public:
+		// Computes convex hull for a given point cloud, which can be a strided view (e.g. the RGB of interleaved RGBA pixels)
+		// and is not copied. The other getConvexHull functions set up a VertexDataSource object and call this.
+		// Params:
+		//   pointCloud: the points, indexed like the vertex buffer when useOriginalIndices is true
+		//   CCW: whether the output mesh triangles should have CCW orientation
+		//   useOriginalIndices: should the output mesh use same vertex indices as the original point cloud. If this is false,
+		//      then we generate a new vertex buffer which contains only the vertices that are part of the convex hull.
+		//   eps: minimum distance to a plane to consider a point being on positive side of it (for a point cloud with scale 1)
+		ConvexHull<FloatType> getConvexHull(const VertexDataSource<FloatType>& pointCloud,
+											bool CCW,
+											bool useOriginalIndices,
+											FloatType eps = defaultEps<FloatType>::value);
+		
+		// Computes the convex hull like getConvexHull(pointCloud, CCW, false, eps) and returns it laid out for queries, with
+		// the face planes, edge vectors and adjacency of the half edge mesh
+		PackedConvexHull<FloatType> getPackedConvexHull(const VertexDataSource<FloatType>& pointCloud,
+														bool CCW,
+														FloatType eps = defaultEps<FloatType>::value);
+		
 		// Computes convex hull for a given point cloud.
 		// Params:
 		//   pointCloud: a vector of of 3D points
@@ -186,10 +256,80 @@ namespace quickhull {
 															bool CCW,
 															FloatType eps = defaultEps<FloatType>::value);
 		
+		// Number of threads for the point assignment, 0 for every core (1 if OpenMP is not enabled). The hull does not depend on it.
+		void setThreadCount(size_t threads);
+		size_t getThreadCount() const {
+			return m_threadCount;
+		}
+		
+		// Whether float point clouds are classified eight points at a time (the default, in AVX2 builds) or with the scalar
+		// reference loop. Both give the same hull.
+		void setVectorizedClassification(bool enabled) {
+			m_vectorizedClassification = enabled;
+		}
+		bool getVectorizedClassification() const {
+			return m_vectorizedClassification;
+		}
+		
+		// Whether the point assignment buffers and the pooled point lists stay allocated for the next hull instead of being
+		// freed when a hull is done, for an object that builds many hulls (see HullBatch). Off by default.
+		void setKeepBuffers(bool enabled) {
+			m_keepBuffers = enabled;
+		}
+		bool getKeepBuffers() const {
+			return m_keepBuffers;
+		}
+		
+		// Incremental construction, for point clouds that arrive in batches (e.g. one decoded band of rows at a time).
+		// beginIncremental starts an empty hull and addPoints extends the mesh in place with a batch: the points inside the
+		// polytope of the extreme hull vertices (see InteriorPointFilter) are dropped, the others are assigned to the faces
+		// they are in front of and extruded to like in getConvexHull. The mesh only grows, so every point added stays within
+		// the tolerance of the hull like with getConvexHull, but a point inside the hull is tested against every face, which
+		// makes batches slow on hulls with very many faces. Afterwards only the vertices of the hull are kept, so the memory
+		// is bounded by the hull and the largest batch. Until the points span a volume they are kept (reduced to their flat
+		// hull when there are many) and the mesh is rebuilt from them on each call.
+		//
+		// The triangulation and the vertices picked among points within the tolerance of the hull depend on the batches.
+		// getConvexHull and getConvexHullAsMesh end the incremental construction.
+		void beginIncremental(FloatType eps = defaultEps<FloatType>::value);
+		// Starts the incremental construction from the mesh of the last getConvexHull, getPackedConvexHull or
+		// getConvexHullAsMesh call instead of an empty hull, eps being the tolerance it was built with. Its vertices are
+		// copied, the point cloud it was built from is not needed afterwards.
+		void continueIncremental(FloatType eps = defaultEps<FloatType>::value);
+		void addPoints(const Vector3<FloatType>* points, size_t count);
+		void addPoints(const std::vector<Vector3<FloatType>>& points) {
+			addPoints(points.data(), points.size());
+		}
+		
+		// Hull of the points added since beginIncremental. The vertex buffer is a copy, the hull stays valid after more
+		// points are added.
+		ConvexHull<FloatType> getIncrementalHull(bool CCW) const;
+		
+		// Points added since beginIncremental (or built into the hull continueIncremental started from), and how many of
+		// them are kept
+		size_t getIncrementalPointCount() const {
+			return m_incrementalPointCount;
+		}
+		size_t getKeptPointCount() const {
+			return m_incrementalPoints.size();
+		}
+		
 		// Get diagnostics about last generated convex hull
 		const DiagnosticsData& getDiagnostics() {
 			return m_diagnostics;
 		}
+
+		// Get the planes of the faces of last generated convex hull. Normals point outwards and are not normalized.
+		std::vector<Plane<FloatType>> getFacePlanes() const {
+			std::vector<Plane<FloatType>> planes;
+			planes.reserve(m_mesh.m_faces.size() - m_mesh.m_disabledFaces.size());
+			for (const auto& f : m_mesh.m_faces) {
+				if (!f.isDisabled()) {
+					planes.push_back(f.m_P);
+				}
+			}
+			return planes;
+		}
 	};
 	
 	/*
@@ -1,9 +1,15 @@
 #pragma once
 
 #include <stdexcept>
+#include <new>
+#include <algorithm>
 
 #include "DXUT.h"
 #include "d3d11helper.h"
+#include "ImageView.h"
+#include "PixelFormat.h"
+#include "FormatImage.h"
+#include "ImageDecoder.h"
 
 //#define cimg_use_cpp11
 //#define cimg_use_opencv
@@ -11,43 +17,105 @@
 #include <atlbase.h>
 #include <wincodec.h>
 
-class RGBAImage // FP32 from 0.0f to 255.0f, RGBARGBARGBA...
+class RGBAImage // FP32 from 0.0f to 255.0f, RGBARGBARGBA... unless set up planar
 {
-	//TODO: maybe add alignment?
 public:
-	float *data;
+	float *data; // ImageAlignment aligned
 	std::uint32_t width, height;
+	std::size_t pitch; // floats from one row to the next, width * 4 (no padding) unless set up otherwise
+	std::size_t plane_pitch; // floats from one plane to the next, planar only
+	PixelLayout layout;
 public:
 	std::tuple<std::uint32_t, std::uint32_t> GetSize() { return { width,height }; }
 	float *GetRawData() { return data; }
+	ImageView GetView() const { return ImageView(data, width, height, pitch, plane_pitch, layout); }
+	ImageView GetView(std::uint32_t row, std::uint32_t column, std::uint32_t rows, std::uint32_t columns) const { return GetView().SubView(row, column, rows, columns); }
+	float *Row(std::uint32_t i, std::uint32_t channel = 0) const { return data + channel * plane_pitch + i * pitch; }
+	// the whole image is one array of width * height RGBA pixels, as GetRawData users expect
+	bool IsPacked() const { return GetView().IsPacked(); }
+
+	// smallest pitch whose rows start on ImageAlignment bytes
+	static std::size_t AlignedPitch(std::uint32_t width, PixelLayout layout = PixelLayout::Interleaved)
+	{
+		std::size_t const floats(ImageAlignment / sizeof(float));
+		return (width * SamplesPerPixel(layout) + floats - 1) / floats * floats;
+	}
 public:
-	void Setup(std::uint32_t width, std::uint32_t height)
+	// pitch: floats from one row to the next, 0 for rows without padding (AlignedPitch for aligned rows)
+	void Setup(std::uint32_t width, std::uint32_t height, PixelLayout layout = PixelLayout::Interleaved, std::size_t pitch = 0)
 	{
-		float *new_data(new float[height * width * 4]{ 255.0f });
+		std::size_t const row_pitch(std::max<std::size_t>(pitch, width * SamplesPerPixel(layout)));
+		std::size_t const floats(ImageAlignment / sizeof(float));
+		std::size_t const new_plane_pitch(layout == PixelLayout::Planar ? (row_pitch * height + floats - 1) / floats * floats : 0);
+		std::size_t const count(layout == PixelLayout::Planar ? new_plane_pitch * PlaneCount(layout) : row_pitch * height);
+		float *new_data(Allocate(count));
+		std::fill_n(new_data, count, 0.0f);
 		Release();
 		this->width = width;
 		this->height = height;
+		this->pitch = row_pitch;
+		this->plane_pitch = new_plane_pitch;
+		this->layout = layout;
 		this->data = new_data;
 	}
 	std::tuple<float, float, float> At(std::uint32_t i, std::uint32_t j)
 	{
-		float *pos(data + (i * width + j) * 4);
-		return { pos[0], pos[1], pos[2] };
+		if (layout == PixelLayout::Interleaved)
+		{
+			float *pos(data + i * pitch + j * 4);
+			return { pos[0], pos[1], pos[2] };
+		}
+		return GetView().At(i, j);
 	}
 	void Set(std::uint32_t i, std::uint32_t j, float r2, float g2, float b2)
 	{
-		float *pos(data + (i * width + j) * 4);
-		pos[0] = r2;
-		pos[1] = g2;
-		pos[2] = b2;
+		if (layout == PixelLayout::Interleaved)
+		{
+			float *pos(data + i * pitch + j * 4);
+			pos[0] = r2;
+			pos[1] = g2;
+			pos[2] = b2;
+			return;
+		}
+		GetView().Set(i, j, r2, g2, b2);
+	}
+	// same pixels in another layout and pitch
+	RGBAImage Convert(PixelLayout new_layout, std::size_t new_pitch = 0) const
+	{
+		RGBAImage ret;
+		ret.Setup(width, height, new_layout, new_pitch);
+		GetView().CopyTo(ret.GetView());
+		return ret;
+	}
+private:
+	std::size_t GetAllocationSize() const
+	{
+		return layout == PixelLayout::Planar ? plane_pitch * PlaneCount(layout) : pitch * height;
+	}
+	static float *Allocate(std::size_t count)
+	{
+		return static_cast<float *>(::operator new[](count * sizeof(float), std::align_val_t(ImageAlignment)));
+	}
+	static void Deallocate(float *p) noexcept
+	{
+		::operator delete[](p, std::align_val_t(ImageAlignment));
 	}
 public:
-	RGBAImage() :data(nullptr), width(0), height(0)
+	RGBAImage() :data(nullptr), width(0), height(0), pitch(0), plane_pitch(0), layout(PixelLayout::Interleaved)
 	{
 
 	}
-	RGBAImage(LPCWSTR filename) :data(nullptr), width(0), height(0)
+	// PNG, PPM/PGM and PFM go through ImageDecoder (PNG only with libpng), everything else through WIC
+	// alpha is always 255, the file's alpha is dropped as the 24bpp WIC decode always did
+	RGBAImage(LPCWSTR filename) :data(nullptr), width(0), height(0), pitch(0), plane_pitch(0), layout(PixelLayout::Interleaved)
 	{
+		if (ImageDecoder::Supports(filename))
+		{
+			ImageDecoder decoder(filename);
+			Setup(decoder.width, decoder.height);
+			decoder.Decode(GetView());
+			return;
+		}
 		//CoInitialize(nullptr);
 		{
 			CComPtr<IWICImagingFactory> pFactory;
@@ -68,7 +136,8 @@ public:
 			pDecoder->GetFrame(0, &pFrame);
 			// The zero-based index should be smaller than the frame count.
 
-			pFrame->GetSize(&width, &height);
+			UINT frame_width(0), frame_height(0);
+			pFrame->GetSize(&frame_width, &frame_height);
 
 			WICPixelFormatGUID pixelFormatGUID;
 			pFrame->GetPixelFormat(&pixelFormatGUID);
@@ -81,37 +150,33 @@ public:
 			// The disadvantage of this solution is that you have to deal with all possible pixel formats.
 
 			// You can make your life easy by converting the frame to a pixel format of
-			// your choice. The code below shows how to convert the pixel format to 24-bit RGB.
+			// your choice. The code below shows how to convert the pixel format to 32-bit RGBA.
 
 			pFactory->CreateFormatConverter(&pFormatConverter);
 
 			pFormatConverter->Initialize(pFrame,                       // Input bitmap to convert
-				GUID_WICPixelFormat24bppRGB,  // Destination pixel format
+				GUID_WICPixelFormat32bppRGBA, // Destination pixel format
 				WICBitmapDitherTypeNone,      // Specified dither pattern
 				nullptr,                      // Specify a particular palette
 				0.f,                          // Alpha threshold
 				WICBitmapPaletteTypeCustom); // Palette translation type
 
-			UINT bytesPerPixel = 3; // Because we have converted the frame to 24-bit RGB
-			UINT stride = width * bytesPerPixel;
-			UINT size = width * height * bytesPerPixel; // The size of the required memory buffer for
-														// holding all the bytes of the frame.
-
-			std::vector<BYTE> bitmap(size); // The buffer to hold all the bytes of the frame.
-			pFormatConverter->CopyPixels(NULL, stride, size, bitmap.data());
+			UINT bytesPerPixel = 4; // Because we have converted the frame to 32-bit RGBA
+			UINT stride = frame_width * bytesPerPixel;
 
-			// Note: the WIC COM pointers should be released before 'CoUninitialize( )' is called.
-			data = new float[width * height * 4];
-
-			float *dst(data);
-			BYTE const *src = bitmap.data();
-			for (std::size_t i(0); i < width * height; ++i, src += 3, dst += 4)
+			// one row at a time, converted to floats straight into the image
+			std::vector<BYTE> row(stride);
+			Setup(frame_width, frame_height);
+			for (std::uint32_t y(0); y < height; ++y)
 			{
-				dst[0] = static_cast<float>(src[0]);
-				dst[1] = static_cast<float>(src[1]);
-				dst[2] = static_cast<float>(src[2]);
-				dst[3] = 255.0f;
+				WICRect const rect{ 0, static_cast<INT>(y), static_cast<INT>(frame_width), 1 };
+				pFormatConverter->CopyPixels(&rect, stride, stride, row.data());
+				for (UINT x(3); x < stride; x += 4)
+					row[x] = 255;
+				DecodeSamples<PixelFormat::UNorm8>(row.data(), Row(y), std::size_t(width) * 4, 255.0f);
 			}
+
+			// Note: the WIC COM pointers should be released before 'CoUninitialize( )' is called.
 		}
 		//CoUninitialize();
 	}
@@ -119,10 +184,12 @@ public:
 	{
 		try {
 			if (data) {
-				delete[] data;
+				Deallocate(data);
 				data = nullptr;
 			}
 			width = height = 0;
+			pitch = plane_pitch = 0;
+			layout = PixelLayout::Interleaved;
 		}
 		catch (...) {}
 	}
@@ -131,31 +198,40 @@ public:
 		Release();
 	}
 
-	RGBAImage(RGBAImage const &other) :data(nullptr), width(other.width), height(other.height)
+	RGBAImage(RGBAImage const &other) :data(nullptr), width(other.width), height(other.height), pitch(other.pitch), plane_pitch(other.plane_pitch), layout(other.layout)
 	{
-		data = new float[width * height * 4];
-		std::uninitialized_copy_n(other.data, width * height * 4, data);
+		if (other.data)
+		{
+			data = Allocate(other.GetAllocationSize());
+			std::uninitialized_copy_n(other.data, other.GetAllocationSize(), data);
+		}
 	}
 
 	RGBAImage &operator=(RGBAImage const &other)
 	{
 		if (std::addressof(other) != this)
 		{
-			float *new_data(new float[other.height * other.width * 4]);
-			std::uninitialized_copy_n(other.data, other.width * other.height * 4, new_data);
+			float *new_data(other.data ? Allocate(other.GetAllocationSize()) : nullptr);
+			if (new_data)
+				std::uninitialized_copy_n(other.data, other.GetAllocationSize(), new_data);
 			Release();
 			data = new_data;
-			width = other.height;
+			width = other.width;
 			height = other.height;
+			pitch = other.pitch;
+			plane_pitch = other.plane_pitch;
+			layout = other.layout;
 		}
 		return *this;
 	}
 
-	RGBAImage(RGBAImage &&other) noexcept :data(other.data), width(other.width), height(other.height)
+	RGBAImage(RGBAImage &&other) noexcept :data(other.data), width(other.width), height(other.height), pitch(other.pitch), plane_pitch(other.plane_pitch), layout(other.layout)
 	{
 		other.data = nullptr;
 		other.width = 0;
 		other.height = 0;
+		other.pitch = other.plane_pitch = 0;
+		other.layout = PixelLayout::Interleaved;
 	}
 
 	RGBAImage &operator=(RGBAImage &&other) noexcept
@@ -166,10 +242,15 @@ public:
 			data = other.data;
 			width = other.width;
 			height = other.height;
+			pitch = other.pitch;
+			plane_pitch = other.plane_pitch;
+			layout = other.layout;
 
 			other.data = nullptr;
 			other.width = 0;
 			other.height = 0;
+			other.pitch = other.plane_pitch = 0;
+			other.layout = PixelLayout::Interleaved;
 		}
 		return *this;
 	}
@@ -192,7 +273,8 @@ public:
 	{
 
 	}
-	RGBAImageGPU(RGBAImage const &img, ID3D11Device *device)
+	// format R32G32B32A32_FLOAT or R16G16B16A16_FLOAT, Upload and Download convert FP16 textures
+	RGBAImageGPU(RGBAImage const &img, ID3D11Device *device, DXGI_FORMAT format = DXGI_FORMAT_R32G32B32A32_FLOAT)
 	{
 		width = img.width;
 		height = img.height;
@@ -203,7 +285,7 @@ public:
 		textureDesc.Height = height;
 		textureDesc.MipLevels = 1;
 		textureDesc.ArraySize = 1;
-		textureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		textureDesc.Format = format;
 		textureDesc.SampleDesc.Count = 1;
 		textureDesc.Usage = D3D11_USAGE_DEFAULT;
 		textureDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
@@ -349,13 +431,38 @@ public:
 		SAFE_RELEASE(srv);
 		// create SRV
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc{};
-		srvDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		srvDesc.Format = GetFormat();
 		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 		srvDesc.Texture2D.MipLevels = 1;
 		THROW(device->CreateShaderResourceView(tex, std::addressof(srvDesc), std::addressof(srv)));
 	}
+	DXGI_FORMAT GetFormat() const
+	{
+		D3D11_TEXTURE2D_DESC textureDesc{};
+		if (tex)
+			tex->GetDesc(std::addressof(textureDesc));
+		return textureDesc.Format;
+	}
 public:
 	void Upload(RGBAImage const &img, ID3D11Device *device, ID3D11DeviceContext *context)
+	{
+		// the texture is interleaved, planar images are interleaved row by row on the way
+		ImageView const src(img.GetView());
+		UploadRows(device, context, std::min(img.height, height), [&src](std::uint32_t i, float *dst) {
+			ImageView const row(dst, src.width, 1, std::size_t(src.width) * 4, 0, PixelLayout::Interleaved);
+			src.SubView(i, 0, 1, src.width).CopyTo(row);
+		});
+	}
+	// decoded row by row, e.g. a palette kept in a narrow format
+	template<PixelFormat Format>
+	void Upload(FormatImage<Format> const &img, ID3D11Device *device, ID3D11DeviceContext *context)
+	{
+		UploadRows(device, context, std::min(img.height, height), [&img](std::uint32_t i, float *dst) {
+			img.DecodeRow(i, dst);
+		});
+	}
+
+	RGBAImage Download(ID3D11Device *device, ID3D11DeviceContext *context) const
 	{
 		ID3D11Texture2D *texTmp;
 
@@ -365,36 +472,41 @@ public:
 		textureDesc.Height = height;
 		textureDesc.MipLevels = 1;
 		textureDesc.ArraySize = 1;
-		textureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		textureDesc.Format = GetFormat();
 		textureDesc.SampleDesc.Count = 1;
-		textureDesc.Usage = D3D11_USAGE_DYNAMIC;
-		textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-		textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		textureDesc.Usage = D3D11_USAGE_STAGING;
+		textureDesc.BindFlags = 0;
+		textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
 		textureDesc.MiscFlags = 0;
 		THROW(device->CreateTexture2D(&textureDesc, nullptr, std::addressof(texTmp)));
 
-		D3D11_MAPPED_SUBRESOURCE mappedResource;
-
-		THROW(context->Map(texTmp, 0, D3D11_MAP_WRITE_DISCARD, 0, std::addressof(mappedResource)));
+		context->CopyResource(texTmp, tex);
 
-		BYTE const *buffer(static_cast<BYTE const *>(static_cast<void const *>(img.data)));
-		auto rowspan(img.width * 4 * sizeof(float));
+		RGBAImage ret;
+		ret.Setup(width, height);
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		HRESULT hr = context->Map(texTmp, 0, D3D11_MAP_READ, 0, std::addressof(mappedResource));
+		std::size_t rowspan(width * 4 * sizeof(float));
 		BYTE *mappedData = static_cast<BYTE *>(mappedResource.pData);
-		for (std::size_t i(0); i < img.height; ++i)
+		bool const half(textureDesc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT);
+		for (std::uint32_t i(0); i < height; ++i)
 		{
-			memcpy(mappedData, buffer, rowspan);
+			if (half)
+				DecodeSamples<PixelFormat::Float16>(static_cast<std::uint16_t const *>(static_cast<void const *>(mappedData)), ret.Row(i), std::size_t(width) * 4, 1.0f);
+			else
+				memcpy(ret.Row(i), mappedData, rowspan);
 			mappedData += mappedResource.RowPitch;
-			buffer += rowspan;
 		}
-
 		context->Unmap(texTmp, 0);
 
-		context->CopyResource(tex, texTmp);
-
 		texTmp->Release();
-	}
 
-	RGBAImage Download(ID3D11Device *device, ID3D11DeviceContext *context) const
+		return ret;
+	}
+private:
+	// fill_row(i, dst) writes row i of rows as FP32 RGBA, FP16 textures get it encoded
+	template<typename FillRow>
+	void UploadRows(ID3D11Device *device, ID3D11DeviceContext *context, std::uint32_t rows, FillRow fill_row)
 	{
 		ID3D11Texture2D *texTmp;
 
@@ -404,34 +516,40 @@ public:
 		textureDesc.Height = height;
 		textureDesc.MipLevels = 1;
 		textureDesc.ArraySize = 1;
-		textureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		textureDesc.Format = GetFormat();
 		textureDesc.SampleDesc.Count = 1;
-		textureDesc.Usage = D3D11_USAGE_STAGING;
-		textureDesc.BindFlags = 0;
-		textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		textureDesc.Usage = D3D11_USAGE_DYNAMIC;
+		textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 		textureDesc.MiscFlags = 0;
 		THROW(device->CreateTexture2D(&textureDesc, nullptr, std::addressof(texTmp)));
 
-		context->CopyResource(texTmp, tex);
-
-		RGBAImage ret;
-		ret.Setup(width, height);
 		D3D11_MAPPED_SUBRESOURCE mappedResource;
-		HRESULT hr = context->Map(texTmp, 0, D3D11_MAP_READ, 0, std::addressof(mappedResource));
-		std::size_t rowspan(width * 4 * sizeof(float));
+
+		THROW(context->Map(texTmp, 0, D3D11_MAP_WRITE_DISCARD, 0, std::addressof(mappedResource)));
+
+		bool const half(textureDesc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT);
+		std::vector<float> row(half ? std::size_t(width) * 4 : 0);
 		BYTE *mappedData = static_cast<BYTE *>(mappedResource.pData);
-		BYTE *buffer(static_cast<BYTE *>(static_cast<void *>(ret.data)));
-		for (std::size_t i(0); i < height; ++i)
+		for (std::uint32_t i(0); i < rows; ++i)
 		{
-			memcpy(buffer, mappedData, rowspan);
+			if (half)
+			{
+				fill_row(i, row.data());
+				EncodeSamples<PixelFormat::Float16>(row.data(), static_cast<std::uint16_t *>(static_cast<void *>(mappedData)), row.size(), 1.0f);
+			}
+			else
+			{
+				fill_row(i, static_cast<float *>(static_cast<void *>(mappedData)));
+			}
 			mappedData += mappedResource.RowPitch;
-			buffer += rowspan;
 		}
+
 		context->Unmap(texTmp, 0);
 
-		texTmp->Release();
+		context->CopyResource(tex, texTmp);
 
-		return ret;
+		texTmp->Release();
 	}
 };
 
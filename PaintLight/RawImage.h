@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <tuple>
+#include <filesystem>
+#include <algorithm>
+
+#include "MappedFile.h"
+#include "ImageView.h"
+#include "PixelFormat.h"
+#include "FormatImage.h"
+#include "StrokeDensityCache.h"
+
+// Raw image files for intermediates and results, laid out so that a mapping of the file is the image:
+//   RawImageHeader
+//   height rows of pitch bytes from data_offset on, pitch and data_offset are multiples of ImageAlignment, padding is zero
+// Samples are in the byte order of the machine that wrote the file. The checksum is StrokeDensityCache::Hash of the
+// rows (padding included). The writer fills in the magic last, so a file that was never finished is not read.
+struct RawImageHeader
+{
+	static constexpr std::uint32_t Version = 1;
+
+	char magic[8]; // "PLRAW\0\0\0"
+	std::uint32_t version;
+	std::uint32_t format; // PixelFormat
+	std::uint32_t channels; // 1 or 4 (RGBA)
+	std::uint32_t width, height;
+	float scale; // value of the largest UNORM sample
+	std::uint64_t pitch; // bytes from one row to the next
+	std::uint64_t data_offset;
+	std::uint64_t checksum;
+	std::uint64_t reserved;
+};
+static_assert(sizeof(RawImageHeader) == 64, "the rows start right after the header");
+
+inline std::size_t PixelFormatSize(PixelFormat format)
+{
+	switch (format)
+	{
+	case PixelFormat::Float16:
+	case PixelFormat::UNorm16:
+		return 2;
+	case PixelFormat::UNorm8:
+		return 1;
+	case PixelFormat::Float32:
+	default:
+		return 4;
+	}
+}
+
+// Maps a raw image file read-only, nothing is copied or decoded. Rows stay valid as long as the reader.
+class RawImageReader
+{
+private:
+	MappedFile m_file;
+public:
+	RawImageReader()
+	{
+
+	}
+	// empty if the file does not exist or is not a complete raw image
+	explicit RawImageReader(std::filesystem::path const &filename) :m_file(filename)
+	{
+		if (!m_file || m_file.size() < sizeof(RawImageHeader))
+		{
+			m_file.Release();
+			return;
+		}
+		// the header comes from another process or tool, so the sizes are bounded by the file before anything is multiplied
+		// with them: width * channels * sample size cannot overflow (at most 2^32 * 4 * 4), pitch * height is checked as a division
+		RawImageHeader const &header(GetHeader());
+		std::uint64_t const file_size(m_file.size());
+		bool const valid(std::memcmp(header.magic, "PLRAW\0\0\0", 8) == 0 &&
+			header.version == RawImageHeader::Version &&
+			header.format <= static_cast<std::uint32_t>(PixelFormat::UNorm8) &&
+			(header.channels == 1 || header.channels == 4) &&
+			header.pitch % ImageAlignment == 0 &&
+			header.data_offset >= sizeof(RawImageHeader) &&
+			header.data_offset % ImageAlignment == 0 &&
+			header.data_offset <= file_size &&
+			(header.height == 0 || header.pitch <= (file_size - header.data_offset) / header.height) &&
+			std::uint64_t(header.width) * header.channels * PixelFormatSize(GetFormat()) <= header.pitch);
+		if (!valid)
+			m_file.Release();
+	}
+	operator bool() const
+	{
+		return static_cast<bool>(m_file);
+	}
+public:
+	RawImageHeader const &GetHeader() const { return *static_cast<RawImageHeader const *>(m_file.data()); }
+	PixelFormat GetFormat() const { return static_cast<PixelFormat>(GetHeader().format); }
+	std::tuple<std::uint32_t, std::uint32_t> GetSize() const { return { GetHeader().width,GetHeader().height }; }
+	void const *Row(std::uint32_t i) const
+	{
+		return static_cast<char const *>(m_file.data()) + GetHeader().data_offset + i * GetHeader().pitch;
+	}
+	// row i as samples of Format, null if the file has another format
+	template<PixelFormat Format>
+	typename PixelFormatTraits<Format>::Sample const *Samples(std::uint32_t i) const
+	{
+		if (GetFormat() != Format)
+			return nullptr;
+		return static_cast<typename PixelFormatTraits<Format>::Sample const *>(Row(i));
+	}
+	// FP32 RGBA files as an image, empty for anything else; the mapping is read-only, so the pixels must not be written
+	ImageView GetView() const
+	{
+		RawImageHeader const &header(GetHeader());
+		if (GetFormat() != PixelFormat::Float32 || header.channels != 4)
+			return ImageView();
+		return ImageView(const_cast<float *>(Samples<PixelFormat::Float32>(0)), header.width, header.height, header.pitch / sizeof(float), 0, PixelLayout::Interleaved);
+	}
+
+	// reads every row, so unlike opening it is not free
+	bool Verify() const
+	{
+		RawImageHeader const &header(GetHeader());
+		return StrokeDensityCache::Hash(static_cast<float const *>(Row(0)), header.pitch * header.height / sizeof(float)) == header.checksum;
+	}
+};
+
+// Creates a raw image file of the final size and maps it, the rows are written in place and Finish completes the file
+class RawImageWriter
+{
+private:
+	MappedFile m_file;
+	RawImageHeader m_header;
+public:
+	RawImageWriter(std::filesystem::path const &filename, PixelFormat format, std::uint32_t channels, std::uint32_t width, std::uint32_t height, float scale = 255.0f) :m_header{}
+	{
+		m_header.version = RawImageHeader::Version;
+		m_header.format = static_cast<std::uint32_t>(format);
+		m_header.channels = channels;
+		m_header.width = width;
+		m_header.height = height;
+		m_header.scale = scale;
+		m_header.pitch = (std::uint64_t(width) * channels * PixelFormatSize(format) + ImageAlignment - 1) / ImageAlignment * ImageAlignment;
+		m_header.data_offset = (sizeof(RawImageHeader) + ImageAlignment - 1) / ImageAlignment * ImageAlignment;
+		// a new mapping is zero filled, so the padding and the magic are zero until Finish
+		m_file = MappedFile(filename, static_cast<std::size_t>(m_header.data_offset + m_header.pitch * height));
+	}
+	RawImageWriter(RawImageWriter const &other) = delete;
+	RawImageWriter &operator=(RawImageWriter const &other) = delete;
+	operator bool() const
+	{
+		return static_cast<bool>(m_file);
+	}
+public:
+	RawImageHeader const &GetHeader() const { return m_header; }
+	void *Row(std::uint32_t i) const
+	{
+		return static_cast<char *>(m_file.writable_data()) + m_header.data_offset + i * m_header.pitch;
+	}
+	template<PixelFormat Format>
+	typename PixelFormatTraits<Format>::Sample *Samples(std::uint32_t i) const
+	{
+		if (static_cast<PixelFormat>(m_header.format) != Format)
+			return nullptr;
+		return static_cast<typename PixelFormatTraits<Format>::Sample *>(Row(i));
+	}
+	// FP32 RGBA files as an image to write to, empty for anything else
+	ImageView GetView() const
+	{
+		if (static_cast<PixelFormat>(m_header.format) != PixelFormat::Float32 || m_header.channels != 4)
+			return ImageView();
+		return ImageView(Samples<PixelFormat::Float32>(0), m_header.width, m_header.height, m_header.pitch / sizeof(float), 0, PixelLayout::Interleaved);
+	}
+
+	// checksum and header, then the mapping is released; returns the file size or 0 if the file could not be created
+	std::size_t Finish()
+	{
+		if (!m_file)
+			return 0;
+		std::size_t const size(m_file.size());
+		m_header.checksum = StrokeDensityCache::Hash(static_cast<float const *>(Row(0)), m_header.pitch * m_header.height / sizeof(float));
+		std::memcpy(m_header.magic, "PLRAW\0\0\0", 8);
+		std::memcpy(m_file.writable_data(), std::addressof(m_header), sizeof(m_header));
+		m_file.Release();
+		return size;
+	}
+};
+
+// an FP32 image in any layout as an FP32 RGBA file, returns the file size or 0 on failure
+inline std::size_t WriteRawImage(std::filesystem::path const &filename, ImageView const &image)
+{
+	RawImageWriter writer(filename, PixelFormat::Float32, 4, image.width, image.height);
+	if (!writer)
+		return 0;
+	image.CopyTo(writer.GetView());
+	return writer.Finish();
+}
+
+template<PixelFormat Format, std::uint32_t Channels>
+std::size_t WriteRawImage(std::filesystem::path const &filename, FormatImage<Format, Channels> const &image)
+{
+	RawImageWriter writer(filename, Format, Channels, image.width, image.height, image.scale);
+	if (!writer)
+		return 0;
+	for (std::uint32_t i(0); i < image.height; ++i)
+		std::memcpy(writer.Row(i), image.Row(i), std::size_t(image.width) * Channels * sizeof(typename PixelFormatTraits<Format>::Sample));
+	return writer.Finish();
+}
+
+// a ScalarImage, or anything with width, height and rows of width floats, as a one channel FP32 file
+template<typename Image>
+std::size_t WriteRawScalarImage(std::filesystem::path const &filename, Image const &image)
+{
+	RawImageWriter writer(filename, PixelFormat::Float32, 1, image.width, image.height, 1.0f);
+	if (!writer)
+		return 0;
+	for (std::uint32_t i(0); i < image.height; ++i)
+		std::memcpy(writer.Row(i), image.Row(i), std::size_t(image.width) * sizeof(float));
+	return writer.Finish();
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <tuple>
+#include <cmath>
+#include <vector>
+
+#include "Structs/Vector3.hpp"
+#include "PackedConvexHull.hpp"
+
+using vec3f = quickhull::Vector3<float>;
+#define CULLING
+
+template<typename T = float>
+std::tuple<bool, vec3f> rayTriangleIntersect(
+	const vec3f &orig, const vec3f &dir,
+	const vec3f &v0, const vec3f &v1, const vec3f &v2
+	)
+{
+	T t, u, v;
+	auto v0v1 = v1 - v0;
+	auto v0v2 = v2 - v0;
+	auto pvec = dir.crossProduct(v0v2);
+	float det = v0v1.dotProduct(pvec);
+#ifdef CULLING
+	// if the determinant is negative the triangle is backfacing
+	// if the determinant is close to 0, the ray misses the triangle
+	if (det < 1e-8f) return { false,vec3f(0,0,0) };
+#else
+	// ray and triangle are parallel if det is close to 0
+	if (fabs(det) < 1e-8f) return { false,vec3f(0,0,0) };
+#endif
+	T invDet = 1.0 / det;
+
+	auto tvec = orig - v0;
+	u = tvec.dotProduct(pvec) * invDet;
+	if (u < 0 || u > 1) return { false,vec3f(0,0,0) };
+
+	auto qvec = tvec.crossProduct(v0v1);
+	v = dir.dotProduct(qvec) * invDet;
+	if (v < 0 || u + v > 1) return { false,vec3f(0,0,0) };
+
+	t = v0v2.dotProduct(qvec) * invDet;
+
+	return { true,orig + dir * t };
+}
+
+// the part of rayTriangleIntersect that only depends on the triangle and the ray origin, computed once for all the rays
+// from one origin
+struct RayTriangle
+{
+	vec3f v0v1, v0v2;
+	vec3f tvec; // orig - v0
+	vec3f qvec; // tvec x v0v1
+};
+
+inline RayTriangle MakeRayTriangle(const vec3f &orig, quickhull::PackedConvexHull<float>::Triangle const &triangle)
+{
+	RayTriangle r;
+	r.v0v1 = triangle.m_e1;
+	r.v0v2 = triangle.m_e2;
+	r.tvec = orig - triangle.m_v0;
+	r.qvec = r.tvec.crossProduct(r.v0v1);
+	return r;
+}
+
+// the faces of a hull in face order
+inline std::vector<RayTriangle> MakeRayTriangles(const vec3f &orig, quickhull::PackedConvexHull<float> const &hull)
+{
+	std::vector<RayTriangle> triangles;
+	triangles.reserve(hull.getFaceCount());
+	for (auto const &triangle : hull.getTriangles())
+		triangles.push_back(MakeRayTriangle(orig, triangle));
+	return triangles;
+}
+
+// same as rayTriangleIntersect for a ray from the origin tri was made for
+template<typename T = float>
+std::tuple<bool, vec3f> rayTriangleIntersect(
+	const vec3f &orig, const vec3f &dir,
+	RayTriangle const &tri
+	)
+{
+	T t, u, v;
+	auto pvec = dir.crossProduct(tri.v0v2);
+	float det = tri.v0v1.dotProduct(pvec);
+#ifdef CULLING
+	if (det < 1e-8f) return { false,vec3f(0,0,0) };
+#else
+	if (fabs(det) < 1e-8f) return { false,vec3f(0,0,0) };
+#endif
+	T invDet = 1.0 / det;
+
+	u = tri.tvec.dotProduct(pvec) * invDet;
+	if (u < 0 || u > 1) return { false,vec3f(0,0,0) };
+
+	v = dir.dotProduct(tri.qvec) * invDet;
+	if (v < 0 || u + v > 1) return { false,vec3f(0,0,0) };
+
+	t = tri.v0v2.dotProduct(tri.qvec) * invDet;
+
+	return { true,orig + dir * t };
+}
+
+// test every triangle of a hull in index buffer order and return the first hit
+template<typename IndexBuffer, typename VertexBuffer>
+std::tuple<bool, vec3f> rayHullIntersectLinear(
+	const vec3f &orig, const vec3f &dir,
+	IndexBuffer const &indexBuffer, VertexBuffer const &vertexBuffer
+	)
+{
+	for (std::size_t f(0); f < indexBuffer.size(); f += 3)
+	{
+		auto const vertex1(vertexBuffer[indexBuffer[f + 0]]);
+		auto const vertex2(vertexBuffer[indexBuffer[f + 1]]);
+		auto const vertex3(vertexBuffer[indexBuffer[f + 2]]);
+
+		auto const [hit, hit_point] = rayTriangleIntersect(orig, dir, vertex1, vertex2, vertex3);
+		if (hit)
+			return { true, hit_point };
+	}
+	return { false,vec3f(0,0,0) };
+}
+
+// test every triangle in order and return the first hit, the triangles were made for orig
+inline std::tuple<bool, vec3f> rayHullIntersectLinear(
+	const vec3f &orig, const vec3f &dir,
+	std::vector<RayTriangle> const &triangles
+	)
+{
+	for (auto const &triangle : triangles)
+	{
+		auto const [hit, hit_point] = rayTriangleIntersect(orig, dir, triangle);
+		if (hit)
+			return { true, hit_point };
+	}
+	return { false,vec3f(0,0,0) };
+}
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <tuple>
+#include <new>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+
+#include "DXUT.h"
+#include "d3d11helper.h"
+#include "ImageView.h"
+#include "FormatImage.h"
+
+// one float per pixel, for fields that RGBAImage would store three times (the stroke density)
+class ScalarImage
+{
+public:
+	float *data; // ImageAlignment aligned
+	std::uint32_t width, height;
+	std::size_t pitch; // floats from one row to the next, width (no padding) unless set up otherwise
+public:
+	ScalarImage() :data(nullptr), width(0), height(0), pitch(0)
+	{
+
+	}
+	~ScalarImage()
+	{
+		Release();
+	}
+	ScalarImage(ScalarImage const &other) :data(nullptr), width(other.width), height(other.height), pitch(other.pitch)
+	{
+		if (other.data)
+		{
+			data = Allocate(pitch * height);
+			std::copy_n(other.data, pitch * height, data);
+		}
+	}
+	ScalarImage &operator=(ScalarImage const &other)
+	{
+		if (std::addressof(other) != this)
+		{
+			ScalarImage copy(other);
+			*this = std::move(copy);
+		}
+		return *this;
+	}
+	ScalarImage(ScalarImage &&other) noexcept :data(other.data), width(other.width), height(other.height), pitch(other.pitch)
+	{
+		other.data = nullptr;
+		other.width = other.height = 0;
+		other.pitch = 0;
+	}
+	ScalarImage &operator=(ScalarImage &&other) noexcept
+	{
+		if (std::addressof(other) != this)
+		{
+			Release();
+			data = other.data;
+			width = other.width;
+			height = other.height;
+			pitch = other.pitch;
+			other.data = nullptr;
+			other.width = other.height = 0;
+			other.pitch = 0;
+		}
+		return *this;
+	}
+	operator bool() const noexcept
+	{
+		return width != 0 && height != 0 && data != nullptr;
+	}
+public:
+	std::tuple<std::uint32_t, std::uint32_t> GetSize() const { return { width,height }; }
+	float *Row(std::uint32_t i) const { return data + i * pitch; }
+	// the whole image is one array of width * height floats
+	bool IsPacked() const { return pitch == width; }
+	std::size_t GetMemoryUsage() const { return data ? pitch * height * sizeof(float) : 0; }
+
+	// smallest pitch whose rows start on ImageAlignment bytes
+	static std::size_t AlignedPitch(std::uint32_t width)
+	{
+		std::size_t const floats(ImageAlignment / sizeof(float));
+		return (width + floats - 1) / floats * floats;
+	}
+
+	// pitch: floats from one row to the next, 0 for rows without padding
+	void Setup(std::uint32_t width, std::uint32_t height, std::size_t pitch = 0)
+	{
+		std::size_t const row_pitch(std::max<std::size_t>(pitch, width));
+		float *new_data(Allocate(row_pitch * height));
+		std::fill_n(new_data, row_pitch * height, 0.0f);
+		Release();
+		this->width = width;
+		this->height = height;
+		this->pitch = row_pitch;
+		this->data = new_data;
+	}
+	void Release() noexcept
+	{
+		if (data)
+		{
+			::operator delete[](data, std::align_val_t(ImageAlignment));
+			data = nullptr;
+		}
+		width = height = 0;
+		pitch = 0;
+	}
+
+	float At(std::uint32_t i, std::uint32_t j) const { return data[i * pitch + j]; }
+	void Set(std::uint32_t i, std::uint32_t j, float k) { data[i * pitch + j] = k; }
+
+	// the value of every pixel to R, G and B of an image of the same size, as the RGBA stroke density used to be stored
+	void Broadcast(ImageView const &dst) const
+	{
+		std::uint32_t const rows(std::min(height, dst.height)), columns(std::min(width, dst.width));
+		for (std::uint32_t i(0); i < rows; ++i)
+		{
+			float const *src(Row(i));
+			for (std::uint32_t j(0); j < columns; ++j)
+				dst.Set(i, j, src[j], src[j], src[j]);
+		}
+	}
+private:
+	static float *Allocate(std::size_t count)
+	{
+		return static_cast<float *>(::operator new[](count * sizeof(float), std::align_val_t(ImageAlignment)));
+	}
+};
+
+class ScalarImageGPU // R32_FLOAT texture of a ScalarImage (or of a one channel FormatImage in its own format), shaders read it as Texture2D<float>
+{
+public:
+	std::uint32_t width, height;
+public:
+	ID3D11Texture2D *tex;
+	ID3D11ShaderResourceView *srv;
+	ID3D11UnorderedAccessView *uav;
+public:
+	ScalarImageGPU() noexcept : width(0), height(0), tex(nullptr), srv(nullptr), uav(nullptr)
+	{
+
+	}
+	ScalarImageGPU(std::uint32_t width, std::uint32_t height, ID3D11Device *device, DXGI_FORMAT format = DXGI_FORMAT_R32_FLOAT) :width(width), height(height), tex(nullptr), srv(nullptr), uav(nullptr)
+	{
+		// create Texture2D
+		D3D11_TEXTURE2D_DESC textureDesc{};
+		textureDesc.Width = width;
+		textureDesc.Height = height;
+		textureDesc.MipLevels = 1;
+		textureDesc.ArraySize = 1;
+		textureDesc.Format = format;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.Usage = D3D11_USAGE_DEFAULT;
+		textureDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+		textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		textureDesc.MiscFlags = 0;
+		THROW(device->CreateTexture2D(&textureDesc, nullptr, std::addressof(tex)));
+
+		// create SRV
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+		srvDesc.Format = textureDesc.Format;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = 1;
+		THROW(device->CreateShaderResourceView(tex, std::addressof(srvDesc), std::addressof(srv)));
+
+		// create UAV
+		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
+		uavDesc.Format = textureDesc.Format;
+		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+		uavDesc.Texture2D.MipSlice = 0;
+		THROW(device->CreateUnorderedAccessView(tex, std::addressof(uavDesc), std::addressof(uav)));
+	}
+	ScalarImageGPU(ScalarImage const &img, ID3D11Device *device, ID3D11DeviceContext *context) :ScalarImageGPU(img.width, img.height, device)
+	{
+		Upload(img, device, context);
+	}
+	void Release() noexcept
+	{
+		try {
+			SAFE_RELEASE(tex);
+			SAFE_RELEASE(srv);
+			SAFE_RELEASE(uav);
+		}
+		catch (...) {
+		}
+	}
+	~ScalarImageGPU()
+	{
+		Release();
+	}
+	ScalarImageGPU(ScalarImageGPU const &other) = delete;
+	ScalarImageGPU &operator=(ScalarImageGPU const &other) = delete;
+
+	ScalarImageGPU(ScalarImageGPU &&other) noexcept : width(other.width), height(other.height), tex(other.tex), srv(other.srv), uav(other.uav)
+	{
+		other.width = 0;
+		other.height = 0;
+		other.tex = nullptr;
+		other.srv = nullptr;
+		other.uav = nullptr;
+	}
+	ScalarImageGPU &operator=(ScalarImageGPU &&other) noexcept
+	{
+		if (std::addressof(other) != this)
+		{
+			Release();
+			width = other.width;
+			height = other.height;
+			tex = other.tex;
+			srv = other.srv;
+			uav = other.uav;
+			other.width = 0;
+			other.height = 0;
+			other.tex = nullptr;
+			other.srv = nullptr;
+			other.uav = nullptr;
+		}
+		return *this;
+	}
+	operator bool()
+	{
+		return width != 0 && height != 0;
+	}
+public:
+	// texture format with the samples of a one channel FormatImage, UNORM samples read as 0 .. 1 like a scale of 1.0f
+	static DXGI_FORMAT TextureFormat(PixelFormat format)
+	{
+		switch (format)
+		{
+		case PixelFormat::Float16:
+			return DXGI_FORMAT_R16_FLOAT;
+		case PixelFormat::UNorm16:
+			return DXGI_FORMAT_R16_UNORM;
+		case PixelFormat::UNorm8:
+			return DXGI_FORMAT_R8_UNORM;
+		case PixelFormat::Float32:
+		default:
+			return DXGI_FORMAT_R32_FLOAT;
+		}
+	}
+	DXGI_FORMAT GetFormat() const
+	{
+		D3D11_TEXTURE2D_DESC textureDesc{};
+		if (tex)
+			tex->GetDesc(std::addressof(textureDesc));
+		return textureDesc.Format;
+	}
+
+	// the texture must be R32_FLOAT
+	void Upload(ScalarImage const &img, ID3D11Device *device, ID3D11DeviceContext *context)
+	{
+		ID3D11Texture2D *texTmp;
+
+		// create Texture2D for upload
+		D3D11_TEXTURE2D_DESC textureDesc{};
+		textureDesc.Width = width;
+		textureDesc.Height = height;
+		textureDesc.MipLevels = 1;
+		textureDesc.ArraySize = 1;
+		textureDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.Usage = D3D11_USAGE_DYNAMIC;
+		textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		textureDesc.MiscFlags = 0;
+		THROW(device->CreateTexture2D(&textureDesc, nullptr, std::addressof(texTmp)));
+
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+
+		THROW(context->Map(texTmp, 0, D3D11_MAP_WRITE_DISCARD, 0, std::addressof(mappedResource)));
+
+		BYTE *mappedData = static_cast<BYTE *>(mappedResource.pData);
+		for (std::uint32_t i(0); i < std::min(img.height, height); ++i)
+		{
+			std::memcpy(mappedData, img.Row(i), std::min(img.width, width) * sizeof(float));
+			mappedData += mappedResource.RowPitch;
+		}
+
+		context->Unmap(texTmp, 0);
+
+		context->CopyResource(tex, texTmp);
+
+		texTmp->Release();
+	}
+
+	// the samples as they are, the texture must have TextureFormat(Format)
+	template<PixelFormat Format>
+	void Upload(FormatImage<Format, 1> const &img, ID3D11Device *device, ID3D11DeviceContext *context)
+	{
+		ID3D11Texture2D *texTmp;
+
+		// create Texture2D for upload
+		D3D11_TEXTURE2D_DESC textureDesc{};
+		textureDesc.Width = width;
+		textureDesc.Height = height;
+		textureDesc.MipLevels = 1;
+		textureDesc.ArraySize = 1;
+		textureDesc.Format = TextureFormat(Format);
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.Usage = D3D11_USAGE_DYNAMIC;
+		textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		textureDesc.MiscFlags = 0;
+		THROW(device->CreateTexture2D(&textureDesc, nullptr, std::addressof(texTmp)));
+
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+
+		THROW(context->Map(texTmp, 0, D3D11_MAP_WRITE_DISCARD, 0, std::addressof(mappedResource)));
+
+		BYTE *mappedData = static_cast<BYTE *>(mappedResource.pData);
+		for (std::uint32_t i(0); i < std::min(img.height, height); ++i)
+		{
+			std::memcpy(mappedData, img.Row(i), std::min(img.width, width) * sizeof(typename FormatImage<Format, 1>::Sample));
+			mappedData += mappedResource.RowPitch;
+		}
+
+		context->Unmap(texTmp, 0);
+
+		context->CopyResource(tex, texTmp);
+
+		texTmp->Release();
+	}
+};
@@ -33,7 +33,7 @@ private:
 	{
 		float rangeMin, rangeMax;
 		float gamma;
-		std::uint32_t pad1;
+		std::uint32_t scalar;
 	};
 
 	ID3D11Buffer *m_vertexBuffer;
@@ -194,7 +194,8 @@ public:
 		return *this;
 	}
 public:
-	void Draw(ID3D11DeviceContext *context, ID3D11ShaderResourceView *srvTexture, float rangeMin = 0.0f, float rangeMax = 255.0f, float gamma = 1.0f)
+	// scalar: srvTexture has one channel (a ScalarImageGPU), drawn in gray
+	void Draw(ID3D11DeviceContext *context, ID3D11ShaderResourceView *srvTexture, float rangeMin = 0.0f, float rangeMax = 255.0f, float gamma = 1.0f, bool scalar = false)
 	{
 		D3D11_MAPPED_SUBRESOURCE mappedResource;
 
@@ -204,6 +205,7 @@ public:
 		screenQuadInfoBuf->rangeMin = rangeMin;
 		screenQuadInfoBuf->rangeMax = rangeMax;
 		screenQuadInfoBuf->gamma = gamma;
+		screenQuadInfoBuf->scalar = scalar ? 1 : 0;
 		context->Unmap(m_buf, 0);
 
 		unsigned int stride;
@@ -12,7 +12,7 @@ struct screenQuadInfo
 {
 	float rangeMin, rangeMax;
 	float gamma;
-	uint pad;
+	uint scalar; // one channel texture, shown as gray
 };
 
 cbuffer cb                : register(b0)
@@ -23,6 +23,8 @@ cbuffer cb                : register(b0)
 float4 main(VS_OUTPUT pin) : SV_TARGET
 {
 	float4 color = g_tex.Sample(g_tex_sampler, pin.texCoord);
+	if (g_info.scalar)
+		color.xyz = color.xxx;
 	float3 val = (color.xyz - g_info.rangeMin) / g_info.rangeMax;
 	return float4(pow(val, g_info.gamma), 1.0f);
 }
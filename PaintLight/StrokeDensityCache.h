@@ -0,0 +1,290 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+
+#include "MappedFile.h"
+
+// Content addressed cache of the stroke density stage, one file per key in a directory
+// The key is a hash of the decoded pixels and of every parameter that changes the result.
+// Files are laid out to be used straight from the mapping:
+//   Header
+//   width * height stroke density values, one float per pixel
+//   width * height palette colors as r, g, b if Header::HasPalette is set
+// Every section starts at a multiple of SectionAlignment.
+// Entries take 16 bytes per pixel with the palette, so once the files in the directory add up to more than the size
+// limit Store deletes the least recently used ones (Load refreshes the modification time of the entry it opens).
+class StrokeDensityCache
+{
+public:
+	static constexpr std::uint32_t Version = 2;
+	static constexpr std::size_t SectionAlignment = 64;
+	static constexpr std::uint64_t DefaultMaxBytes = std::uint64_t(2) << 30;
+
+	struct Header
+	{
+		static constexpr std::uint32_t HasPalette = 1;
+
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t flags;
+		std::uint64_t key;
+		std::uint32_t width, height;
+		std::uint32_t hull_faces; // only reported
+		std::uint32_t reserved;
+		std::uint64_t density_offset;
+		std::uint64_t palette_offset;
+	};
+private:
+	std::filesystem::path m_directory;
+	std::uint64_t m_max_bytes;
+	MappedFile m_file; // the last entry found by Load
+	std::size_t m_hits, m_misses;
+public:
+	StrokeDensityCache() : m_max_bytes(DefaultMaxBytes), m_hits(0), m_misses(0)
+	{
+
+	}
+	explicit StrokeDensityCache(std::filesystem::path directory, std::uint64_t max_bytes = DefaultMaxBytes) : m_directory(std::move(directory)), m_max_bytes(max_bytes), m_hits(0), m_misses(0)
+	{
+
+	}
+public:
+	std::filesystem::path const &GetDirectory() const { return m_directory; }
+	std::uint64_t GetMaxBytes() const { return m_max_bytes; }
+	std::size_t GetHits() const { return m_hits; }
+	std::size_t GetMisses() const { return m_misses; }
+	operator bool() const
+	{
+		return !m_directory.empty();
+	}
+
+	// fast non-cryptographic hash of a block of floats, four independent lanes
+	static std::uint64_t Hash(float const *data, std::size_t count, std::uint64_t seed = 0)
+	{
+		std::uint64_t constexpr Prime1(0x9E3779B185EBCA87ull), Prime2(0xC2B2AE3D27D4EB4Full);
+		std::uint64_t lane[4] = { seed + Prime1, seed + Prime2, seed, seed - Prime1 };
+		std::size_t i(0);
+		for (; i + 8 <= count; i += 8)
+		{
+			for (std::size_t k(0); k < 4; ++k)
+			{
+				std::uint64_t word;
+				std::memcpy(std::addressof(word), data + i + k * 2, sizeof(word));
+				lane[k] = Rotate(lane[k] + word * Prime2, 31) * Prime1;
+			}
+		}
+		std::uint64_t h(Rotate(lane[0], 1) + Rotate(lane[1], 7) + Rotate(lane[2], 12) + Rotate(lane[3], 18));
+		for (; i < count; ++i)
+		{
+			std::uint32_t word;
+			std::memcpy(std::addressof(word), data + i, sizeof(word));
+			h = Rotate(h ^ (word * Prime1), 23) * Prime2;
+		}
+		return Mix(h ^ count);
+	}
+
+	static std::uint64_t Combine(std::uint64_t key, std::uint64_t value)
+	{
+		return Mix(key ^ (value + 0x9E3779B97F4A7C15ull + (key << 6) + (key >> 2)));
+	}
+
+	// maps the entry for key, the views below stay valid until the next Load
+	// the entry must have the given size and a palette if palette is set, anything else counts as a miss
+	bool Load(std::uint64_t key, std::uint32_t width, std::uint32_t height, bool palette)
+	{
+		m_file.Release();
+		if (m_directory.empty())
+			return false;
+		auto const filename(GetFilename(key));
+		// before mapping it, a mapped file cannot be modified on Windows
+		std::error_code ec;
+		std::filesystem::last_write_time(filename, std::filesystem::file_time_type::clock::now(), ec);
+		MappedFile file(filename);
+		if (!file || file.size() < sizeof(Header))
+		{
+			++m_misses;
+			return false;
+		}
+		Header const *header(static_cast<Header const *>(file.data()));
+		std::size_t const pixels(std::size_t(width) * height);
+		bool const valid(std::memcmp(header->magic, "PLSDC\0\0\0", 8) == 0 &&
+			header->version == Version &&
+			header->key == key &&
+			header->width == width &&
+			header->height == height &&
+			(!palette || (header->flags & Header::HasPalette)) &&
+			SectionFits(header->density_offset, pixels, sizeof(float), file.size()) &&
+			(!(header->flags & Header::HasPalette) || SectionFits(header->palette_offset, pixels, 3 * sizeof(float), file.size())));
+		if (!valid)
+		{
+			++m_misses;
+			return false;
+		}
+		m_file = std::move(file);
+		++m_hits;
+		return true;
+	}
+
+	Header const &GetHeader() const { return *static_cast<Header const *>(m_file.data()); }
+	float const *GetDensity() const { return Section(GetHeader().density_offset); }
+	float const *GetPalette() const { return (GetHeader().flags & Header::HasPalette) ? Section(GetHeader().palette_offset) : nullptr; }
+	std::size_t GetMappedSize() const { return m_file.size(); }
+
+	// density has one float per pixel, palette is an RGBA image (4 floats per pixel) and may be null
+	// writes to a temporary file first so a concurrent Load never sees half an entry, returns the file size or 0 on failure
+	std::size_t Store(std::uint64_t key, std::uint32_t width, std::uint32_t height, std::uint32_t hull_faces, float const *density, float const *palette)
+	{
+		if (m_directory.empty())
+			return 0;
+		std::error_code ec;
+		std::filesystem::create_directories(m_directory, ec);
+
+		std::size_t const pixels(std::size_t(width) * height);
+		Header header{};
+		std::memcpy(header.magic, "PLSDC\0\0\0", 8);
+		header.version = Version;
+		header.flags = palette ? Header::HasPalette : 0;
+		header.key = key;
+		header.width = width;
+		header.height = height;
+		header.hull_faces = hull_faces;
+		header.density_offset = Align(sizeof(Header));
+		header.palette_offset = palette ? Align(header.density_offset + pixels * sizeof(float)) : 0;
+		std::size_t const size(palette ? header.palette_offset + pixels * 3 * sizeof(float) : header.density_offset + pixels * sizeof(float));
+
+		auto const filename(GetFilename(key));
+		auto temp(filename);
+		temp += ".tmp";
+		{
+			std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+			if (!file)
+				return 0;
+			std::vector<float> buffer;
+			Write(file, std::addressof(header), sizeof(header));
+			Pad(file, sizeof(header), header.density_offset);
+
+			Write(file, density, pixels * sizeof(float));
+			if (palette)
+			{
+				Pad(file, header.density_offset + pixels * sizeof(float), header.palette_offset);
+				// one row at a time to keep the extra memory small
+				buffer.resize(width * 3);
+				for (std::size_t y(0); y < height; ++y)
+				{
+					for (std::size_t x(0); x < width; ++x)
+						std::memcpy(buffer.data() + x * 3, palette + (y * width + x) * 4, 3 * sizeof(float));
+					Write(file, buffer.data(), width * 3 * sizeof(float));
+				}
+			}
+			if (!file)
+			{
+				file.close();
+				std::filesystem::remove(temp, ec);
+				return 0;
+			}
+		}
+		std::filesystem::rename(temp, filename, ec);
+		if (ec)
+		{
+			std::filesystem::remove(temp, ec);
+			return 0;
+		}
+		Evict(filename);
+		return size;
+	}
+private:
+	// deletes the least recently used entries until the directory fits in m_max_bytes, keeping the one just stored
+	void Evict(std::filesystem::path const &keep) const
+	{
+		struct Entry
+		{
+			std::filesystem::path path;
+			std::filesystem::file_time_type time;
+			std::uint64_t size;
+		};
+		std::vector<Entry> entries;
+		std::uint64_t total(0);
+		std::error_code ec;
+		for (std::filesystem::directory_iterator it(m_directory, ec), end; !ec && it != end; it.increment(ec))
+		{
+			if (it->path().extension() != ".plsdc" || !it->is_regular_file(ec))
+				continue;
+			Entry entry{ it->path(), it->last_write_time(ec), it->file_size(ec) };
+			if (ec)
+				continue;
+			total += entry.size;
+			if (entry.path != keep)
+				entries.push_back(std::move(entry));
+		}
+		if (total <= m_max_bytes)
+			return;
+		std::sort(entries.begin(), entries.end(), [](Entry const &a, Entry const &b) { return a.time < b.time; });
+		for (auto const &entry : entries)
+		{
+			if (total <= m_max_bytes)
+				break;
+			// an entry mapped by another instance cannot be deleted on Windows, it stays until the next Store
+			if (std::filesystem::remove(entry.path, ec))
+				total -= entry.size;
+		}
+	}
+
+	// a section of count elements of element_size bytes at offset, checked without overflow
+	static bool SectionFits(std::uint64_t offset, std::uint64_t count, std::uint64_t element_size, std::uint64_t file_size)
+	{
+		return offset % SectionAlignment == 0 &&
+			offset >= sizeof(Header) &&
+			offset <= file_size &&
+			count <= (file_size - offset) / element_size;
+	}
+
+	std::filesystem::path GetFilename(std::uint64_t key) const
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.plsdc", static_cast<unsigned long long>(key));
+		return m_directory / name;
+	}
+
+	float const *Section(std::uint64_t offset) const
+	{
+		return reinterpret_cast<float const *>(static_cast<char const *>(m_file.data()) + offset);
+	}
+
+	static std::uint64_t Align(std::uint64_t offset)
+	{
+		return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+	}
+
+	static void Write(std::ofstream &file, void const *data, std::size_t size)
+	{
+		file.write(static_cast<char const *>(data), static_cast<std::streamsize>(size));
+	}
+
+	static void Pad(std::ofstream &file, std::uint64_t from, std::uint64_t to)
+	{
+		char const zero[SectionAlignment] = {};
+		Write(file, zero, static_cast<std::size_t>(to - from));
+	}
+
+	static std::uint64_t Rotate(std::uint64_t v, int r)
+	{
+		return (v << r) | (v >> (64 - r));
+	}
+
+	static std::uint64_t Mix(std::uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDull;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ull;
+		h ^= h >> 33;
+		return h;
+	}
+};
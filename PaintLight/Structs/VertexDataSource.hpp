@@ -1,47 +1,150 @@
 #ifndef VertexDataSource_h
 #define VertexDataSource_h
 
+#include <iterator>
+#include <cstddef>
 #include "Vector3.hpp"
 
 namespace quickhull {
-	
+
+	// View of count points, each one the x, y and z components at the start of stride consecutive T (3 for an array of
+	// Vector3, 4 for interleaved RGBA pixels). The data is not copied.
 	template<typename T>
 	class VertexDataSource {
-		const Vector3<T>* m_ptr;
+		const T* m_ptr;
 		size_t m_count;
-	
+		size_t m_stride;
+
 	public:
-		VertexDataSource(const Vector3<T>* ptr, size_t count) : m_ptr(ptr), m_count(count) {
-			
+		class Iterator {
+			const T* m_ptr;
+			size_t m_stride;
+		public:
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = Vector3<T>;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const Vector3<T>*;
+			using reference = const Vector3<T>&;
+
+			Iterator(const T* ptr, size_t stride) : m_ptr(ptr), m_stride(stride) {
+
+			}
+
+			reference operator*() const {
+				return *reinterpret_cast<pointer>(m_ptr);
+			}
+			pointer operator->() const {
+				return reinterpret_cast<pointer>(m_ptr);
+			}
+			reference operator[](difference_type n) const {
+				return *(*this+n);
+			}
+
+			Iterator& operator++() {
+				m_ptr += m_stride;
+				return *this;
+			}
+			Iterator operator++(int) {
+				Iterator it(*this);
+				m_ptr += m_stride;
+				return it;
+			}
+			Iterator& operator--() {
+				m_ptr -= m_stride;
+				return *this;
+			}
+			Iterator operator--(int) {
+				Iterator it(*this);
+				m_ptr -= m_stride;
+				return it;
+			}
+			Iterator& operator+=(difference_type n) {
+				m_ptr += n*static_cast<difference_type>(m_stride);
+				return *this;
+			}
+			Iterator& operator-=(difference_type n) {
+				m_ptr -= n*static_cast<difference_type>(m_stride);
+				return *this;
+			}
+			Iterator operator+(difference_type n) const {
+				return Iterator(*this) += n;
+			}
+			friend Iterator operator+(difference_type n, const Iterator& it) {
+				return it+n;
+			}
+			Iterator operator-(difference_type n) const {
+				return Iterator(*this) -= n;
+			}
+			difference_type operator-(const Iterator& other) const {
+				return (m_ptr-other.m_ptr)/static_cast<difference_type>(m_stride);
+			}
+
+			bool operator==(const Iterator& other) const {
+				return m_ptr == other.m_ptr;
+			}
+			bool operator!=(const Iterator& other) const {
+				return m_ptr != other.m_ptr;
+			}
+			bool operator<(const Iterator& other) const {
+				return m_ptr < other.m_ptr;
+			}
+			bool operator>(const Iterator& other) const {
+				return m_ptr > other.m_ptr;
+			}
+			bool operator<=(const Iterator& other) const {
+				return m_ptr <= other.m_ptr;
+			}
+			bool operator>=(const Iterator& other) const {
+				return m_ptr >= other.m_ptr;
+			}
+		};
+
+		VertexDataSource(const Vector3<T>* ptr, size_t count) : m_ptr(&ptr->x), m_count(count), m_stride(3) {
+
 		}
-		
-		VertexDataSource(const std::vector<Vector3<T>>& vec) : m_ptr(&vec[0]), m_count(vec.size()) {
-			
+
+		VertexDataSource(const std::vector<Vector3<T>>& vec) : m_ptr(&vec[0].x), m_count(vec.size()), m_stride(3) {
+
+		}
+
+		// Points at ptr, ptr+stride, ptr+2*stride, ...
+		VertexDataSource(const T* ptr, size_t count, size_t stride) : m_ptr(ptr), m_count(count), m_stride(stride) {
+
 		}
-		
-		VertexDataSource() : m_ptr(nullptr), m_count(0) {
-			
+
+		VertexDataSource() : m_ptr(nullptr), m_count(0), m_stride(3) {
+
 		}
-		
+
 		VertexDataSource& operator=(const VertexDataSource& other) = default;
-		
+
 		size_t size() const {
 			return m_count;
 		}
-		
-		const Vector3<T>& operator[](size_t index) const {
-			return m_ptr[index];
+
+		// Number of T from one point to the next
+		size_t stride() const {
+			return m_stride;
 		}
-		
-		const Vector3<T>* begin() const {
+
+		// x component of the first point
+		const T* data() const {
 			return m_ptr;
 		}
-		
-		const Vector3<T>* end() const {
-			return m_ptr + m_count;
+
+		const Vector3<T>& operator[](size_t index) const {
+			return *reinterpret_cast<const Vector3<T>*>(m_ptr + index*m_stride);
+		}
+
+		Iterator begin() const {
+			return Iterator(m_ptr, m_stride);
+		}
+
+		Iterator end() const {
+			return Iterator(m_ptr + m_count*m_stride, m_stride);
 		}
 	};
-	
+
 }
 
 
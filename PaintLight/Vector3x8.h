@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "Structs/Vector3.hpp"
+
+// Eight floats, one AVX register with AVX2 and a plain array otherwise
+// Every operation is a single IEEE operation per lane (no fused multiply-add), so packet code gives the same bits as
+// the same expression written with scalar floats. Comparisons return lanes with all bits set or clear for Select.
+class Float8
+{
+public:
+	static constexpr std::size_t Width = 8;
+#if defined(__AVX2__)
+	__m256 v;
+
+	Float8() = default;
+	Float8(__m256 v) : v(v)
+	{
+
+	}
+	explicit Float8(float s) : v(_mm256_set1_ps(s))
+	{
+
+	}
+	static Float8 Load(float const *src) { return _mm256_loadu_ps(src); }
+	void Store(float *dst) const { _mm256_storeu_ps(dst, v); }
+
+	Float8 operator+(Float8 const &o) const { return _mm256_add_ps(v, o.v); }
+	Float8 operator-(Float8 const &o) const { return _mm256_sub_ps(v, o.v); }
+	Float8 operator*(Float8 const &o) const { return _mm256_mul_ps(v, o.v); }
+	Float8 operator/(Float8 const &o) const { return _mm256_div_ps(v, o.v); }
+	Float8 operator>(Float8 const &o) const { return _mm256_cmp_ps(v, o.v, _CMP_GT_OQ); }
+	Float8 operator<(Float8 const &o) const { return _mm256_cmp_ps(v, o.v, _CMP_LT_OQ); }
+	Float8 operator==(Float8 const &o) const { return _mm256_cmp_ps(v, o.v, _CMP_EQ_OQ); }
+
+	friend Float8 Sqrt(Float8 const &a) { return _mm256_sqrt_ps(a.v); }
+	friend Float8 Abs(Float8 const &a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+	friend Float8 Min(Float8 const &a, Float8 const &b) { return _mm256_min_ps(a.v, b.v); }
+	friend Float8 Max(Float8 const &a, Float8 const &b) { return _mm256_max_ps(a.v, b.v); }
+	// lanes of a where mask is set, of b elsewhere
+	friend Float8 Select(Float8 const &mask, Float8 const &a, Float8 const &b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+	// bit k is set if lane k of the mask is set
+	int MoveMask() const { return _mm256_movemask_ps(v); }
+#else
+	float v[Width];
+
+	Float8() = default;
+	explicit Float8(float s)
+	{
+		std::fill(v, v + Width, s);
+	}
+	static Float8 Load(float const *src)
+	{
+		Float8 ret;
+		std::memcpy(ret.v, src, sizeof(ret.v));
+		return ret;
+	}
+	void Store(float *dst) const { std::memcpy(dst, v, sizeof(v)); }
+
+	Float8 operator+(Float8 const &o) const { return Apply(o, [](float a, float b) { return a + b; }); }
+	Float8 operator-(Float8 const &o) const { return Apply(o, [](float a, float b) { return a - b; }); }
+	Float8 operator*(Float8 const &o) const { return Apply(o, [](float a, float b) { return a * b; }); }
+	Float8 operator/(Float8 const &o) const { return Apply(o, [](float a, float b) { return a / b; }); }
+	Float8 operator>(Float8 const &o) const { return Apply(o, [](float a, float b) { return Bits(a > b); }); }
+	Float8 operator<(Float8 const &o) const { return Apply(o, [](float a, float b) { return Bits(a < b); }); }
+	Float8 operator==(Float8 const &o) const { return Apply(o, [](float a, float b) { return Bits(a == b); }); }
+
+	friend Float8 Sqrt(Float8 const &a) { return a.Apply(a, [](float x, float) { return std::sqrt(x); }); }
+	friend Float8 Abs(Float8 const &a) { return a.Apply(a, [](float x, float) { return std::fabs(x); }); }
+	friend Float8 Min(Float8 const &a, Float8 const &b) { return a.Apply(b, [](float x, float y) { return x < y ? x : y; }); }
+	friend Float8 Max(Float8 const &a, Float8 const &b) { return a.Apply(b, [](float x, float y) { return x > y ? x : y; }); }
+	friend Float8 Select(Float8 const &mask, Float8 const &a, Float8 const &b)
+	{
+		Float8 ret;
+		for (std::size_t k(0); k < Width; ++k)
+			ret.v[k] = std::signbit(mask.v[k]) ? a.v[k] : b.v[k];
+		return ret;
+	}
+	int MoveMask() const
+	{
+		int mask(0);
+		for (std::size_t k(0); k < Width; ++k)
+			mask |= std::signbit(v[k]) ? 1 << k : 0;
+		return mask;
+	}
+private:
+	template<typename Op>
+	Float8 Apply(Float8 const &o, Op op) const
+	{
+		Float8 ret;
+		for (std::size_t k(0); k < Width; ++k)
+			ret.v[k] = op(v[k], o.v[k]);
+		return ret;
+	}
+
+	static float Bits(bool set)
+	{
+		std::uint32_t const bits(set ? 0xFFFFFFFFu : 0u);
+		float ret;
+		std::memcpy(std::addressof(ret), std::addressof(bits), sizeof(ret));
+		return ret;
+	}
+#endif
+};
+
+// Eight 3D vectors as SoA registers, the packet counterpart of quickhull::Vector3<float>
+// LoadRGBA and StoreRGB convert from and to eight consecutive RGBA pixels (4 floats each, as in RGBAImage rows).
+class Vector3x8
+{
+public:
+	static constexpr std::size_t Width = Float8::Width;
+
+	Float8 x, y, z;
+
+	Vector3x8() = default;
+	Vector3x8(Float8 const &x, Float8 const &y, Float8 const &z) : x(x), y(y), z(z)
+	{
+
+	}
+	// the same vector in every lane
+	explicit Vector3x8(quickhull::Vector3<float> const &v) : x(v.x), y(v.y), z(v.z)
+	{
+
+	}
+
+	Float8 dotProduct(Vector3x8 const &o) const { return x * o.x + y * o.y + z * o.z; }
+	Vector3x8 crossProduct(Vector3x8 const &o) const
+	{
+		return Vector3x8(y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x);
+	}
+	Float8 getLengthSquared() const { return x * x + y * y + z * z; }
+	Float8 getLength() const { return Sqrt(getLengthSquared()); }
+	void normalize()
+	{
+		Float8 const len(getLength());
+		x = x / len;
+		y = y / len;
+		z = z / len;
+	}
+	Vector3x8 getNormalized() const
+	{
+		Float8 const len(getLength());
+		return Vector3x8(x / len, y / len, z / len);
+	}
+
+	Vector3x8 operator+(Vector3x8 const &o) const { return Vector3x8(x + o.x, y + o.y, z + o.z); }
+	Vector3x8 operator-(Vector3x8 const &o) const { return Vector3x8(x - o.x, y - o.y, z - o.z); }
+	Vector3x8 operator*(Float8 const &c) const { return Vector3x8(x * c, y * c, z * c); }
+	Vector3x8 operator/(Float8 const &c) const { return Vector3x8(x / c, y / c, z / c); }
+
+	friend Vector3x8 Select(Float8 const &mask, Vector3x8 const &a, Vector3x8 const &b)
+	{
+		return Vector3x8(Select(mask, a.x, b.x), Select(mask, a.y, b.y), Select(mask, a.z, b.z));
+	}
+
+	// SoA arrays of Width floats each
+	void Store(float *dx, float *dy, float *dz) const
+	{
+		x.Store(dx);
+		y.Store(dy);
+		z.Store(dz);
+	}
+
+	quickhull::Vector3<float> Get(std::size_t k) const
+	{
+		alignas(32) float sx[Width], sy[Width], sz[Width];
+		Store(sx, sy, sz);
+		return quickhull::Vector3<float>(sx[k], sy[k], sz[k]);
+	}
+
+	// rgb of eight RGBA pixels, alpha is skipped
+	static Vector3x8 LoadRGBA(float const *src)
+	{
+#if defined(__AVX2__)
+		// pixels k and k + 4 share a register, then a 4x4 transpose inside each 128-bit lane
+		__m256 const a(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 0)), _mm_loadu_ps(src + 16), 1));
+		__m256 const b(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 4)), _mm_loadu_ps(src + 20), 1));
+		__m256 const c(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 8)), _mm_loadu_ps(src + 24), 1));
+		__m256 const d(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 12)), _mm_loadu_ps(src + 28), 1));
+		__m256 const rg01(_mm256_unpacklo_ps(a, b)), rg23(_mm256_unpacklo_ps(c, d));
+		__m256 const ba01(_mm256_unpackhi_ps(a, b)), ba23(_mm256_unpackhi_ps(c, d));
+		return Vector3x8(
+			_mm256_shuffle_ps(rg01, rg23, _MM_SHUFFLE(1, 0, 1, 0)),
+			_mm256_shuffle_ps(rg01, rg23, _MM_SHUFFLE(3, 2, 3, 2)),
+			_mm256_shuffle_ps(ba01, ba23, _MM_SHUFFLE(1, 0, 1, 0)));
+#else
+		Vector3x8 ret;
+		for (std::size_t k(0); k < Width; ++k)
+		{
+			ret.x.v[k] = src[k * 4 + 0];
+			ret.y.v[k] = src[k * 4 + 1];
+			ret.z.v[k] = src[k * 4 + 2];
+		}
+		return ret;
+#endif
+	}
+
+	// the first count pixels, the other lanes are zero
+	static Vector3x8 LoadRGBA(float const *src, std::size_t count)
+	{
+		if (count >= Width)
+			return LoadRGBA(src);
+		alignas(32) float buffer[Width * 4] = {};
+		std::memcpy(buffer, src, count * 4 * sizeof(float));
+		return LoadRGBA(buffer);
+	}
+
+	// writes rgb of eight RGBA pixels and leaves their alpha untouched
+	void StoreRGB(float *dst) const
+	{
+#if defined(__AVX2__)
+		__m256 const alpha(LoadRGBAAlpha(dst));
+		__m256 const rg0(_mm256_unpacklo_ps(x.v, y.v)), ba0(_mm256_unpacklo_ps(z.v, alpha));
+		__m256 const rg1(_mm256_unpackhi_ps(x.v, y.v)), ba1(_mm256_unpackhi_ps(z.v, alpha));
+		__m256 const p04(_mm256_shuffle_ps(rg0, ba0, _MM_SHUFFLE(1, 0, 1, 0)));
+		__m256 const p15(_mm256_shuffle_ps(rg0, ba0, _MM_SHUFFLE(3, 2, 3, 2)));
+		__m256 const p26(_mm256_shuffle_ps(rg1, ba1, _MM_SHUFFLE(1, 0, 1, 0)));
+		__m256 const p37(_mm256_shuffle_ps(rg1, ba1, _MM_SHUFFLE(3, 2, 3, 2)));
+		_mm_storeu_ps(dst + 0, _mm256_castps256_ps128(p04));
+		_mm_storeu_ps(dst + 4, _mm256_castps256_ps128(p15));
+		_mm_storeu_ps(dst + 8, _mm256_castps256_ps128(p26));
+		_mm_storeu_ps(dst + 12, _mm256_castps256_ps128(p37));
+		_mm_storeu_ps(dst + 16, _mm256_extractf128_ps(p04, 1));
+		_mm_storeu_ps(dst + 20, _mm256_extractf128_ps(p15, 1));
+		_mm_storeu_ps(dst + 24, _mm256_extractf128_ps(p26, 1));
+		_mm_storeu_ps(dst + 28, _mm256_extractf128_ps(p37, 1));
+#else
+		for (std::size_t k(0); k < Width; ++k)
+		{
+			dst[k * 4 + 0] = x.v[k];
+			dst[k * 4 + 1] = y.v[k];
+			dst[k * 4 + 2] = z.v[k];
+		}
+#endif
+	}
+
+	// only the first count pixels
+	void StoreRGB(float *dst, std::size_t count) const
+	{
+		if (count >= Width)
+			return StoreRGB(dst);
+		alignas(32) float buffer[Width * 4] = {};
+		std::memcpy(buffer, dst, count * 4 * sizeof(float));
+		StoreRGB(buffer);
+		std::memcpy(dst, buffer, count * 4 * sizeof(float));
+	}
+
+	// only the pixels whose lane of mask is set
+	void StoreRGB(float *dst, Float8 const &mask) const
+	{
+		Select(mask, *this, LoadRGBA(dst)).StoreRGB(dst);
+	}
+private:
+#if defined(__AVX2__)
+	static __m256 LoadRGBAAlpha(float const *src)
+	{
+		// alpha of pixels k and k + 4 in lane k of each half, in the same order as the unpacks of StoreRGB expect
+		__m256 const a(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 0)), _mm_loadu_ps(src + 16), 1));
+		__m256 const b(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 4)), _mm_loadu_ps(src + 20), 1));
+		__m256 const c(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 8)), _mm_loadu_ps(src + 24), 1));
+		__m256 const d(_mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 12)), _mm_loadu_ps(src + 28), 1));
+		__m256 const ba01(_mm256_unpackhi_ps(a, b)), ba23(_mm256_unpackhi_ps(c, d));
+		return _mm256_shuffle_ps(ba01, ba23, _MM_SHUFFLE(3, 2, 3, 2));
+	}
+#endif
+};